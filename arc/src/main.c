@@ -6,6 +6,7 @@
 #include <device.h>
 #include <init.h>
 #include <adc.h>
+#include <string.h>
 
 #include "zjs_ipm.h"
 
@@ -17,10 +18,9 @@
 #define PRINT           printk
 #endif
 
-/* specify delay between greetings (in ms); compute equivalent in ticks */
+/* default time between scans of a channel (in us) */
 
-#define SLEEPTIME  1100
-#define SLEEPTICKS (SLEEPTIME * sys_clock_ticks_per_sec / 800)
+#define DEFAULT_SCAN_PERIOD_US 100000
 
 #define ADC_DEVICE_NAME "ADC_0"
 
@@ -40,32 +40,938 @@
 #define A3 13
 #define A4 14
 #define A5 15
-#define BUFFER_SIZE 4
 
 static struct device* adc_dev;
-static uint32_t pin_values[6] = {};
-static uint32_t pin_send_updates[6] = {};
+static uint32_t pin_values[ZJS_AIO_CHANNELS] = {};
+static uint32_t pin_send_updates[ZJS_AIO_CHANNELS] = {};
+static uint32_t pin_enabled[ZJS_AIO_CHANNELS] = {};
 
-static uint8_t seq_buffer[BUFFER_SIZE];
+// channels with a change x86 hasn't been sent yet, because it was out of
+//   credits; bit 0 is A0
+static uint8_t pending_updates = 0;
 
-int ipm_send_msg(uint32_t id, bool block, uint32_t type, uint32_t pin, uint32_t value) {
+/*
+ * Change events are filtered here so that only meaningful changes cross to
+ * x86: a value is reported once it moves more than deadband from the last
+ * reported value, or more than deadband + hysteresis if it turns back the
+ * other way, and no sooner than min_interval after the last report.
+ */
+struct aio_filter {
+    uint32_t deadband;
+    uint32_t hysteresis;
+    uint32_t min_interval;  // in ticks
+    uint32_t last_value;    // last value reported to x86
+    uint32_t last_time;     // tick count of the last report
+    int direction;          // sign of the last reported change
+    bool reported;          // whether anything was reported yet
+    uint32_t suppressed;    // changes not reported since subscribing
+};
+
+static struct aio_filter filters[ZJS_AIO_CHANNELS] = {};
+
+// new change filter settings from the IPM ISR, which the main loop applies
+//   before the channel's next filter_change so one is never reset part way
+//   through
+struct aio_filter_settings {
+    volatile bool pending;
+    uint32_t deadband;
+    uint32_t hysteresis;
+    uint32_t min_interval;  // in ticks
+};
+
+static struct aio_filter_settings filter_settings[ZJS_AIO_CHANNELS] = {};
+
+/*
+ * Oversampling: each scan takes a run of conversions per channel in its
+ * sequence entry, and the sum of 4^k of them shifted right by k gives a
+ * reading with k more bits of resolution than the ADC's 12, at no cost to
+ * x86 or the IPM traffic.
+ */
+static uint32_t pin_oversample_shift[ZJS_AIO_CHANNELS] = {};
+
+// conversion buffers per channel for the multi-channel scan
+static uint32_t scan_buffers[ZJS_AIO_CHANNELS][ZJS_AIO_MAX_OVERSAMPLE];
+
+/*
+ * Streaming uses the ADC's repetitive sequence mode, so the ADC itself times
+ * the samples in a block: the sequencer delay is set so that one conversion
+ * plus the delay takes one sample period in ADC clock cycles.
+ */
+#define ADC_CLOCK_HZ (sys_clock_hw_cycles_per_sec / CONFIG_ADC_DW_CLOCK_RATIO)
+#define ADC_CONVERSION_CYCLES 14
+#define ADC_MAX_SAMPLING_DELAY 0x7FF
+
+struct aio_stream {
+    uint32_t block_size;    // samples per block, 0 if not streaming
+    uint32_t delay;         // sequencer delay in ADC clock cycles
+    uint32_t period;        // sample period in hw cycles
+    uint32_t epoch;         // counts starts, so old blocks can be told apart
+    // owned by the ADC fiber
+    uint32_t capture_epoch; // epoch next_start and overruns belong to
+    uint32_t next_start;    // hw cycle count the next run should start at
+    uint32_t overruns;      // samples lost between runs
+    // owned by the main loop
+    uint32_t send_epoch;    // epoch sequence belongs to
+    uint32_t sequence;      // blocks sent so far
+};
+
+static struct aio_stream streams[ZJS_AIO_CHANNELS] = {};
+
+/*
+ * All conversions run on the ADC fiber. The ADC driver sleeps it until the
+ * sequence's completion interrupt, so the main loop goes on with change
+ * events, control loops and IPM while a block is captured, and only waits on
+ * the ADC for a scan. Stream blocks are captured into two buffers in turn:
+ * the fiber fills one while the main loop sends the other, so each block
+ * starts as soon as the last one ends. A block is read in runs of a tick's
+ * worth of samples, or one sample if that's longer, and a scan that falls
+ * due waits only for the end of the current run.
+ */
+#define ADC_FIBER_STACK_SIZE 512
+#define ADC_FIBER_PRIORITY 0
+
+struct stream_buffer {
+    int index;              // channel the block is from
+    uint32_t epoch;         // the stream's epoch when the block started
+    uint32_t size;          // samples in the block
+    uint32_t count;         // samples captured so far
+    uint32_t start;         // hw cycle count the block started at
+    uint32_t overruns;      // the stream's overruns when the block ended
+    volatile bool ready;    // complete and waiting to be sent
+    uint32_t samples[ZJS_AIO_STREAM_MAX_BLOCK];
+};
+
+static struct stream_buffer stream_buffers[2];
+static struct stream_buffer *stream_capturing = NULL;
+static int stream_fill_next = 0;    // buffer the fiber fills next
+static int stream_send_next = 0;    // buffer the main loop sends next
+static int stream_next = 0;         // channel to take a block from next
+
+static char __stack adc_fiber_stack[ADC_FIBER_STACK_SIZE];
+static struct nano_sem adc_sem;     // wakes the ADC fiber
+static struct nano_sem scan_sem;    // the scan asked of the fiber is done
+static struct nano_sem loop_sem;    // wakes the main loop before a scan is due
+static volatile uint8_t scan_request = 0;
+static volatile bool scan_ok = false;
+
+/*
+ * Each channel's raw scans can run through a filter chain before anything
+ * else sees them: a boxcar or exponential moving average, then decimation by
+ * N, so pin_values only changes once every N scans. Over each decimation
+ * window the chain can also track min, max and RMS of the raw samples. All
+ * math is integer, since the sensor core has no FPU to spare for this.
+ */
+struct aio_dsp {
+    uint32_t mode;          // one of ZJS_AIO_FILTER_*
+    uint32_t window;        // boxcar length, or EMA shift
+    uint32_t decimate;      // scans per output, at least 1
+    bool stats;             // send a stats message per output
+    uint16_t history[ZJS_AIO_FILTER_MAX_WINDOW];
+    uint32_t index;         // next history slot to replace
+    uint32_t filled;        // valid history entries
+    uint32_t sum;           // sum of valid history entries
+    uint32_t ema;           // EMA in 8.8 fixed point
+    uint32_t count;         // samples in the current decimation window
+    uint32_t min;
+    uint32_t max;
+    uint64_t sum_squares;
+};
+
+static struct aio_dsp dsps[ZJS_AIO_CHANNELS] = {};
+
+// new filter settings from the IPM ISR, which the main loop applies before
+//   the channel's next sample so a chain is never reset part way through one
+struct aio_dsp_settings {
+    volatile bool pending;
+    uint32_t mode;
+    uint32_t window;
+    uint32_t decimate;
+    bool stats;
+};
+
+static struct aio_dsp_settings dsp_settings[ZJS_AIO_CHANNELS] = {};
+
+/*
+ * Each channel is a job with its own scan period. The main loop scans the
+ * channels that are due together in one ADC sequence, then sleeps until
+ * the next one is due, so timing no longer depends on how long the rest of
+ * the loop took. Scheduling is tick-based: the sleep ends on the first
+ * system tick at or after the due time, so a scan starts up to a tick late,
+ * about half a tick on average, and periods shorter than a tick run late
+ * every time. How late each scan starts is recorded for getJitter(). With
+ * nothing scheduled the loop sleeps until the IPM ISR or the ADC fiber
+ * wakes it, rather than on every tick.
+ */
+struct aio_job {
+    uint32_t period;        // hw cycles between scans, 0 for the default
+    uint32_t due;           // hw cycle count the next scan is due
+    bool scheduled;         // due is valid
+    uint32_t runs;          // scans since the period was last set
+    uint32_t max_late;      // hw cycles
+    uint64_t total_late;    // hw cycles
+    volatile bool pending;  // the IPM ISR staged a new period
+    uint32_t new_period;    // hw cycles, applied by the main loop
+};
+
+static struct aio_job jobs[ZJS_AIO_CHANNELS] = {};
+
+/*
+ * A channel can run a PID loop whose output x86 applies to a PWM channel, so
+ * the loop never waits on JS. It steps on each of the channel's filtered
+ * readings, at the period given when it starts. Gains are 16.16 fixed point,
+ * already scaled to that period by x86. The integral is clamped to the
+ * output limits so it can't wind up while the output is saturated, and the
+ * derivative is taken on the input so setpoint changes don't kick the output.
+ */
+// a start or stop from the IPM ISR, which the main loop applies before the
+//   loop's next step so its state is never reset part way through one
+#define PID_STAGED_NONE  0
+#define PID_STAGED_START 1
+#define PID_STAGED_STOP  2
+
+struct aio_pid {
+    bool running;
+    volatile uint32_t staged;   // PID_STAGED_*
+    int32_t kp, ki, kd;     // 16.16 fixed point
+    uint32_t out_min;       // duty cycles, 0 to ZJS_AIO_PID_DUTY_MAX
+    uint32_t out_max;
+    uint32_t telemetry;     // mark every Nth output for JS, 0 for none
+    uint32_t setpoint;
+    int64_t integral;       // 16.16 fixed point duty cycle
+    uint32_t last_input;
+    uint32_t sequence;      // outputs since the loop started
+    bool pending;           // msg is waiting for an IPM credit
+    struct zjs_ipm_pid_message msg;
+};
+
+static struct aio_pid pids[ZJS_AIO_CHANNELS] = {};
+
+/*
+ * A read from x86 is answered with a new reading, not the last scan's: the
+ * IPM ISR can't use the ADC, so it queues the read here and the main loop
+ * scans the channel on its next pass, with whatever else is due, before
+ * replying. The queue holds as many requests as x86 can have in flight.
+ */
+#define READ_QUEUE_SIZE 16
+
+struct aio_read {
+    uint32_t id;            // x86's request id
+    uint32_t block;
+    uint32_t pin;
+};
+
+static struct aio_read read_queue[READ_QUEUE_SIZE];
+static volatile uint32_t read_head = 0;    // only the IPM ISR changes it
+static volatile uint32_t read_tail = 0;    // only the main loop changes it
+
+#define CYCLES_PER_US (sys_clock_hw_cycles_per_sec / 1000000)
+
+int ipm_send_msg(uint32_t id, bool block, uint8_t request, uint32_t type,
+                 uint32_t pin, uint32_t value, uint32_t param) {
     struct zjs_ipm_message msg;
     msg.block = block;
+    msg.id = request;
     msg.type = type;
     msg.pin = pin;
     msg.value = value;
+    msg.param = param;
     return zjs_ipm_send(id, &msg, sizeof(msg));
 }
 
-uint32_t pin_read(uint8_t pin)
+bool dsp_configure(int index, uint32_t options, uint32_t param)
+{
+    // requires: called from the IPM ISR
+    //  effects: stages a new filter chain for channel index from a
+    //             TYPE_AIO_PIN_SET_FILTER request; returns false if the
+    //             settings aren't supported
+    uint32_t mode = options & 0xff;
+    uint32_t window = (options >> 8) & 0xff;
+    uint32_t decimate = param & 0xffff;
+
+    if (mode > ZJS_AIO_FILTER_EMA || !decimate)
+        return false;
+    if (mode == ZJS_AIO_FILTER_BOXCAR &&
+        (!window || window > ZJS_AIO_FILTER_MAX_WINDOW))
+        return false;
+    if (mode == ZJS_AIO_FILTER_EMA && window > ZJS_AIO_FILTER_MAX_SHIFT)
+        return false;
+
+    struct aio_dsp_settings *settings = &dsp_settings[index];
+    settings->mode = mode;
+    settings->window = window;
+    settings->decimate = decimate;
+    settings->stats = param & ZJS_AIO_FILTER_STATS;
+    settings->pending = true;
+    return true;
+}
+
+static void dsp_apply(int index)
+{
+    // effects: resets channel index's filter chain to the settings last
+    //            staged by dsp_configure, if there are any it hasn't applied
+    struct aio_dsp_settings *settings = &dsp_settings[index];
+    if (!settings->pending)
+        return;
+
+    // the ISR may stage newer settings while these are copied
+    struct aio_dsp *dsp = &dsps[index];
+    int key = irq_lock();
+    memset(dsp, 0, sizeof(struct aio_dsp));
+    dsp->mode = settings->mode;
+    dsp->window = settings->window;
+    dsp->decimate = settings->decimate;
+    dsp->stats = settings->stats;
+    settings->pending = false;
+    irq_unlock(key);
+}
+
+static uint32_t isqrt(uint32_t n)
+{
+    // effects: returns floor(sqrt(n))
+    uint32_t root = 0;
+    uint32_t bit = 1 << 30;
+    while (bit > n)
+        bit >>= 2;
+
+    while (bit) {
+        if (n >= root + bit) {
+            n -= root + bit;
+            root = (root >> 1) + bit;
+        } else {
+            root >>= 1;
+        }
+        bit >>= 2;
+    }
+    return root;
+}
+
+bool dsp_process(int index, uint32_t raw)
+{
+    // effects: runs one raw sample through channel index's filter chain;
+    //            when a decimation window completes, stores the output in
+    //            pin_values, sends stats if enabled, and returns true
+    dsp_apply(index);
+
+    struct aio_dsp *dsp = &dsps[index];
+    uint32_t value = raw;
+
+    if (dsp->mode == ZJS_AIO_FILTER_BOXCAR) {
+        if (dsp->filled == dsp->window) {
+            dsp->sum -= dsp->history[dsp->index];
+        } else {
+            dsp->filled++;
+        }
+        dsp->history[dsp->index] = raw;
+        dsp->sum += raw;
+        dsp->index = (dsp->index + 1) % dsp->window;
+        value = dsp->sum / dsp->filled;
+    } else if (dsp->mode == ZJS_AIO_FILTER_EMA) {
+        if (!dsp->filled) {
+            dsp->ema = raw << 8;
+            dsp->filled = 1;
+        } else {
+            int32_t delta = (int32_t)(raw << 8) - (int32_t)dsp->ema;
+            dsp->ema += delta >> dsp->window;
+        }
+        value = (dsp->ema + 0x80) >> 8;
+    }
+
+    if (!dsp->count || raw < dsp->min)
+        dsp->min = raw;
+    if (!dsp->count || raw > dsp->max)
+        dsp->max = raw;
+    dsp->sum_squares += raw * raw;
+    dsp->count++;
+
+    // unconfigured channels have decimate 0 and pass every sample through
+    if (dsp->count < dsp->decimate)
+        return false;
+
+    pin_values[index] = value;
+    if (dsp->stats) {
+        struct zjs_ipm_stats_message msg;
+        msg.type = TYPE_AIO_PIN_EVENT_STATS;
+        msg.pin = index+A0;
+        msg.reserved = 0;
+        msg.value = value;
+        msg.min = dsp->min;
+        msg.max = dsp->max;
+        msg.rms = isqrt(dsp->sum_squares / dsp->count);
+        msg.count = dsp->count;
+        if (zjs_ipm_send_event(MSG_ID_AIO, &msg, sizeof(msg)) != 0) {
+            // x86 is behind, so keep the window open and try again with the
+            //   next sample rather than lose this one's stats
+            return true;
+        }
+    }
+
+    dsp->count = 0;
+    dsp->sum_squares = 0;
+    return true;
+}
+
+bool oversample_set(int index, uint32_t count)
+{
+    // effects: sets channel index to accumulate count conversions per
+    //            reading, where 0 means 1; returns false unless count is a
+    //            power of 4 no bigger than ZJS_AIO_MAX_OVERSAMPLE
+    uint32_t shift = 0;
+    if (!count)
+        count = 1;
+    while ((1 << (2 * shift)) < count)
+        shift++;
+
+    if ((1 << (2 * shift)) != count || count > ZJS_AIO_MAX_OVERSAMPLE)
+        return false;
+
+    pin_oversample_shift[index] = shift;
+    return true;
+}
+
+bool job_set_period(int index, uint32_t period_us)
+{
+    // requires: called from the IPM ISR
+    //  effects: stages a new scan period for channel index, where 0 restores
+    //             the default, which also clears its jitter stats; returns
+    //             false if the period is too long to count in hw cycles
+    if (period_us > 0xFFFFFFFF / CYCLES_PER_US)
+        return false;
+
+    struct aio_job *job = &jobs[index];
+    job->new_period = period_us * CYCLES_PER_US;
+    job->pending = true;
+    return true;
+}
+
+static void job_apply(int index)
+{
+    // effects: resets channel index's schedule to the period last staged by
+    //            job_set_period, if there is one it hasn't applied
+    struct aio_job *job = &jobs[index];
+    if (!job->pending)
+        return;
+
+    // the ISR may stage a newer period while this one is applied
+    int key = irq_lock();
+    job->period = job->new_period;
+    job->scheduled = false;
+    job->runs = 0;
+    job->max_late = 0;
+    job->total_late = 0;
+    job->pending = false;
+    irq_unlock(key);
+}
+
+uint8_t job_collect_due(uint32_t now)
+{
+    // effects: returns a mask of the open or subscribed channels due for a
+    //            scan at now, records how late each is, and schedules its
+    //            next scan
+    uint8_t due = 0;
+    for (int i=0; i<ZJS_AIO_CHANNELS; i++) {
+        job_apply(i);
+        if (!pin_enabled[i] && !pin_send_updates[i])
+            continue;
+
+        struct aio_job *job = &jobs[i];
+        uint32_t period = job->period ? job->period :
+                          DEFAULT_SCAN_PERIOD_US * CYCLES_PER_US;
+        if (!job->scheduled) {
+            job->due = now;
+            job->scheduled = true;
+        }
+
+        uint32_t late = now - job->due;
+        if ((int32_t)late < 0)
+            continue;
+
+        // getJitter reads these from the IPM ISR
+        int key = irq_lock();
+        job->runs++;
+        job->total_late += late;
+        if (late > job->max_late)
+            job->max_late = late;
+        irq_unlock(key);
+
+        // keep to the original grid unless a whole period was missed
+        job->due += period;
+        if ((int32_t)(now - job->due) >= 0)
+            job->due = now + period;
+        due |= 1 << i;
+    }
+    return due;
+}
+
+void job_sleep(uint32_t now, bool poll)
+{
+    // effects: waits until the tick the next scan is due on, or until woken
+    //            by an IPM request or a stream block to send; if poll, waits
+    //            no more than a tick
+    int32_t ticks = TICKS_UNLIMITED;
+    for (int i=0; i<ZJS_AIO_CHANNELS; i++) {
+        if (!jobs[i].scheduled || (!pin_enabled[i] && !pin_send_updates[i]))
+            continue;
+
+        int32_t wait = jobs[i].due - now;
+        if (wait <= 0)
+            return;
+
+        // round up so the sleep never ends before the job is due
+        int32_t t = (wait + sys_clock_hw_cycles_per_tick - 1) /
+                    sys_clock_hw_cycles_per_tick;
+        if (ticks == TICKS_UNLIMITED || t < ticks)
+            ticks = t;
+    }
+
+    if (poll && (ticks == TICKS_UNLIMITED || ticks > 1))
+        ticks = 1;
+    nano_task_sem_take(&loop_sem, ticks);
+}
+
+bool pid_configure(int index, uint32_t param, uint32_t value)
+{
+    // effects: sets control loop parameter param of channel index to value;
+    //            returns false if either is out of range
+    struct aio_pid *pid = &pids[index];
+    switch (param) {
+    case ZJS_AIO_PID_KP:
+        pid->kp = (int32_t)value;
+        break;
+    case ZJS_AIO_PID_KI:
+        pid->ki = (int32_t)value;
+        break;
+    case ZJS_AIO_PID_KD:
+        pid->kd = (int32_t)value;
+        break;
+    case ZJS_AIO_PID_OUTPUT_MIN:
+        if (value > ZJS_AIO_PID_DUTY_MAX)
+            return false;
+        pid->out_min = value;
+        break;
+    case ZJS_AIO_PID_OUTPUT_MAX:
+        if (value > ZJS_AIO_PID_DUTY_MAX)
+            return false;
+        pid->out_max = value;
+        break;
+    case ZJS_AIO_PID_TELEMETRY:
+        pid->telemetry = value;
+        break;
+    default:
+        return false;
+    }
+    return true;
+}
+
+bool pid_start(int index, uint32_t setpoint, uint32_t period_us)
+{
+    // requires: called from the IPM ISR
+    //  effects: stages a start of channel index's control loop from a clear
+    //             state, scanning the channel every period_us; returns false
+    //             if the channel isn't open or the limits or period are
+    //             invalid
+    struct aio_pid *pid = &pids[index];
+    if (!pin_enabled[index] || !period_us || pid->out_min > pid->out_max ||
+        !job_set_period(index, period_us))
+        return false;
+
+    // pid_step reads the setpoint with interrupts masked, as it does for a
+    //   setpoint change
+    pid->setpoint = setpoint;
+    pid->staged = PID_STAGED_START;
+    return true;
+}
+
+void pid_stop(int index)
+{
+    // requires: called from the IPM ISR
+    //  effects: stages a stop of channel index's control loop and restores
+    //             its default scan period
+    pids[index].staged = PID_STAGED_STOP;
+    job_set_period(index, 0);
+}
+
+static void pid_apply(int index)
+{
+    // effects: starts or stops channel index's control loop as last staged
+    //            by pid_start or pid_stop, if it hasn't been applied
+    struct aio_pid *pid = &pids[index];
+    if (pid->staged == PID_STAGED_NONE)
+        return;
+
+    int key = irq_lock();
+    if (pid->staged == PID_STAGED_START) {
+        pid->integral = (int64_t)pid->out_min << 16;
+        pid->sequence = 0;
+        pid->running = true;
+    } else {
+        pid->running = false;
+    }
+    pid->pending = false;
+    pid->staged = PID_STAGED_NONE;
+    irq_unlock(key);
+}
+
+void pin_close(int index)
+{
+    // effects: closes channel index, stopping its scans, change events,
+    //            stream and control loop
+    pin_enabled[index] = 0;
+    pin_send_updates[index] = 0;
+    streams[index].block_size = 0;
+    pid_stop(index);
+}
+
+void pid_step(int index)
+{
+    // effects: runs one step of channel index's control loop on its latest
+    //            reading and sends the output to x86; if x86 is out of
+    //            credits, the output is kept to send on a later pass unless
+    //            a newer one replaces it first
+    struct aio_pid *pid = &pids[index];
+
+    // the IPM ISR can change the setpoint or gains under us
+    int key = irq_lock();
+    uint32_t input = pin_values[index];
+    int32_t error = (int32_t)pid->setpoint - (int32_t)input;
+    int64_t min = (int64_t)pid->out_min << 16;
+    int64_t max = (int64_t)pid->out_max << 16;
+
+    pid->integral += (int64_t)pid->ki * error;
+    if (pid->integral < min)
+        pid->integral = min;
+    if (pid->integral > max)
+        pid->integral = max;
+
+    int64_t out = (int64_t)pid->kp * error + pid->integral;
+    if (pid->sequence) {
+        out -= (int64_t)pid->kd *
+               ((int32_t)input - (int32_t)pid->last_input);
+    }
+    pid->last_input = input;
+
+    out = (out + 0x8000) >> 16;
+    if (out < pid->out_min)
+        out = pid->out_min;
+    if (out > pid->out_max)
+        out = pid->out_max;
+
+    // a replaced output still owes JS its telemetry
+    uint8_t flags = pid->pending ? pid->msg.flags : 0;
+    if (pid->telemetry && pid->sequence % pid->telemetry == 0)
+        flags |= ZJS_AIO_PID_FLAG_TELEMETRY;
+
+    pid->msg.type = TYPE_AIO_PIN_EVENT_PID;
+    pid->msg.pin = index+A0;
+    pid->msg.flags = flags;
+    pid->msg.input = input;
+    pid->msg.output = out;
+    pid->msg.error = error;
+    pid->msg.sequence = pid->sequence++;
+    pid->pending = true;
+    irq_unlock(key);
+}
+
+void pid_send(int index)
+{
+    // effects: sends channel index's pending control loop output, if x86 has
+    //            a credit for it
+    struct aio_pid *pid = &pids[index];
+    if (pid->pending &&
+        zjs_ipm_send_event(MSG_ID_AIO, &pid->msg, sizeof(pid->msg)) == 0)
+        pid->pending = false;
+}
+
+bool pin_convert(uint8_t request)
+{
+    // requires: called from the ADC fiber
+    //  effects: reads the channels in request into scan_buffers with one ADC
+    //             sequence; returns false if the ADC failed
+    struct adc_seq_entry entries[ZJS_AIO_CHANNELS];
+    int count = 0;
+
+    for (int i=0; i<ZJS_AIO_CHANNELS; i++) {
+        if (!(request & (1 << i)))
+            continue;
+
+        entries[count].sampling_delay = 12;
+        entries[count].channel_id = i+A0;
+        entries[count].buffer = (uint8_t *) scan_buffers[i];
+        entries[count].buffer_length =
+            sizeof(uint32_t) << (2 * pin_oversample_shift[i]);
+        count++;
+    }
+
+    struct adc_seq_table entry_table = {
+        .entries = entries,
+        .num_entries = count,
+    };
+
+    return adc_read(adc_dev, &entry_table) == 0;
+}
+
+bool read_stage(struct zjs_ipm_message *msg)
+{
+    // requires: called from the IPM ISR with a TYPE_AIO_PIN_READ request
+    //             for a valid pin
+    //  effects: queues the read for the main loop to answer after its next
+    //             scan; returns false if the queue is full
+    uint32_t head = read_head;
+    if (head - read_tail >= READ_QUEUE_SIZE)
+        return false;
+
+    struct aio_read *read = &read_queue[head % READ_QUEUE_SIZE];
+    read->id = msg->id;
+    read->block = msg->block;
+    read->pin = msg->pin;
+    read_head = head + 1;
+    return true;
+}
+
+uint8_t read_collect(uint32_t *end)
+{
+    // effects: returns a mask of the channels with reads queued, bit 0 being
+    //            A0, and in end the queue position after the last of them,
+    //            so reads queued after the scan starts wait for the next one
+    uint32_t head = read_head;
+    uint8_t mask = 0;
+    for (uint32_t i = read_tail; i != head; i++)
+        mask |= 1 << (read_queue[i % READ_QUEUE_SIZE].pin - A0);
+    *end = head;
+    return mask;
+}
+
+void read_reply(uint32_t end, bool ok)
+{
+    // effects: answers the queued reads up to end with their channels'
+    //            values from the scan just taken, or fails them if it failed
+    for (uint32_t i = read_tail; i != end; i++) {
+        struct aio_read *read = &read_queue[i % READ_QUEUE_SIZE];
+        uint32_t type = ok ? TYPE_AIO_PIN_READ_SUCCESS :
+                             TYPE_AIO_PIN_READ_FAIL;
+        if (ipm_send_msg(MSG_ID_AIO, read->block, read->id, type, read->pin,
+                         ok ? pin_values[read->pin - A0] : 0, 0) != 0) {
+            PRINT("ARC - couldn't reply to a read of pin #%d\n", read->pin);
+        }
+    }
+    read_tail = end;
+}
+
+uint8_t pin_scan(uint8_t request)
+{
+    // effects: has the ADC fiber read the channels in request with one ADC
+    //            sequence and runs the results through their filter chains;
+    //            returns a mask of the channels with a new value in
+    //            pin_values, bit 0 being A0
+    uint8_t mask = request & ((1 << ZJS_AIO_CHANNELS) - 1);
+    if (!mask)
+        return 0;
+
+    if (!adc_dev) {
+       PRINT("ARC - ADC device not found\n");
+       return 0;
+    }
+
+    scan_request = mask;
+    nano_task_sem_give(&adc_sem);
+    nano_task_sem_take(&scan_sem, TICKS_UNLIMITED);
+    if (!scan_ok) {
+        PRINT("ARC - couldn't scan ADC channels\n");
+        return 0;
+    }
+
+    uint8_t ready = 0;
+    for (int i=0; i<ZJS_AIO_CHANNELS; i++) {
+        if (!(mask & (1 << i)))
+            continue;
+
+        uint32_t shift = pin_oversample_shift[i];
+        uint32_t sum = 0;
+        for (int j=0; j < 1 << (2 * shift); j++) {
+            sum += scan_buffers[i][j];
+        }
+        if (dsp_process(i, sum >> shift))
+            ready |= 1 << i;
+    }
+    return ready;
+}
+
+void filter_subscribe(int index, uint32_t options, uint32_t min_interval_ms)
+{
+    // requires: called from the IPM ISR
+    //  effects: stages a reset of the change filter for channel index;
+    //             options holds the deadband in the low 16 bits and
+    //             hysteresis in the high 16
+    struct aio_filter_settings *settings = &filter_settings[index];
+    settings->deadband = options & 0xffff;
+    settings->hysteresis = options >> 16;
+    settings->min_interval = min_interval_ms * sys_clock_ticks_per_sec / 1000;
+    settings->pending = true;
+}
+
+static void filter_apply(int index)
+{
+    // effects: resets channel index's change filter to the settings last
+    //            staged by filter_subscribe, if there are any it hasn't
+    //            applied
+    struct aio_filter_settings *settings = &filter_settings[index];
+    if (!settings->pending)
+        return;
+
+    // the ISR may stage newer settings while these are copied
+    struct aio_filter *f = &filters[index];
+    int key = irq_lock();
+    f->deadband = settings->deadband;
+    f->hysteresis = settings->hysteresis;
+    f->min_interval = settings->min_interval;
+    f->direction = 0;
+    f->reported = false;
+    f->suppressed = 0;
+    settings->pending = false;
+    irq_unlock(key);
+}
+
+bool filter_change(int index)
 {
-    uint8_t* buf = seq_buffer;
+    // effects: returns true if the latest value of channel index should be
+    //            reported, and if so records it as reported; counts changes
+    //            that are held back
+    filter_apply(index);
+
+    struct aio_filter *f = &filters[index];
+    uint32_t value = pin_values[index];
+    uint32_t now = sys_tick_get_32();
+
+    if (!f->reported) {
+        f->reported = true;
+        f->last_value = value;
+        f->last_time = now;
+        return true;
+    }
+
+    if (value == f->last_value)
+        return false;
+
+    int direction = value > f->last_value ? 1 : -1;
+    uint32_t delta = direction > 0 ? value - f->last_value :
+                                     f->last_value - value;
+    uint32_t threshold = f->deadband;
+    if (f->direction && direction != f->direction)
+        threshold += f->hysteresis;
+
+    if (delta <= threshold || now - f->last_time < f->min_interval) {
+        f->suppressed++;
+        return false;
+    }
+
+    f->last_value = value;
+    f->last_time = now;
+    f->direction = direction;
+    return true;
+}
+
+int ipm_send_scan(uint8_t mask)
+{
+    // effects: sends the latest values of the channels in mask to x86 in a
+    //            single message
+    struct zjs_ipm_scan_message msg;
+    msg.type = TYPE_AIO_PIN_EVENT_SCAN;
+    msg.mask = mask;
+    msg.reserved = 0;
+    for (int i=0; i<ZJS_AIO_CHANNELS; i++) {
+        msg.values[i] = (mask & (1 << i)) ? pin_values[i] : 0;
+    }
+    return zjs_ipm_send_event(MSG_ID_AIO, &msg, sizeof(msg));
+}
+
+bool stream_start(uint32_t pin, uint32_t rate, uint32_t block_size)
+{
+    // effects: starts streaming blocks of block_size samples from pin at
+    //            rate samples per second; returns false if the ADC sequencer
+    //            can't produce that rate or the block is too big
+    if (!rate || !block_size || block_size > ZJS_AIO_STREAM_MAX_BLOCK)
+        return false;
+
+    uint32_t cycles = ADC_CLOCK_HZ / rate;
+    if (cycles < ADC_CONVERSION_CYCLES ||
+        cycles - ADC_CONVERSION_CYCLES > ADC_MAX_SAMPLING_DELAY)
+        return false;
+
+    struct aio_stream *st = &streams[pin-A0];
+    st->delay = cycles - ADC_CONVERSION_CYCLES;
+    st->period = sys_clock_hw_cycles_per_sec / rate;
+    st->epoch++;
+    st->block_size = block_size;
+    nano_isr_sem_give(&adc_sem);
+    return true;
+}
+
+static bool stream_any(void)
+{
+    // effects: returns true if any channel is streaming
+    for (int i=0; i<ZJS_AIO_CHANNELS; i++) {
+        if (streams[i].block_size)
+            return true;
+    }
+    return false;
+}
+
+void stream_capture(void)
+{
+    // requires: called from the ADC fiber
+    //  effects: captures the next run of the block in progress, first
+    //             starting a block from the next streaming channel if a
+    //             buffer is free for it; hands a complete block to the main
+    //             loop
+    struct stream_buffer *buf = stream_capturing;
+    if (!buf) {
+        buf = &stream_buffers[stream_fill_next];
+        if (buf->ready)
+            return;
+
+        int index = -1;
+        int key = irq_lock();
+        for (int n=0; n<ZJS_AIO_CHANNELS; n++) {
+            int i = (stream_next + n) % ZJS_AIO_CHANNELS;
+            if (streams[i].block_size) {
+                index = i;
+                buf->epoch = streams[i].epoch;
+                buf->size = streams[i].block_size;
+                break;
+            }
+        }
+        irq_unlock(key);
+        if (index < 0)
+            return;
+
+        buf->index = index;
+        buf->count = 0;
+        stream_next = (index + 1) % ZJS_AIO_CHANNELS;
+        stream_capturing = buf;
+    }
+
+    // the IPM ISR can stop or restart the stream under us
+    struct aio_stream *st = &streams[buf->index];
+    int key = irq_lock();
+    bool live = st->block_size && st->epoch == buf->epoch;
+    uint32_t delay = st->delay;
+    uint32_t period = st->period;
+    irq_unlock(key);
+    if (!live) {
+        stream_capturing = NULL;
+        return;
+    }
+
+    uint32_t run = sys_clock_hw_cycles_per_tick / period;
+    if (!run)
+        run = 1;
+    if (run > buf->size - buf->count)
+        run = buf->size - buf->count;
 
     struct adc_seq_entry entry = {
-        .sampling_delay = 12,
-        .channel_id = pin,
-        .buffer = seq_buffer,
-        .buffer_length = BUFFER_SIZE,
+        .sampling_delay = delay,
+        .channel_id = buf->index+A0,
+        .buffer = (uint8_t *) &buf->samples[buf->count],
+        .buffer_length = run * sizeof(uint32_t),
     };
 
     struct adc_seq_table entry_table = {
@@ -73,18 +979,116 @@ uint32_t pin_read(uint8_t pin)
         .num_entries = 1,
     };
 
-    if (!adc_dev) {
-       PRINT("ARC - ADC device not found\n");
-       return 0;
+    uint32_t start = sys_cycle_get_32();
+    if (st->capture_epoch != buf->epoch) {
+        st->capture_epoch = buf->epoch;
+        st->overruns = 0;
+    } else {
+        // count the samples that fell in the gap since the last run ended
+        int32_t late = (int32_t)(start - st->next_start);
+        if (late > 0)
+            st->overruns += late / period;
     }
+    st->next_start = start + run * period;
+    if (!buf->count)
+        buf->start = start;
 
     if (adc_read(adc_dev, &entry_table) != 0) {
-        PRINT("ARC - couldn't read from pin %d\n", pin);
-        return 0;
+        PRINT("ARC - couldn't stream from pin %d\n", buf->index+A0);
+        stream_capturing = NULL;
+        return;
     }
 
-    uint32_t raw_value = *((uint32_t *) buf);
-    return raw_value;
+    buf->count += run;
+    if (buf->count == buf->size) {
+        buf->overruns = st->overruns;
+        buf->ready = true;
+        stream_fill_next ^= 1;
+        stream_capturing = NULL;
+        nano_fiber_sem_give(&loop_sem);
+    }
+}
+
+void adc_fiber(int arg1, int arg2)
+{
+    // effects: runs the scans the main loop asks for, and captures stream
+    //            blocks while there's a buffer free for one
+    while (1) {
+        bool busy = stream_capturing ||
+                    (!stream_buffers[stream_fill_next].ready && stream_any());
+        nano_fiber_sem_take(&adc_sem, busy ? TICKS_NONE : TICKS_UNLIMITED);
+
+        if (scan_request) {
+            uint8_t request = scan_request;
+            struct stream_buffer *buf = stream_capturing;
+            if (buf && buf->count && (request & (1 << buf->index))) {
+                // a conversion now would land in the middle of the block, so
+                //   the stream's latest sample stands in for it
+                uint32_t *samples = scan_buffers[buf->index];
+                int n = 1 << (2 * pin_oversample_shift[buf->index]);
+                for (int j=0; j<n; j++) {
+                    samples[j] = buf->samples[buf->count-1];
+                }
+                request &= ~(1 << buf->index);
+            }
+            scan_ok = !request || pin_convert(request);
+            scan_request = 0;
+            nano_fiber_sem_give(&scan_sem);
+        }
+        stream_capture();
+    }
+}
+
+bool stream_send(struct stream_buffer *buf)
+{
+    // effects: sends a captured block to x86 as data messages followed by an
+    //            end message, or drops it if its stream has stopped or
+    //            restarted since; returns false, keeping the block, if x86
+    //            isn't ready for another block
+    struct aio_stream *st = &streams[buf->index];
+    if (!st->block_size || st->epoch != buf->epoch)
+        return true;
+
+    // x86 holds a block's credits until JS has taken it, with room for one
+    //   more behind it, so wait while it holds two blocks' worth; the fiber
+    //   loses samples meanwhile once both buffers are full, and they show up
+    //   as overruns
+    uint32_t messages = (buf->size + ZJS_AIO_STREAM_CHUNK - 1) /
+                        ZJS_AIO_STREAM_CHUNK + 1;
+    uint32_t held = ZJS_IPM_EVENT_CREDITS - zjs_ipm_credits();
+    if (held + messages > 2 * messages)
+        return false;
+
+    if (st->send_epoch != buf->epoch) {
+        st->send_epoch = buf->epoch;
+        st->sequence = 0;
+    }
+
+    struct zjs_ipm_stream_message data;
+    data.type = TYPE_AIO_PIN_EVENT_STREAM_DATA;
+    data.pin = buf->index+A0;
+    for (uint32_t i=0; i<buf->size; i+=ZJS_AIO_STREAM_CHUNK) {
+        data.count = buf->size - i;
+        if (data.count > ZJS_AIO_STREAM_CHUNK)
+            data.count = ZJS_AIO_STREAM_CHUNK;
+        for (int j=0; j<data.count; j++) {
+            data.samples[j] = buf->samples[i+j];
+        }
+        if (zjs_ipm_send_event(MSG_ID_AIO, &data, sizeof(data)) != 0) {
+            // x86 will drop the short block when the next one ends
+            return true;
+        }
+    }
+
+    struct zjs_ipm_stream_end_message end;
+    end.type = TYPE_AIO_PIN_EVENT_STREAM_END;
+    end.pin = buf->index+A0;
+    end.reserved = 0;
+    end.timestamp = buf->start;
+    end.sequence = st->sequence++;
+    end.overruns = buf->overruns;
+    zjs_ipm_send_event(MSG_ID_AIO, &end, sizeof(end));
+    return true;
 }
 
 void ipm_msg_receive_callback(void *context, uint32_t id, volatile void *data)
@@ -93,31 +1097,34 @@ void ipm_msg_receive_callback(void *context, uint32_t id, volatile void *data)
     uint32_t pin = msg->pin;
     uint32_t reply_type = 0;
     uint32_t reply_value = 0;
-
-    if (id != MSG_ID_AIO)
-        return;
+    uint32_t reply_param = 0;
 
     if (msg->type == TYPE_AIO_OPEN) {
         if (pin < A0 || pin > A5) {
             PRINT("ARC - pin #%d out of range\n", pin);
             reply_type = TYPE_AIO_OPEN_FAIL;
         } else {
-            reply_type = TYPE_AIO_OPEN_SUCCESS;
+            if (!oversample_set(pin-A0, msg->value)) {
+                PRINT("ARC - can't oversample pin #%d by %d\n", pin,
+                      msg->value);
+                reply_type = TYPE_AIO_OPEN_FAIL;
+            } else {
+                pin_enabled[pin-A0] = 1;
+                reply_type = TYPE_AIO_OPEN_SUCCESS;
+            }
         }
     } else if (msg->type == TYPE_AIO_PIN_READ) {
         if (pin < A0 || pin > A5) {
             PRINT("ARC - pin #%d out of range\n", pin);
             reply_type = TYPE_AIO_PIN_READ_FAIL;
+        } else if (!read_stage(msg)) {
+            PRINT("ARC - too many reads queued\n");
+            reply_type = TYPE_AIO_PIN_READ_FAIL;
+        } else {
+            // the main loop replies once it has scanned the pin
+            nano_isr_sem_give(&loop_sem);
+            return;
         }
-
-        reply_type = TYPE_AIO_PIN_READ_SUCCESS;
-        /*
-         * FIX ME!
-         * inside the interrupt, cannot read from the ADC pins
-         * only from the main loop thread
-         */
-        //reply_value = pin_read(A0);
-        reply_value = pin_values[pin-A0];
     } else if (msg->type == TYPE_AIO_PIN_ABORT) {
         PRINT("ARC - AIO abort() not supported\n");
         reply_type = TYPE_AIO_PIN_ABORT_SUCCESS;
@@ -126,6 +1133,7 @@ void ipm_msg_receive_callback(void *context, uint32_t id, volatile void *data)
             PRINT("ARC - pin #%d out of range\n", pin);
             reply_type = TYPE_AIO_PIN_CLOSE_FAIL;
         } else {
+            pin_close(pin-A0);
             PRINT("ARC - AIO pin #%d is closed\n", pin);
             reply_type = TYPE_AIO_PIN_CLOSE_SUCCESS;
         }
@@ -134,6 +1142,7 @@ void ipm_msg_receive_callback(void *context, uint32_t id, volatile void *data)
             PRINT("ARC - pin #%d out of range\n", pin);
             reply_type = TYPE_AIO_PIN_SUBSCRIBE_FAIL;
         } else {
+            filter_subscribe(pin-A0, msg->value, msg->param);
             pin_send_updates[pin-A0] = 1;
             reply_type = TYPE_AIO_PIN_SUBSCRIBE_SUCCESS;
         }
@@ -145,11 +1154,108 @@ void ipm_msg_receive_callback(void *context, uint32_t id, volatile void *data)
             pin_send_updates[pin-A0] = 0;
             reply_type = TYPE_AIO_PIN_UNSUBSCRIBE_SUCCESS;
         }
+    } else if (msg->type == TYPE_AIO_PIN_SET_FILTER) {
+        if (pin < A0 || pin > A5 ||
+            !dsp_configure(pin-A0, msg->value, msg->param)) {
+            PRINT("ARC - can't set filter on pin #%d\n", pin);
+            reply_type = TYPE_AIO_PIN_SET_FILTER_FAIL;
+        } else {
+            reply_type = TYPE_AIO_PIN_SET_FILTER_SUCCESS;
+        }
+    } else if (msg->type == TYPE_AIO_PIN_SET_PERIOD) {
+        if (pin < A0 || pin > A5 || !job_set_period(pin-A0, msg->value)) {
+            PRINT("ARC - can't set scan period of pin #%d\n", pin);
+            reply_type = TYPE_AIO_PIN_SET_PERIOD_FAIL;
+        } else {
+            reply_type = TYPE_AIO_PIN_SET_PERIOD_SUCCESS;
+        }
+    } else if (msg->type == TYPE_AIO_PIN_GET_JITTER) {
+        if (pin < A0 || pin > A5) {
+            PRINT("ARC - pin #%d out of range\n", pin);
+            reply_type = TYPE_AIO_PIN_GET_JITTER_FAIL;
+        } else {
+            // a period the main loop hasn't applied yet starts with none
+            struct aio_job *job = &jobs[pin-A0];
+            reply_type = TYPE_AIO_PIN_GET_JITTER_SUCCESS;
+            if (!job->pending) {
+                reply_value = job->max_late / CYCLES_PER_US;
+                if (job->runs)
+                    reply_param = job->total_late / job->runs /
+                                  CYCLES_PER_US;
+            }
+        }
+    } else if (msg->type == TYPE_AIO_PIN_PID_CONFIG) {
+        if (pin < A0 || pin > A5 ||
+            !pid_configure(pin-A0, msg->value, msg->param)) {
+            PRINT("ARC - can't configure control loop on pin #%d\n", pin);
+            reply_type = TYPE_AIO_PIN_PID_CONFIG_FAIL;
+        } else {
+            reply_type = TYPE_AIO_PIN_PID_CONFIG_SUCCESS;
+        }
+    } else if (msg->type == TYPE_AIO_PIN_PID_START) {
+        if (pin < A0 || pin > A5 ||
+            !pid_start(pin-A0, msg->value, msg->param)) {
+            PRINT("ARC - can't start control loop on pin #%d\n", pin);
+            reply_type = TYPE_AIO_PIN_PID_START_FAIL;
+        } else {
+            reply_type = TYPE_AIO_PIN_PID_START_SUCCESS;
+        }
+    } else if (msg->type == TYPE_AIO_PIN_PID_SETPOINT) {
+        if (pin < A0 || pin > A5 ||
+            !(pids[pin-A0].running ?
+              pids[pin-A0].staged != PID_STAGED_STOP :
+              pids[pin-A0].staged == PID_STAGED_START)) {
+            PRINT("ARC - no control loop on pin #%d\n", pin);
+            reply_type = TYPE_AIO_PIN_PID_SETPOINT_FAIL;
+        } else {
+            pids[pin-A0].setpoint = msg->value;
+            reply_type = TYPE_AIO_PIN_PID_SETPOINT_SUCCESS;
+        }
+    } else if (msg->type == TYPE_AIO_PIN_PID_STOP) {
+        if (pin < A0 || pin > A5) {
+            PRINT("ARC - pin #%d out of range\n", pin);
+            reply_type = TYPE_AIO_PIN_PID_STOP_FAIL;
+        } else {
+            pid_stop(pin-A0);
+            reply_type = TYPE_AIO_PIN_PID_STOP_SUCCESS;
+        }
+    } else if (msg->type == TYPE_AIO_PIN_GET_SUPPRESSED) {
+        if (pin < A0 || pin > A5) {
+            PRINT("ARC - pin #%d out of range\n", pin);
+            reply_type = TYPE_AIO_PIN_GET_SUPPRESSED_FAIL;
+        } else {
+            reply_type = TYPE_AIO_PIN_GET_SUPPRESSED_SUCCESS;
+            // a subscription the main loop hasn't applied yet starts at 0
+            reply_value = filter_settings[pin-A0].pending ? 0 :
+                          filters[pin-A0].suppressed;
+        }
+    } else if (msg->type == TYPE_AIO_PIN_STREAM_START) {
+        if (pin < A0 || pin > A5 ||
+            !stream_start(pin, msg->value, msg->param)) {
+            PRINT("ARC - can't stream pin #%d\n", pin);
+            reply_type = TYPE_AIO_PIN_STREAM_START_FAIL;
+        } else {
+            reply_type = TYPE_AIO_PIN_STREAM_START_SUCCESS;
+        }
+    } else if (msg->type == TYPE_AIO_PIN_STREAM_STOP) {
+        if (pin < A0 || pin > A5) {
+            PRINT("ARC - pin #%d out of range\n", pin);
+            reply_type = TYPE_AIO_PIN_STREAM_STOP_FAIL;
+        } else {
+            streams[pin-A0].block_size = 0;
+            reply_type = TYPE_AIO_PIN_STREAM_STOP_SUCCESS;
+        }
     } else {
         PRINT("ARC - Unsupported message id %d\n", id);
     }
 
-    ipm_send_msg(MSG_ID_AIO, msg->block, reply_type, pin, reply_value);
+    if (ipm_send_msg(MSG_ID_AIO, msg->block, msg->id, reply_type, pin,
+                     reply_value, reply_param) != 0) {
+        PRINT("ARC - couldn't reply to message type %d\n", msg->type);
+    }
+
+    // the request may have opened a pin or changed its schedule
+    nano_isr_sem_give(&loop_sem);
 }
 
 #ifdef CONFIG_MICROKERNEL
@@ -167,28 +1273,78 @@ void main(void)
     adc_dev = device_get_binding(ADC_DEVICE_NAME);
     adc_enable(adc_dev);
 
+    nano_sem_init(&adc_sem);
+    nano_sem_init(&scan_sem);
+    nano_sem_init(&loop_sem);
+    task_fiber_start(adc_fiber_stack, ADC_FIBER_STACK_SIZE, adc_fiber, 0, 0,
+                     ADC_FIBER_PRIORITY, 0);
+
     while (1) {
         /*
-         * mainloop just reads all the values from all ADC pins
-         * and stores them in the array
+         * mainloop reads the ADC channels that are due in a single sequence,
+         * stores the values in the array, and reports the subscribed ones
+         * that pass their change filter to x86 in one message
          */
-        for (int i=0; i<=5; i++) {
-            pin_values[i] = pin_read(i+A0);
-            if (pin_send_updates[i]) {
-                ipm_send_msg(MSG_ID_AIO, 0, TYPE_AIO_PIN_EVENT_VALUE_CHANGE,
-                              i+A0, pin_values[i]);
-                task_sleep(10);
-            }
+        uint32_t now = sys_cycle_get_32();
+        uint8_t mask = 0;
+        uint32_t reads_end;
+        uint8_t reads = read_collect(&reads_end);
+        uint8_t due = job_collect_due(now);
+        if (due | reads)
+            mask = pin_scan(due | reads);
+        if (reads)
+            read_reply(reads_end, scan_ok);
+        uint8_t updates = 0;
+        for (int i=0; i<ZJS_AIO_CHANNELS; i++) {
+            if (!pin_send_updates[i])
+                continue;
+            bool changed = (mask & (1 << i)) && filter_change(i);
+            if (changed || (pending_updates & (1 << i)))
+                updates |= 1 << i;
+        }
+
+        if (updates) {
+            // if x86 is out of credits, these go again on a later pass with
+            //   whatever their values are by then
+            pending_updates = ipm_send_scan(updates) == 0 ? 0 : updates;
+        }
 
-            /* FIX BUG
-             * read value will read the old value
-             * from the previous pin when switching pins
-             * too fast, adding a sleep fix this issue
-             */
-            task_sleep(1);
+        // control loops step on each new reading of their channel
+        bool waiting = pending_updates != 0;
+        for (int i=0; i<ZJS_AIO_CHANNELS; i++) {
+            pid_apply(i);
+            if (!pids[i].running)
+                continue;
+            if (mask & (1 << i))
+                pid_step(i);
+            pid_send(i);
+            if (pids[i].pending)
+                waiting = true;
         }
 
-        task_sleep(SLEEPTICKS);
+        /*
+         * stream blocks go out in the order the ADC fiber captured them; a
+         * block x86 isn't ready for waits and, like updates and outputs
+         * held back for credits, is tried again each tick until it goes
+         */
+        for (int n=0; n<2; n++) {
+            struct stream_buffer *buf = &stream_buffers[stream_send_next];
+            if (!buf->ready)
+                break;
+            if (!stream_send(buf)) {
+                waiting = true;
+                break;
+            }
+            buf->ready = false;
+            stream_send_next ^= 1;
+            nano_task_sem_give(&adc_sem);
+        }
+
+        // a doorbell the mailbox was too busy for is rung again from here
+        if (zjs_ipm_flush())
+            waiting = true;
+
+        job_sleep(sys_cycle_get_32(), waiting);
     }
 
     adc_disable(adc_dev);
@@ -3,7 +3,9 @@
 // Sample code for showing how to to read raw input value from the analog
 // pins on the Arduino 101, specifically A0 and A1, which is mapped
 // to pin 10 and pin 11 on Zephyr, where one is doing a synchronous
-// read and the other does it asynchronously
+// read and the other does it asynchronously, then checks the value
+// cached from that read without waiting on the sensor core, and shows
+// the traffic between the cores now and then
 
 // import aio module
 var aio = require("aio");
@@ -28,3 +30,19 @@ setInterval(function () {
         print("PinB - raw value is: " + rawValue);
     });
 }, 1000);
+
+setInterval(function () {
+    var cached = pinB.readCached();
+    if (cached !== null) {
+        print("PinB - last known value is: " + cached);
+    }
+}, 250);
+
+setInterval(function () {
+    var stats = aio.getIpmStats();
+    print("IPM - x86 sent " + stats.x86.sent + ", retried " +
+          stats.x86.retried + ", dropped " + stats.x86.dropped);
+    print("IPM - ARC sent " + stats.arc.sent + ", retried " +
+          stats.arc.retried + ", dropped " + stats.arc.dropped +
+          ", ring high water " + stats.arc.highWater);
+}, 10000);
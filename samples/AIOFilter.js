@@ -0,0 +1,18 @@
+// Copyright (c) 2016, Intel Corporation.
+
+// Sample code showing how to have the sensor core smooth and decimate an
+// analog input, A0 (pin 10 on Zephyr), so that JS only sees one filtered
+// value, plus the min, max and RMS of the raw readings, per window
+
+// import aio module
+var aio = require("aio");
+
+var pin = aio.open({ device: 0, pin: 10 });
+
+// average the last 16 scans and report every 10th result
+pin.setFilter({ average: "boxcar", window: 16, decimate: 10, stats: true });
+
+pin.on("stats", function (stats) {
+    print("A0 - value: " + stats.value + " min: " + stats.min +
+          " max: " + stats.max + " rms: " + stats.rms);
+});
@@ -0,0 +1,30 @@
+// Copyright (c) 2016, Intel Corporation.
+
+// Sample code showing how to have the sensor core hold an analog input, A0
+// (pin 10 on Zephyr), at a setpoint by driving the PWM on IO3, for example a
+// light sensor next to an LED. The loop runs natively at 100Hz; JS only picks
+// the setpoint and watches telemetry.
+
+// import aio and pwm modules
+var aio = require("aio");
+var pwm = require("pwm");
+var pins = require("arduino101_pins");
+
+var sensor = aio.open({ device: 0, pin: 10 });
+var led = pwm.open({ channel: pins.IO3, period: 1 });
+
+// gains are in fractions of full duty per ADC unit of error
+var loop = sensor.pid(led, { setpoint: 2000, kp: 0.0002, ki: 0.01,
+                             rateHz: 100, telemetryEvery: 100 });
+
+loop.on("telemetry", function (t) {
+    print("A0 - input: " + t.input + " setpoint: " + t.setpoint +
+          " duty: " + Math.round(t.output * 100) + "%");
+});
+
+// alternate between a dim and a bright target every 5s
+var bright = false;
+setInterval(function () {
+    bright = !bright;
+    loop.setSetpoint(bright ? 3000 : 1000);
+}, 5000);
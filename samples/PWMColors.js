@@ -0,0 +1,38 @@
+// Copyright (c) 2016, Intel Corporation.
+
+// Test code for Arduino 101 that runs an RGB LED, wired through resistors to
+// the PWMs on IO3 (red), IO5 (green) and IO6 (blue), around the colour
+// wheel. All three channels are set with one setChannels call, so the LED
+// never shows a mix of the old and new colours.
+print("PWM test for setting channels together...");
+
+// import pwm module
+var pwm = require("pwm");
+var pins = require("arduino101_pins");
+
+var red = pins.IO3, green = pins.IO5, blue = pins.IO6;
+pwm.open({channel: red, period: 1});
+pwm.open({channel: green, period: 1});
+pwm.open({channel: blue, period: 1});
+
+function level(hue) {
+    // brightness of one colour, for a hue from 0 to 6
+    hue = (hue + 6) % 6;
+    if (hue < 1)
+        return hue;
+    if (hue < 3)
+        return 1;
+    if (hue < 4)
+        return 4 - hue;
+    return 0;
+}
+
+var hue = 0;
+setInterval(function () {
+    hue = (hue + 0.05) % 6;
+    pwm.setChannels([
+        {channel: red, dutyCycle: level(hue + 2)},
+        {channel: green, dutyCycle: level(hue)},
+        {channel: blue, dutyCycle: level(hue - 2)}
+    ]);
+}, 20);
@@ -0,0 +1,32 @@
+// Copyright (c) 2016, Intel Corporation.
+
+// Test code for Arduino 101 that breathes an LED on IO3 with native fades,
+// using the gamma curve so the brightness changes look even, and ramps an
+// LED on IO5 through a looping sequence of keyframes. Each breath is started
+// from the fadeEnd event, with no JS running while the LED is fading.
+print("PWM test for fades...");
+
+// import pwm module
+var pwm = require("pwm");
+var pins = require("arduino101_pins");
+
+// a 1ms period is fast enough that the LEDs don't flicker
+var led0 = pwm.open({channel: pins.IO3, period: 1});
+var led1 = pwm.open({channel: pins.IO5, period: 1});
+
+var up = true;
+led0.on("fadeEnd", function () {
+    up = !up;
+    this.fade({to: up ? 1 : 0, durationMs: 1500, curve: "gamma"});
+});
+led0.fade({to: 1, durationMs: 1500, curve: "gamma"});
+
+// quick flash, slow fade out, then a pause, forever
+led1.fade({
+    keyframes: [
+        {to: 1, durationMs: 100},
+        {to: 0, durationMs: 900, curve: "gamma"},
+        {to: 0, durationMs: 1000}
+    ],
+    repeat: 0
+});
@@ -0,0 +1,35 @@
+// Copyright (c) 2016, Intel Corporation.
+
+// Sample code showing how to connect inputs to outputs natively, with no JS
+// running per sample: a potentiometer on A0 (pin 10 on Zephyr) sets the
+// brightness of an LED on IO3, and LED0 blinks from a timer
+
+// import modules
+var aio = require("aio");
+var gpio = require("gpio");
+var pwm = require("pwm");
+var pipe = require("pipe");
+var pins = require("arduino101_pins");
+
+var pot = aio.open({ device: 0, pin: 10 });
+var led = pwm.open({ channel: pins.IO3, period: 1 });
+var blinker = gpio.open({ pin: pins.LED0 });
+
+// keep the LED from going fully dark, and ignore 4-count ADC noise
+var dimmer = pipe.create({
+    source: { aio: pot, deadband: 4 },
+    transforms: [ { type: "scale", factor: 0.9, offset: 400 } ],
+    sink: { pwm: led, min: 0, max: 4095 }
+});
+
+// step through an on/off pattern every 250ms
+var blink = pipe.create({
+    source: { timer: 250 },
+    transforms: [ { type: "map", table: [1, 0, 1, 0, 0, 0], wrap: true } ],
+    sink: { gpio: blinker }
+});
+
+setInterval(function () {
+    var stats = dimmer.getStats();
+    print("dimmer - inputs: " + stats.inputs + " writes: " + stats.outputs);
+}, 10000);
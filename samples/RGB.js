@@ -20,9 +20,10 @@ var pins = require("arduino101_pins");
 // LED0 is an onboard LED on the Arduino101
 var led = gpio.open({pin: pins.LED0, direction: 'out'});
 
-var red = gpio.open({pin: pins.IO2, direction: 'out'});
-var green = gpio.open({pin: pins.IO7, direction: 'out'});
-var blue = gpio.open({pin: pins.IO8, direction: 'out'});
+// open the three color pins as a group so they change at the same time;
+//   bit 0 is red, bit 1 is green, bit 2 is blue
+var rgb = gpio.openGroup({pins: [pins.IO2, pins.IO7, pins.IO8],
+                          direction: 'out'});
 
 var count = 0;
 
@@ -30,7 +31,5 @@ var count = 0;
 setInterval(function () {
     count += 1;
     led.write(count & 1 ? true:false);
-    red.write(count & 2 ? true:false);
-    green.write(count & 4 ? true:false);
-    blue.write(count & 8 ? true:false);
+    rgb.write(count >> 1);
 }, 500);
@@ -0,0 +1,25 @@
+// Copyright (c) 2016, Intel Corporation.
+
+// Test code for Arduino 101 that sweeps a hobby servo on IO3 back and forth
+// through its full range, and holds a second one on IO5 at a pulse width
+// given in microseconds. The servo's control wire goes to the pin, and its
+// power should come from a separate 5V supply sharing the board's ground.
+print("PWM test for servos...");
+
+// import pwm module
+var pwm = require("pwm");
+var pins = require("arduino101_pins");
+
+// most servos take 1000us to 2000us pulses; wider ones may need 500-2500
+var sweeper = pwm.openServo({channel: pins.IO3, minUs: 1000, maxUs: 2000});
+var holder = pwm.openServo({channel: pins.IO5});
+holder.writeMicroseconds(1500);
+
+var angle = 0;
+var step = 2;
+setInterval(function () {
+    angle += step;
+    if (angle <= 0 || angle >= 180)
+        step = -step;
+    sweeper.write(angle);
+}, 20);
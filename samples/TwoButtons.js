@@ -16,8 +16,10 @@ var pins = require("arduino101_pins");
 // pins 8 (LED0) and 12 (LED1) are onboard LEDs on Arduino 101
 var led1 = gpio.open({ pin: pins.LED0, activeLow: false });
 var led2 = gpio.open({ pin: pins.LED1, activeLow: true });
-var btn1 = gpio.open({ pin: pins.IO3, direction: 'in', edge: 'any' });
-var btn2 = gpio.open({ pin: pins.IO4, direction: 'in', edge: 'any' });
+var btn1 = gpio.open({ pin: pins.IO3, direction: 'in', edge: 'any',
+                      debounce: 20 });
+var btn2 = gpio.open({ pin: pins.IO4, direction: 'in', edge: 'any',
+                      debounce: 20 });
 
 // turn off LED #2 initially
 led2.write(false);
@@ -0,0 +1,41 @@
+// Copyright (c) 2016, Intel Corporation.
+
+// Sample code for Arduino 101 that plays a precisely timed pulse train on IO2
+// from the always-on timer's interrupt: five 1ms pulses 1ms apart, followed
+// by a 10ms gap, 500 times over, for about 10 seconds. Each step in the
+// waveform buffer is 8 bytes: a 32-bit port mask, a level byte, and a 24-bit
+// delay in microseconds.
+
+var gpio = require("gpio");
+var pins = require("arduino101_pins");
+
+var out = gpio.open({ pin: pins.IO2, direction: 'out' });
+
+function addStep(buf, index, pin, level, us) {
+    var offset = index * 8;
+    var mask = 1 << pin;
+    for (var i = 0; i < 4; i++)
+        buf.writeUInt8((mask >> (i * 8)) & 0xff, offset + i);
+    buf.writeUInt8(level ? 1 : 0, offset + 4);
+    for (var i = 0; i < 3; i++)
+        buf.writeUInt8((us >> (i * 8)) & 0xff, offset + 5 + i);
+}
+
+var steps = new Buffer(10 * 8);
+for (var i = 0; i < 5; i++) {
+    addStep(steps, i * 2, pins.IO2, true, 1000);
+    addStep(steps, i * 2 + 1, pins.IO2, false, i == 4 ? 10000 : 1000);
+}
+
+var wave = gpio.createWaveform(steps);
+
+wave.on('underrun', function (count) {
+    print("waveform fell behind " + count + " times");
+});
+
+wave.on('complete', function (underruns) {
+    print("waveform done with " + underruns + " underruns");
+});
+
+// each pass takes 19ms
+wave.play(500);
@@ -1,7 +1,9 @@
 // Copyright (c) 2016, Intel Corporation.
 
 // Test code for Arduino 101 that replicates the WebBluetooth demo
-// using BLE to advertise temperature changes and allow LED color changes
+// using BLE to advertise temperature changes and allow LED color changes;
+// both characteristics keep their values with setValue, so reads are
+// answered natively without waiting on JS
 
 // import aio and ble module
 var aio = require("aio");
@@ -17,22 +19,15 @@ var TemperatureCharacteristic = new ble.Characteristic({
     value: null
 });
 
-TemperatureCharacteristic._lastValue = undefined;
 TemperatureCharacteristic._onChange = null;
+TemperatureCharacteristic.setValue(new Buffer(1));
 
 var pinA0 = aio.open({ device: 0, pin: 10 });
 
-TemperatureCharacteristic.onReadRequest = function(offset, callback) {
-    var data = new Buffer(1);
-    data.writeUInt8(this._lastValue);
-    callback(this.RESULT_SUCCESS, data);
-};
-
 TemperatureCharacteristic.onSubscribe = function(maxValueSize,
                                                  updateValueCallback) {
     print("Subscribed to temperature change.");
     this._onChange = updateValueCallback;
-    this._lastValue = undefined;
 };
 
 TemperatureCharacteristic.onUnsubscribe = function() {
@@ -41,10 +36,9 @@ TemperatureCharacteristic.onUnsubscribe = function() {
 };
 
 TemperatureCharacteristic.valueChange = function(value) {
-    this._lastValue = value;
-
     var data = new Buffer(1);
     data.writeUInt8(value);
+    this.setValue(data);
 
     if (this._onChange) {
         this._onChange(data);
@@ -58,10 +52,11 @@ var ColorCharacteristic = new ble.Characteristic({
 });
 
 // default color
-ColorCharacteristic._value = new Buffer(3);
-ColorCharacteristic._value.writeUInt8(255, 0);
-ColorCharacteristic._value.writeUInt8(0, 1);
-ColorCharacteristic._value.writeUInt8(0, 2);
+var defaultColor = new Buffer(3);
+defaultColor.writeUInt8(255, 0);
+defaultColor.writeUInt8(0, 1);
+defaultColor.writeUInt8(0, 2);
+ColorCharacteristic.setValue(defaultColor);
 ColorCharacteristic.ledR = pwm.open({channel: pins.IO3, period: 0.256,
                                      pulseWidth: 0.128});
 ColorCharacteristic.ledG = pwm.open({channel: pins.IO5, period: 0.256,
@@ -69,11 +64,6 @@ ColorCharacteristic.ledG = pwm.open({channel: pins.IO5, period: 0.256,
 ColorCharacteristic.ledB = pwm.open({channel: pins.IO6, period: 0.256,
                                      pulseWidth: 0});
 
-ColorCharacteristic.onReadRequest = function(offset, callback) {
-    print("led value: " + this._value.toString('hex'));
-    callback(this.RESULT_SUCCESS, this._value);
-};
-
 ColorCharacteristic.onWriteRequest = function(data, offset, withoutResponse,
                                               callback) {
     var value = data;
@@ -83,15 +73,16 @@ ColorCharacteristic.onWriteRequest = function(data, offset, withoutResponse,
         return;
     }
 
-    this._value = value;
-    if (this._value.length !== 3) {
+    if (value.length !== 3) {
         callback(this.RESULT_INVALID_ATTRIBUTE_LENGTH);
         return;
     }
 
-    this.ledR.setPulseWidth(this._value.readUInt8(0) / 1000);
-    this.ledG.setPulseWidth(this._value.readUInt8(1) / 1000);
-    this.ledB.setPulseWidth(this._value.readUInt8(2) / 1000);
+    this.setValue(value);
+    print("led value: " + value.toString('hex'));
+    this.ledR.setPulseWidth(value.readUInt8(0) / 1000);
+    this.ledG.setPulseWidth(value.readUInt8(1) / 1000);
+    this.ledB.setPulseWidth(value.readUInt8(2) / 1000);
     callback(this.RESULT_SUCCESS);
 };
 
@@ -136,7 +127,7 @@ ble.on('accept', function(clientAddress) {
 
         print("Temperature change " + celsius);
         TemperatureCharacteristic.valueChange(celsius);
-    });
+    }, { deadband: 4, hysteresis: 2, minIntervalMs: 1000 });
 });
 
 ble.on('disconnect', function(clientAddress) {
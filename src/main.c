@@ -15,6 +15,7 @@
 #include "zjs_buffer.h"
 #include "zjs_gpio.h"
 #include "zjs_modules.h"
+#include "zjs_pipe.h"
 #include "zjs_pwm.h"
 #include "zjs_timers.h"
 #include "zjs_util.h"
@@ -39,6 +40,7 @@ void main(int argc, char *argv[])
     zjs_modules_add("aio", zjs_aio_init);
     zjs_modules_add("ble", zjs_ble_init);
     zjs_modules_add("gpio", zjs_gpio_init);
+    zjs_modules_add("pipe", zjs_pipe_init);
     zjs_modules_add("pwm", zjs_pwm_init);
     zjs_modules_add("arduino101_pins", zjs_a101_init);
 
@@ -1,16 +1,17 @@
 // Copyright (c) 2016, Intel Corporation.
 
 // Zephyr includes
+#include <zephyr.h>
 #include <misc/util.h>
 #include <string.h>
 
 // ZJS includes
 #include "zjs_aio.h"
+#include "zjs_buffer.h"
 #include "zjs_ipm.h"
+#include "zjs_pwm.h"
 #include "zjs_util.h"
 
-DEFINE_SEMAPHORE(SEM_AIO_BLOCK);
-
 /*
  * The analog input pin and channel number mapping
  * for Arduino 101 board.
@@ -28,176 +29,754 @@ DEFINE_SEMAPHORE(SEM_AIO_BLOCK);
 #define A4 14
 #define A5 15
 
-static uint32_t pin_values[6] = {};
+// ticks to wait for ARC to reply to a request
+#define ZJS_AIO_REQUEST_TIMEOUT 500
+
+// most requests to ARC awaiting replies at once
+#define ZJS_AIO_MAX_REQUESTS 16
+#define ZJS_AIO_REQUEST_SLOT_MASK 0x0F
+#define ZJS_AIO_REQUEST_GEN_SHIFT 4
+
+// async reads each pin may have outstanding
+#define ZJS_AIO_READ_SLOTS 4
+
+// An async read waiting for ARC's reply; these come from a fixed pool per
+//   pin so read_async never allocates.
+struct zjs_aio_read {
+    struct zjs_callback zjs_cb;
+    bool in_use;                // only changed from task context
+    volatile bool success;
+    volatile bool timed_out;    // ARC didn't reply in time
+    volatile uint32_t value;    // raw, so the ISR needs no FPU
+};
+
+static struct zjs_aio_read zjs_aio_reads[ZJS_AIO_CHANNELS][ZJS_AIO_READ_SLOTS];
+
+// the last value ARC reported for each pin, whatever the reason it sent it
+static volatile uint32_t pin_cache[ZJS_AIO_CHANNELS] = {};
+static volatile bool pin_cache_valid[ZJS_AIO_CHANNELS] = {};
 
-struct zjs_cb_list_item {
-    char event_type[20];
+// Every request to ARC takes a slot here until its reply arrives, and its id
+//   carries the slot index plus the slot's generation, so a late reply to a
+//   request that already timed out can't complete a newer one in that slot.
+//   Synchronous callers wait on their own slot's semaphore; async reads
+//   name the read the reply should go to, and the expiry fiber fails them
+//   and frees their slots if no reply comes by their deadline.
+struct zjs_aio_request {
+    struct nano_sem sem;
+    volatile bool in_use;
+    uint8_t id;
+    uint8_t generation;
+    uint32_t deadline;              // tick count an async read gives up at
+    volatile uint32_t reply_type;
+    volatile uint32_t reply_value;
+    volatile uint32_t reply_param;
+    struct zjs_aio_read *read;      // async read to complete, or NULL
+};
+
+static struct zjs_aio_request zjs_aio_requests[ZJS_AIO_MAX_REQUESTS] = {};
+
+#define ZJS_AIO_EXPIRE_STACK_SIZE 512
+#define ZJS_AIO_EXPIRE_PRIORITY 1
+
+static struct nano_sem zjs_aio_expire_sem;
+static char __stack zjs_aio_expire_stack[ZJS_AIO_EXPIRE_STACK_SIZE];
+static bool zjs_aio_expire_fiber_started = false;
+
+// default number of samples per streaming block
+#define ZJS_AIO_STREAM_DEFAULT_BLOCK 32
+
+// Streamed samples arrive from ARC a few at a time in interrupt context, so
+//   each streaming pin has two native buffers: the ISR fills one while the
+//   other holds the last complete block until the JS callback takes it. The
+//   IPM credits of both blocks are held until JS is done with them, so ARC
+//   waits rather than send a third block there's no room for.
+struct zjs_aio_stream {
     jerry_object_t *pin_obj;
     struct zjs_callback zjs_cb;
-    double value;
-    struct zjs_cb_list_item *next;
+    uint32_t block_size;    // samples per block, 0 if not streaming
+    uint16_t *fill;         // block being received
+    uint16_t *ready;        // complete block waiting for the JS callback
+    uint32_t count;         // samples received into fill so far
+    uint32_t timestamp;     // ARC hw cycle count when the ready block started
+    uint32_t sequence;      // block number of the ready block
+    uint32_t overruns;      // samples lost on ARC between blocks
+    uint32_t dropped;       // blocks dropped incomplete
+    uint32_t fill_held;     // IPM credits held for the fill block
+    uint32_t ready_held;    // IPM credits held for the ready block
+    volatile bool pending;  // ready holds a block not yet passed to JS
+    volatile bool full;     // fill is complete and waiting behind ready
+    struct zjs_ipm_stream_end_message fill_end; // end message of a full fill
+};
+
+static struct zjs_aio_stream zjs_aio_streams[ZJS_AIO_CHANNELS] = {};
+
+// Native listener state for one channel, indexed by pin - A0 so the IPM ISR
+//   finds it without walking a list or asking the engine for properties. A
+//   listener is queued at most once; if more values arrive before it runs,
+//   it just reports the latest. The event that queued it keeps its IPM
+//   credit until the JS callback returns.
+struct zjs_aio_listener {
+    struct zjs_callback zjs_cb;
+    volatile bool queued;
+    volatile bool held;     // holding an IPM credit
+};
+
+struct zjs_aio_channel {
+    struct zjs_aio_listener change;
+    volatile uint32_t change_value;
+    zjs_aio_tap_t tap;          // native code fed every change, from the ISR
+    void *tap_context;
+    struct zjs_aio_listener stats;
+    struct zjs_ipm_stats_message stats_value;
+};
+
+static struct zjs_aio_channel zjs_aio_channels[ZJS_AIO_CHANNELS] = {};
+
+// default rate of a control loop, and its default telemetry interval in
+//   outputs when it has a telemetry listener
+#define ZJS_AIO_PID_DEFAULT_RATE 100
+#define ZJS_AIO_PID_DEFAULT_TELEMETRY 10
+
+// the fiber that applies control loop outputs; fibers preempt the task
+//   that runs JS, so an output waits only for the ISR that delivered it
+#define ZJS_AIO_PID_STACK_SIZE 512
+#define ZJS_AIO_PID_PRIORITY 0
+
+// A control loop runs on ARC, which sends each output here; the IPM ISR
+//   records it and wakes the fiber that writes it to the PWM channel, so
+//   the ISR stays short and a burst of outputs costs one write. JS sees
+//   only the outputs ARC marks for telemetry.
+struct zjs_aio_pid {
+    struct zjs_pwm_output output;
+    uint32_t period_us;
+    double kp, ki, kd;              // as given, per second
+    volatile bool running;
+    volatile bool dirty;            // duty is new since the fiber last ran
+    volatile uint16_t duty;
+    uint32_t applied;               // outputs written to the PWM channel
+    struct zjs_aio_listener telemetry;
+    struct zjs_ipm_pid_message telemetry_value;
+    jerry_object_t *loop_obj;
 };
 
-static struct zjs_cb_list_item *zjs_cb_list = NULL;
+static struct zjs_aio_pid zjs_aio_pids[ZJS_AIO_CHANNELS] = {};
+static struct nano_sem zjs_aio_pid_sem;
+static char __stack zjs_aio_pid_stack[ZJS_AIO_PID_STACK_SIZE];
+static bool zjs_aio_pid_fiber_started = false;
 
-static struct zjs_cb_list_item *zjs_aio_callback_alloc()
+static bool zjs_aio_listener_queue(struct zjs_aio_listener *listener,
+                                   bool hold)
 {
-    // effects: allocates a new callback list item and adds it to the list
-    struct zjs_cb_list_item *item;
-    item = task_malloc(sizeof(struct zjs_cb_list_item));
-    if (!item) {
-        PRINT("error: out of memory allocating callback struct\n");
-        return NULL;
-    } else {
-        memset(item, 0, sizeof(struct zjs_cb_list_item));
+    // requires: called from the IPM ISR
+    //  effects: queues the listener's callback unless it's already queued
+    //             or there's no JS callback to call, and if hold is set,
+    //             keeps the event's IPM credit until it has run; returns
+    //             true if it was queued
+    if (listener->zjs_cb.js_callback && !listener->queued) {
+        listener->queued = true;
+        if (hold)
+            listener->held = zjs_ipm_hold();
+        zjs_queue_callback(&listener->zjs_cb);
+        return true;
     }
+    return false;
+}
 
-    item->next = zjs_cb_list;
-    zjs_cb_list = item;
-    return item;
+static bool zjs_aio_listener_dequeue(struct zjs_aio_listener *listener)
+{
+    // requires: called only from task context, when the listener's callback
+    //             runs
+    //  effects: lets the ISR queue the listener again; returns true if it
+    //             was holding an IPM credit, for the caller to release
+    //             once it has called JS
+    int key = irq_lock();
+    bool held = listener->held;
+    listener->held = false;
+    listener->queued = false;
+    irq_unlock(key);
+    return held;
 }
 
-static void zjs_aio_callback_free(uintptr_t handle)
+static void zjs_aio_call_function(struct zjs_callback *cb)
 {
-    // requires: handle is the native pointer we registered with
-    //             jerry_set_object_native_handle
-    //  effects: frees the callback list item for the given pin object
-    struct zjs_cb_list_item **pItem = &zjs_cb_list;
-    while (*pItem) {
-        if ((uintptr_t)*pItem == handle) {
-            *pItem = (*pItem)->next;
-            task_free((void *)handle);
-        }
-        pItem = &(*pItem)->next;
+    // requires: called only from task context
+    //  effects: handles execution of the JS callback when ready, then returns
+    //             the read to its pin's pool
+    struct zjs_aio_read *read = CONTAINER_OF(cb, struct zjs_aio_read, zjs_cb);
+    if (read->timed_out) {
+        PRINT("error: async read timed out\n");
+    } else if (read->success) {
+        jerry_value_t arg = jerry_create_number_value(read->value);
+        jerry_value_t rval = jerry_call_function(read->zjs_cb.js_callback,
+                                                 NULL, &arg, 1);
+        if (!jerry_value_is_error(rval))
+            jerry_release_value(rval);
+    } else {
+        PRINT("error: ARC failed an async read\n");
     }
+    jerry_release_object(read->zjs_cb.js_callback);
+    read->zjs_cb.js_callback = NULL;
+    read->in_use = false;
 }
 
-struct zjs_cb_list_item *zjs_aio_get_callback_item(uint32_t pin, const char *event_type)
+static void zjs_aio_emit_event(struct zjs_callback *cb)
 {
-    // calls the JS callback registered in the struct
-    struct zjs_cb_list_item **pItem = &zjs_cb_list;
-    while (*pItem) {
-        jerry_object_t *obj = (*pItem)->pin_obj;
-        uint32_t pin_val;
-        zjs_obj_get_uint32(obj, "pin", &pin_val);
+    // requires: called only from task context
+    //  effects: calls a 'change' listener with the pin's latest value
+    struct zjs_aio_listener *listener;
+    listener = CONTAINER_OF(cb, struct zjs_aio_listener, zjs_cb);
+    struct zjs_aio_channel *ch;
+    ch = CONTAINER_OF(listener, struct zjs_aio_channel, change);
 
-        if (pin == pin_val) {
-            if (event_type == NULL ||
-                !strcmp((*pItem)->event_type, event_type)) {
-                return (*pItem);
-            }
-        }
-        pItem = &(*pItem)->next;
+    // values arriving from here on need another call
+    bool held = zjs_aio_listener_dequeue(listener);
+    if (cb->js_callback) {
+        jerry_value_t arg = jerry_create_number_value((double)ch->change_value);
+        jerry_value_t rval = jerry_call_function(cb->js_callback, NULL, &arg,
+                                                 1);
+        if (!jerry_value_is_error(rval))
+            jerry_release_value(rval);
     }
 
-    return NULL;
+    if (held)
+        zjs_ipm_release(1);
 }
 
-static void zjs_aio_call_function(struct zjs_callback *cb)
+static void zjs_aio_emit_stats(struct zjs_callback *cb)
 {
     // requires: called only from task context
-    //  effects: handles execution of the JS callback when ready
-    struct zjs_cb_list_item *mycb = CONTAINER_OF(cb, struct zjs_cb_list_item,
-                                                 zjs_cb);
-    jerry_value_t arg = jerry_create_number_value(mycb->value);
-    jerry_value_t rval = jerry_call_function(mycb->zjs_cb.js_callback, NULL, &arg, 1);
+    //  effects: calls a 'stats' listener with an object holding the filtered
+    //             value and the min, max and RMS of the window's raw samples
+    struct zjs_aio_listener *listener;
+    listener = CONTAINER_OF(cb, struct zjs_aio_listener, zjs_cb);
+    struct zjs_aio_channel *ch;
+    ch = CONTAINER_OF(listener, struct zjs_aio_channel, stats);
+
+    // snapshot the stats before allowing the ISR to replace them
+    int key = irq_lock();
+    struct zjs_ipm_stats_message stats = ch->stats_value;
+    bool held = zjs_aio_listener_dequeue(listener);
+    irq_unlock(key);
+    if (!cb->js_callback) {
+        if (held)
+            zjs_ipm_release(1);
+        return;
+    }
+
+    jerry_object_t *obj = jerry_create_object();
+    zjs_obj_add_number(obj, stats.value, "value");
+    zjs_obj_add_number(obj, stats.min, "min");
+    zjs_obj_add_number(obj, stats.max, "max");
+    zjs_obj_add_number(obj, stats.rms, "rms");
+    zjs_obj_add_number(obj, stats.count, "count");
+
+    jerry_value_t arg = jerry_create_object_value(obj);
+    jerry_value_t rval = jerry_call_function(cb->js_callback, NULL, &arg, 1);
     if (!jerry_value_is_error(rval))
         jerry_release_value(rval);
-    jerry_release_object(mycb->zjs_cb.js_callback);
-    zjs_aio_callback_free((uintptr_t)mycb);
+    jerry_release_value(arg);
+
+    if (held)
+        zjs_ipm_release(1);
 }
 
-static void zjs_aio_emit_event(struct zjs_callback *cb)
+static void zjs_aio_emit_telemetry(struct zjs_callback *cb)
 {
-    struct zjs_cb_list_item *mycb = CONTAINER_OF(cb, struct zjs_cb_list_item,
-                                                 zjs_cb);
-    jerry_value_t arg = jerry_create_number_value(mycb->value);
-    jerry_value_t rval = jerry_call_function(mycb->zjs_cb.js_callback, NULL, &arg, 1);
+    // requires: called only from task context
+    //  effects: calls a control loop's 'telemetry' listener with an object
+    //             holding the latest marked output: the input, setpoint and
+    //             error in ADC units, the output as a fraction of full duty,
+    //             the output's sequence number, and how many outputs have
+    //             been written to the PWM channel
+    struct zjs_aio_listener *listener;
+    listener = CONTAINER_OF(cb, struct zjs_aio_listener, zjs_cb);
+    struct zjs_aio_pid *pid;
+    pid = CONTAINER_OF(listener, struct zjs_aio_pid, telemetry);
+
+    int key = irq_lock();
+    struct zjs_ipm_pid_message out = pid->telemetry_value;
+    bool held = zjs_aio_listener_dequeue(listener);
+    irq_unlock(key);
+    if (!cb->js_callback) {
+        if (held)
+            zjs_ipm_release(1);
+        return;
+    }
+
+    jerry_object_t *obj = jerry_create_object();
+    zjs_obj_add_number(obj, out.input, "input");
+    zjs_obj_add_number(obj, (int32_t)out.input + out.error, "setpoint");
+    zjs_obj_add_number(obj, out.error, "error");
+    zjs_obj_add_number(obj, (double)out.output / ZJS_AIO_PID_DUTY_MAX,
+                       "output");
+    zjs_obj_add_number(obj, out.sequence, "sequence");
+    zjs_obj_add_number(obj, pid->applied, "applied");
+
+    jerry_value_t arg = jerry_create_object_value(obj);
+    jerry_value_t rval = jerry_call_function(cb->js_callback, pid->loop_obj,
+                                             &arg, 1);
     if (!jerry_value_is_error(rval))
         jerry_release_value(rval);
+    jerry_release_value(arg);
+
+    if (held)
+        zjs_ipm_release(1);
 }
 
-int zjs_aio_ipm_send(uint32_t type, uint32_t pin, uint32_t value) {
-    struct zjs_ipm_message msg;
-    msg.block = false;
-    msg.type = type;
-    msg.pin = pin;
-    msg.value = value;
-    return zjs_ipm_send(MSG_ID_AIO, &msg, sizeof(msg));
+static void zjs_aio_pid_fiber(int arg1, int arg2)
+{
+    // effects: writes each new control loop output to its PWM channel,
+    //            skipping to the latest if more than one arrived meanwhile
+    while (1) {
+        nano_fiber_sem_take(&zjs_aio_pid_sem, TICKS_UNLIMITED);
+        for (int i = 0; i < ZJS_AIO_CHANNELS; i++) {
+            struct zjs_aio_pid *pid = &zjs_aio_pids[i];
+            int key = irq_lock();
+            bool dirty = pid->dirty && pid->running;
+            uint16_t duty = pid->duty;
+            pid->dirty = false;
+            irq_unlock(key);
+
+            if (dirty) {
+                zjs_pwm_output_set(&pid->output, duty);
+                pid->applied++;
+            }
+        }
+    }
+}
+
+static void zjs_aio_pid_receive(volatile void *data)
+{
+    // requires: called from the IPM ISR with a control loop output
+    //  effects: hands the output to the fiber, and to JS if it's marked for
+    //             telemetry
+    struct zjs_ipm_pid_message *out = (struct zjs_ipm_pid_message *) data;
+    if (out->pin < A0 || out->pin > A5)
+        return;
+
+    struct zjs_aio_pid *pid = &zjs_aio_pids[out->pin-A0];
+    if (!pid->running)
+        return;
+
+    pid->duty = out->output;
+    pid->dirty = true;
+    nano_isr_sem_give(&zjs_aio_pid_sem);
+
+    if (out->flags & ZJS_AIO_PID_FLAG_TELEMETRY) {
+        pid->telemetry_value = *out;
+        zjs_aio_listener_queue(&pid->telemetry, true);
+    }
 }
 
-int zjs_aio_ipm_send_blocking(uint32_t type, uint32_t pin, uint32_t value) {
+static int zjs_aio_ipm_send_msg(uint32_t type, bool block, uint8_t id,
+                                uint32_t pin, uint32_t value, uint32_t param) {
     struct zjs_ipm_message msg;
-    msg.block = true;
+    msg.block = block;
+    msg.id = id;
     msg.type = type;
     msg.pin = pin;
     msg.value = value;
+    msg.param = param;
     return zjs_ipm_send(MSG_ID_AIO, &msg, sizeof(msg));
 }
 
-// callback that gets updated of latest analog value from pin
-void ipm_msg_receive_callback(void *context, uint32_t id, volatile void *data)
+int zjs_aio_ipm_send(uint32_t type, uint32_t pin, uint32_t value) {
+    return zjs_aio_ipm_send_msg(type, false, 0, pin, value, 0);
+}
+
+static struct zjs_aio_request *zjs_aio_request_alloc(
+    struct zjs_aio_read *read)
 {
-    if (id != MSG_ID_AIO)
+    // effects: claims a free request slot and gives it a fresh id and a
+    //            deadline; returns NULL if all are in use
+    int key = irq_lock();
+    for (int i = 0; i < ZJS_AIO_MAX_REQUESTS; i++) {
+        struct zjs_aio_request *req = &zjs_aio_requests[i];
+        if (req->in_use)
+            continue;
+
+        // the generation is never 0, so neither is the id
+        req->generation = (req->generation + 1) &
+            (0xff >> ZJS_AIO_REQUEST_GEN_SHIFT);
+        if (!req->generation)
+            req->generation = 1;
+        req->id = (req->generation << ZJS_AIO_REQUEST_GEN_SHIFT) | i;
+        req->read = read;
+        req->deadline = sys_tick_get_32() + ZJS_AIO_REQUEST_TIMEOUT;
+        req->in_use = true;
+        irq_unlock(key);
+
+        // drop any give from a late reply to this slot's last request
+        nano_sem_init(&req->sem);
+        return req;
+    }
+    irq_unlock(key);
+    return NULL;
+}
+
+static void zjs_aio_request_complete(struct zjs_ipm_message *msg)
+{
+    // requires: called from the IPM ISR with a reply carrying a request id
+    //  effects: completes the matching request, if it's still waiting
+    if (msg->type == TYPE_AIO_PIN_READ_SUCCESS &&
+        msg->pin >= A0 && msg->pin <= A5) {
+        pin_cache[msg->pin-A0] = msg->value;
+        pin_cache_valid[msg->pin-A0] = true;
+    }
+
+    struct zjs_aio_request *req;
+    req = &zjs_aio_requests[msg->id & ZJS_AIO_REQUEST_SLOT_MASK];
+    if (!req->in_use || req->id != msg->id) {
+        // its request timed out already
         return;
+    }
 
-    struct zjs_ipm_message *msg = (struct zjs_ipm_message *) data;
+    if (req->read) {
+        req->read->success = msg->type == TYPE_AIO_PIN_READ_SUCCESS;
+        req->read->value = msg->value;
+        zjs_queue_callback(&req->read->zjs_cb);
+        req->in_use = false;
+    } else {
+        req->reply_type = msg->type;
+        req->reply_value = msg->value;
+        req->reply_param = msg->param;
+        nano_isr_sem_give(&req->sem);
+    }
+}
 
-    if (msg->type == TYPE_AIO_OPEN_SUCCESS) {
-        PRINT("pin %lu is opened\n", msg->pin);
-    } else if (msg->type == TYPE_AIO_PIN_READ_SUCCESS) {
-        if (msg->pin < A0 || msg->pin > A5) {
-            PRINT("X86 - pin #%lu out of range\n", msg->pin);
-            return;
+static void zjs_aio_expire_fiber(int arg1, int arg2)
+{
+    // effects: fails each async read ARC hasn't replied to by its deadline
+    //            and frees its request slot, sleeping until the next
+    //            deadline, or until a read is sent when none are waiting
+    while (1) {
+        int32_t next = -1;
+        int key = irq_lock();
+        uint32_t now = sys_tick_get_32();
+        for (int i = 0; i < ZJS_AIO_MAX_REQUESTS; i++) {
+            struct zjs_aio_request *req = &zjs_aio_requests[i];
+            if (!req->in_use || !req->read)
+                continue;
+
+            int32_t left = (int32_t)(req->deadline - now);
+            if (left <= 0) {
+                req->read->success = false;
+                req->read->timed_out = true;
+                zjs_queue_callback(&req->read->zjs_cb);
+                req->in_use = false;
+            }
+            else if (next < 0 || left < next) {
+                next = left;
+            }
+        }
+        irq_unlock(key);
+
+        nano_fiber_sem_take(&zjs_aio_expire_sem,
+                            next < 0 ? TICKS_UNLIMITED : next);
+    }
+}
+
+static bool zjs_aio_call_remote(uint32_t type, uint32_t pin, uint32_t value,
+                                uint32_t param, uint32_t *reply_value,
+                                uint32_t *reply_param)
+{
+    // requires: called only from task context; type is a request whose
+    //             success reply is type + 1
+    //  effects: sends the request to ARC and waits for the reply without
+    //             holding up requests from anywhere else; returns true if ARC
+    //             replied with success, and its reply's value and param in
+    //             reply_value and reply_param, where those aren't NULL
+    struct zjs_aio_request *req = zjs_aio_request_alloc(NULL);
+    if (!req) {
+        PRINT("error: too many AIO requests in flight\n");
+        return false;
+    }
+
+    bool success = false;
+    if (zjs_aio_ipm_send_msg(type, true, req->id, pin, value, param) != 0) {
+        PRINT("error: couldn't send AIO request %lu\n", type);
+    } else if (!nano_task_sem_take(&req->sem, ZJS_AIO_REQUEST_TIMEOUT)) {
+        PRINT("Reply from ARC timed out!\n");
+    } else {
+        success = req->reply_type == type + 1;
+        if (reply_value)
+            *reply_value = req->reply_value;
+        if (reply_param)
+            *reply_param = req->reply_param;
+    }
+
+    req->in_use = false;
+    return success;
+}
+
+static void zjs_aio_stream_promote(struct zjs_aio_stream *st,
+                                   struct zjs_ipm_stream_end_message *end)
+{
+    // requires: called from the IPM ISR, or with interrupts locked; fill is
+    //             complete and ready is free
+    //  effects: makes fill the ready block, described by end, and queues it
+    //             for the JS callback
+    uint16_t *tmp = st->ready;
+    st->ready = st->fill;
+    st->fill = tmp;
+    st->timestamp = end->timestamp;
+    st->sequence = end->sequence;
+    st->overruns = end->overruns;
+    st->ready_held = st->fill_held;
+    st->fill_held = 0;
+    st->count = 0;
+    st->pending = true;
+    zjs_queue_callback(&st->zjs_cb);
+}
+
+static void zjs_aio_stream_receive(volatile void *data)
+{
+    // requires: called from the IPM ISR with a stream data or end message
+    //  effects: copies samples into the stream's fill buffer; at the end of a
+    //             block, hands it to the JS callback, or keeps it to hand
+    //             over once JS has taken the last one
+    struct zjs_ipm_stream_message *msg = (struct zjs_ipm_stream_message *) data;
+    if (msg->pin < A0 || msg->pin > A5)
+        return;
+
+    struct zjs_aio_stream *st = &zjs_aio_streams[msg->pin-A0];
+    if (!st->fill)
+        return;
+
+    if (st->full) {
+        // ARC only sends a block there's room for, unless more than one pin
+        //   is streaming; drop it, and its credits go straight back
+        if (msg->type == TYPE_AIO_PIN_EVENT_STREAM_END)
+            st->dropped++;
+        return;
+    }
+
+    if (zjs_ipm_hold())
+        st->fill_held++;
+
+    if (msg->type == TYPE_AIO_PIN_EVENT_STREAM_DATA) {
+        for (int i = 0; i < msg->count && st->count < st->block_size; i++) {
+            st->fill[st->count++] = msg->samples[i];
         }
+        return;
+    }
+
+    struct zjs_ipm_stream_end_message *end;
+    end = (struct zjs_ipm_stream_end_message *) data;
+
+    if (st->count != st->block_size) {
+        // ARC gave up part way through, or this started while full
+        st->dropped++;
+        zjs_ipm_release(st->fill_held);
+        st->fill_held = 0;
+        st->count = 0;
+    } else if (st->pending) {
+        // JS is still busy with the last block, so this one waits
+        st->fill_end = *end;
+        st->full = true;
+    } else {
+        zjs_aio_stream_promote(st, end);
+    }
+}
+
+static void zjs_aio_stream_free(struct zjs_aio_stream *st)
+{
+    // effects: releases the stream's buffers, credits and callback
+    int key = irq_lock();
+    zjs_ipm_release(st->fill_held + st->ready_held);
+    st->fill_held = 0;
+    st->ready_held = 0;
+    st->full = false;
+    irq_unlock(key);
+
+    task_free(st->fill);
+    task_free(st->ready);
+    st->fill = NULL;
+    st->ready = NULL;
+    if (st->zjs_cb.js_callback)
+        jerry_release_object(st->zjs_cb.js_callback);
+    st->zjs_cb.js_callback = NULL;
+}
+
+static void zjs_aio_stream_call_function(struct zjs_callback *cb)
+{
+    // requires: called only from task context
+    //  effects: passes the ready block to the JS callback as a Buffer of
+    //             little-endian 16-bit samples, plus an info object
+    struct zjs_aio_stream *st = CONTAINER_OF(cb, struct zjs_aio_stream,
+                                             zjs_cb);
+    if (!st->block_size) {
+        // stopped since this block was queued
+        st->pending = false;
+        zjs_aio_stream_free(st);
+        return;
+    }
 
-        if (msg->block) {
-            pin_values[msg->pin-A0] = msg->value;
+    jerry_object_t *buf_obj = zjs_buffer_create(st->block_size * 2);
+    if (buf_obj) {
+        struct zjs_buffer_t *buf = zjs_buffer_find(buf_obj);
+        for (int i = 0; i < st->block_size; i++) {
+            buf->buffer[2*i] = st->ready[i] & 0xff;
+            buf->buffer[2*i+1] = st->ready[i] >> 8;
         }
-        else {
-            struct zjs_cb_list_item *mycb = zjs_aio_get_callback_item(msg->pin, NULL);
-            if (mycb && mycb->zjs_cb.js_callback) {
-                // TODO: ensure that there is no outstanding callback of this
-                //   type or else we may be overwriting the value it should have
-                //   reported
-                mycb->value = (double)msg->value;
-                zjs_queue_callback(&mycb->zjs_cb);
+    }
+
+    jerry_object_t *info = jerry_create_object();
+    zjs_obj_add_number(info, st->timestamp, "timestamp");
+    zjs_obj_add_number(info, st->sequence, "sequence");
+    zjs_obj_add_number(info, st->overruns, "overruns");
+    zjs_obj_add_number(info, st->dropped, "dropped");
+
+    // the ISR may fill ready again from here on, and a block waiting in fill
+    //   can go next
+    int key = irq_lock();
+    uint32_t held = st->ready_held;
+    st->ready_held = 0;
+    if (st->full) {
+        st->full = false;
+        zjs_aio_stream_promote(st, &st->fill_end);
+    } else {
+        st->pending = false;
+    }
+    irq_unlock(key);
+
+    if (!buf_obj) {
+        jerry_release_object(info);
+        zjs_ipm_release(held);
+        return;
+    }
+
+    jerry_value_t args[2];
+    args[0] = jerry_create_object_value(buf_obj);
+    args[1] = jerry_create_object_value(info);
+    jerry_value_t rval = jerry_call_function(cb->js_callback, st->pin_obj,
+                                             args, 2);
+    if (jerry_value_is_error(rval)) {
+        PRINT("error: calling aio stream callback\n");
+    }
+    jerry_release_value(rval);
+    jerry_release_value(args[0]);
+    jerry_release_value(args[1]);
+
+    // only now is ARC free to send more in this block's place
+    zjs_ipm_release(held);
+}
+
+// callback that gets updated of latest analog value from pin
+void ipm_msg_receive_callback(void *context, uint32_t id, volatile void *data)
+{
+    struct zjs_ipm_message *msg = (struct zjs_ipm_message *) data;
+
+    if (msg->type == TYPE_AIO_PIN_EVENT_SCAN) {
+        struct zjs_ipm_scan_message *scan;
+        scan = (struct zjs_ipm_scan_message *) data;
+        bool held = false;
+        for (int i = 0; i < ZJS_AIO_CHANNELS; i++) {
+            if (!(scan->mask & BIT(i)))
+                continue;
+
+            pin_cache[i] = scan->values[i];
+            pin_cache_valid[i] = true;
+            if (zjs_aio_channels[i].tap) {
+                zjs_aio_channels[i].tap(zjs_aio_channels[i].tap_context,
+                                        scan->values[i]);
             }
+
+            // the message has one credit, for the first listener it queues
+            zjs_aio_channels[i].change_value = scan->values[i];
+            if (zjs_aio_listener_queue(&zjs_aio_channels[i].change, !held))
+                held = true;
         }
+        // scan events are never blocking
+        return;
+    } else if (msg->type == TYPE_AIO_PIN_EVENT_STATS) {
+        struct zjs_ipm_stats_message *stats;
+        stats = (struct zjs_ipm_stats_message *) data;
+        if (stats->pin < A0 || stats->pin > A5)
+            return;
+
+        struct zjs_aio_channel *ch = &zjs_aio_channels[stats->pin-A0];
+        pin_cache[stats->pin-A0] = stats->value;
+        pin_cache_valid[stats->pin-A0] = true;
+        ch->stats_value = *stats;
+        zjs_aio_listener_queue(&ch->stats, true);
+        return;
+    } else if (msg->type == TYPE_AIO_PIN_EVENT_STREAM_DATA ||
+               msg->type == TYPE_AIO_PIN_EVENT_STREAM_END) {
+        zjs_aio_stream_receive(data);
+        return;
+    } else if (msg->type == TYPE_AIO_PIN_EVENT_PID) {
+        zjs_aio_pid_receive(data);
+        return;
+    } else if (msg->type == TYPE_AIO_OPEN_SUCCESS) {
+        PRINT("pin %lu is opened\n", msg->pin);
     } else if (msg->type == TYPE_AIO_PIN_SUBSCRIBE_SUCCESS) {
         PRINT("subscribed to events on pin %lu\n", msg->pin);
     } else if (msg->type == TYPE_AIO_PIN_UNSUBSCRIBE_SUCCESS) {
         PRINT("unsubscribed to events on pin %lu\n", msg->pin);
     } else if (msg->type == TYPE_AIO_PIN_EVENT_VALUE_CHANGE) {
-        struct zjs_cb_list_item *mycb = zjs_aio_get_callback_item(msg->pin, "change");
-        if (mycb && mycb->zjs_cb.js_callback) {
-            mycb->value = (double)msg->value;
-            zjs_queue_callback(&mycb->zjs_cb);
-        } else {
-            PRINT("onChange event callback not found\n");
-        }
+        if (msg->pin < A0 || msg->pin > A5)
+            return;
+
+        struct zjs_aio_channel *ch = &zjs_aio_channels[msg->pin-A0];
+        pin_cache[msg->pin-A0] = msg->value;
+        pin_cache_valid[msg->pin-A0] = true;
+        ch->change_value = msg->value;
+        if (ch->tap)
+            ch->tap(ch->tap_context, msg->value);
+        zjs_aio_listener_queue(&ch->change, true);
+    } else if (msg->type == TYPE_AIO_PIN_READ_SUCCESS ||
+               msg->type == TYPE_AIO_PIN_CLOSE_SUCCESS ||
+               msg->type == TYPE_AIO_PIN_STREAM_START_SUCCESS ||
+               msg->type == TYPE_AIO_PIN_STREAM_STOP_SUCCESS ||
+               msg->type == TYPE_AIO_PIN_GET_SUPPRESSED_SUCCESS ||
+               msg->type == TYPE_AIO_PIN_SET_FILTER_SUCCESS ||
+               msg->type == TYPE_AIO_PIN_SET_PERIOD_SUCCESS ||
+               msg->type == TYPE_AIO_PIN_GET_JITTER_SUCCESS ||
+               msg->type == TYPE_AIO_PIN_PID_CONFIG_SUCCESS ||
+               msg->type == TYPE_AIO_PIN_PID_START_SUCCESS ||
+               msg->type == TYPE_AIO_PIN_PID_SETPOINT_SUCCESS ||
+               msg->type == TYPE_AIO_PIN_PID_STOP_SUCCESS) {
+        // handled by the request's owner
     } else if (msg->type == TYPE_AIO_OPEN_FAIL ||
                msg->type == TYPE_AIO_PIN_READ_FAIL ||
-               msg->type == TYPE_AIO_PIN_SUBSCRIBE_FAIL) {
-        PRINT("Error - failed to perform operation %lu\n", msg->type);
+               msg->type == TYPE_AIO_PIN_CLOSE_FAIL ||
+               msg->type == TYPE_AIO_PIN_SUBSCRIBE_FAIL ||
+               msg->type == TYPE_AIO_PIN_STREAM_START_FAIL ||
+               msg->type == TYPE_AIO_PIN_STREAM_STOP_FAIL ||
+               msg->type == TYPE_AIO_PIN_GET_SUPPRESSED_FAIL ||
+               msg->type == TYPE_AIO_PIN_SET_FILTER_FAIL ||
+               msg->type == TYPE_AIO_PIN_SET_PERIOD_FAIL ||
+               msg->type == TYPE_AIO_PIN_GET_JITTER_FAIL ||
+               msg->type == TYPE_AIO_PIN_PID_CONFIG_FAIL ||
+               msg->type == TYPE_AIO_PIN_PID_START_FAIL ||
+               msg->type == TYPE_AIO_PIN_PID_SETPOINT_FAIL ||
+               msg->type == TYPE_AIO_PIN_PID_STOP_FAIL) {
+        PRINT("Error - failed to perform operation %u\n", msg->type);
     } else {
-        PRINT("IPM message not handled %lu\n", msg->type);
+        PRINT("IPM message not handled %u\n", msg->type);
     }
 
-    if (msg->block) {
-        // un-block sync api
-        isr_sem_give(SEM_AIO_BLOCK);
+    if (msg->id) {
+        zjs_aio_request_complete(msg);
     }
 }
 
 jerry_object_t *zjs_aio_init()
 {
+    for (int i = 0; i < ZJS_AIO_MAX_REQUESTS; i++) {
+        nano_sem_init(&zjs_aio_requests[i].sem);
+    }
+    nano_sem_init(&zjs_aio_pid_sem);
+
     zjs_ipm_init();
     zjs_ipm_register_callback(MSG_ID_AIO, ipm_msg_receive_callback);
 
     // create global AIO object
     jerry_object_t *aio_obj = jerry_create_object();
     zjs_obj_add_function(aio_obj, zjs_aio_open, "open");
+    zjs_obj_add_function(aio_obj, zjs_aio_get_ipm_stats, "getIpmStats");
     return aio_obj;
 }
 
@@ -237,11 +816,17 @@ bool zjs_aio_open(const jerry_object_t *function_obj_p,
     bool raw = false;
     zjs_obj_get_boolean(data, "raw", &raw);
 
-    // send IPM message to the ARC side
-    zjs_aio_ipm_send_blocking(TYPE_AIO_OPEN, pin, 0);
-    // block until reply or timeout
-    if (task_sem_take(SEM_AIO_BLOCK, 500) == RC_TIME) {
-        PRINT("Reply from ARC timed out!");
+    // ARC sums oversample readings, a power of 4, for an extra bit each 4x
+    uint32_t oversample = 1;
+    zjs_obj_get_uint32(data, "oversample", &oversample);
+    uint32_t resolution = 12;
+    for (uint32_t n = oversample; n >= 4 && !(n & 3); n >>= 2) {
+        resolution++;
+    }
+
+    if (!zjs_aio_call_remote(TYPE_AIO_OPEN, pin, oversample, 0, NULL,
+                             NULL)) {
+        PRINT("zjs_aio_open: ARC couldn't open pin %lu\n", pin);
         return false;
     }
 
@@ -249,13 +834,24 @@ bool zjs_aio_open(const jerry_object_t *function_obj_p,
     jerry_object_t *pinobj = jerry_create_object();
     zjs_obj_add_function(pinobj, zjs_aio_pin_read, "read");
     zjs_obj_add_function(pinobj, zjs_aio_pin_read_async, "read_async");
+    zjs_obj_add_function(pinobj, zjs_aio_pin_read_cached, "readCached");
     zjs_obj_add_function(pinobj, zjs_aio_pin_abort, "abort");
     zjs_obj_add_function(pinobj, zjs_aio_pin_close, "close");
     zjs_obj_add_function(pinobj, zjs_aio_pin_on, "on");
+    zjs_obj_add_function(pinobj, zjs_aio_pin_stream, "stream");
+    zjs_obj_add_function(pinobj, zjs_aio_pin_stop_stream, "stopStream");
+    zjs_obj_add_function(pinobj, zjs_aio_pin_get_suppressed_count,
+                         "getSuppressedCount");
+    zjs_obj_add_function(pinobj, zjs_aio_pin_set_filter, "setFilter");
+    zjs_obj_add_function(pinobj, zjs_aio_pin_set_sample_rate, "setSampleRate");
+    zjs_obj_add_function(pinobj, zjs_aio_pin_get_jitter, "getJitter");
+    zjs_obj_add_function(pinobj, zjs_aio_pin_pid, "pid");
     zjs_obj_add_string(pinobj, name, "name");
     zjs_obj_add_number(pinobj, device, "device");
     zjs_obj_add_number(pinobj, pin, "pin");
     zjs_obj_add_boolean(pinobj, raw, "raw");
+    zjs_obj_add_number(pinobj, oversample, "oversample");
+    zjs_obj_add_number(pinobj, resolution, "resolution");
 
     *ret_val_p = jerry_create_object_value(pinobj);
     return true;
@@ -278,18 +874,12 @@ bool zjs_aio_pin_read(const jerry_object_t *function_obj_p,
         return false;
     }
 
-    // send IPM message to the ARC side
-    zjs_aio_ipm_send_blocking(TYPE_AIO_PIN_READ, pin, 0);
-    // block until reply or timeout
-    if (task_sem_take(SEM_AIO_BLOCK, 500) == RC_TIME) {
-        PRINT("Reply from ARC timed out!");
+    uint32_t value;
+    if (!zjs_aio_call_remote(TYPE_AIO_PIN_READ, pin, 0, 0, &value, NULL)) {
         return false;
     }
 
-    double value;
-    value = (double) pin_values[pin-A0];
-
-    *ret_val_p = jerry_create_number_value(value);
+    *ret_val_p = jerry_create_number_value((double)value);
     return true;
 }
 
@@ -309,7 +899,38 @@ bool zjs_aio_pin_close(const jerry_object_t *function_obj_p,
                        const jerry_length_t args_cnt,
                        jerry_value_t *ret_val_p)
 {
-    // NO-OP
+    // requires: this_val is an AIOPin object
+    //  effects: has ARC stop scanning the pin and drop its change events,
+    //             stream and control loop, and stops them here too
+    jerry_object_t *obj = jerry_get_object_value(this_val);
+    uint32_t pin;
+    zjs_obj_get_uint32(obj, "pin", &pin);
+    if (pin < A0 || pin > A5) {
+        PRINT("pin #%lu out of range\n", pin);
+        return false;
+    }
+
+    if (!zjs_aio_call_remote(TYPE_AIO_PIN_CLOSE, pin, 0, 0, NULL, NULL))
+        return false;
+
+    struct zjs_aio_stream *st = &zjs_aio_streams[pin-A0];
+    if (st->block_size) {
+        st->block_size = 0;
+        if (!st->pending)
+            zjs_aio_stream_free(st);
+    }
+
+    struct zjs_aio_pid *pid = &zjs_aio_pids[pin-A0];
+    if (pid->running) {
+        pid->running = false;
+        zjs_pwm_output_release(&pid->output);
+        jerry_object_t *callback = pid->telemetry.zjs_cb.js_callback;
+        pid->telemetry.zjs_cb.js_callback = NULL;
+        if (callback)
+            jerry_release_object(callback);
+        jerry_release_object(pid->loop_obj);
+        pid->loop_obj = NULL;
+    }
     return true;
 }
 
@@ -319,6 +940,11 @@ bool zjs_aio_pin_on(const jerry_object_t *function_obj_p,
                     const jerry_length_t args_cnt,
                     jerry_value_t *ret_val_p)
 {
+    // requires: arg 0 is an event name, arg 1 a callback or null; for
+    //             'change', optional arg 2 is an object with deadband and
+    //             hysteresis in raw ADC counts and minIntervalMs, all
+    //             defaulting to 0, which ARC uses to hold back changes too
+    //             small or too soon to be worth reporting
     if (args_cnt < 2 ||
         !jerry_value_is_string(args_p[0]) ||
         (!jerry_value_is_object(args_p[1]) &&
@@ -331,39 +957,115 @@ bool zjs_aio_pin_on(const jerry_object_t *function_obj_p,
 
     uint32_t pin;
     zjs_obj_get_uint32(obj, "pin", &pin);
+    if (pin < A0 || pin > A5) {
+        PRINT("pin #%lu out of range\n", pin);
+        return false;
+    }
 
     char event[20];
     jerry_value_t arg = args_p[0];
     jerry_size_t sz = jerry_get_string_size(jerry_get_string_value(arg));
+    if (sz >= sizeof(event))
+        sz = sizeof(event) - 1;
     int len = jerry_string_to_char_buffer(jerry_get_string_value(arg),
                                           (jerry_char_t *)event,
                                           sz);
     event[len] = '\0';
 
-    struct zjs_cb_list_item *item = zjs_aio_get_callback_item(pin, event);
-    if (!item) {
-        item = zjs_aio_callback_alloc();
-    }
-
-    if (!item)
+    struct zjs_aio_listener *listener;
+    if (!strcmp(event, "change")) {
+        listener = &zjs_aio_channels[pin-A0].change;
+        listener->zjs_cb.call_function = zjs_aio_emit_event;
+    } else if (!strcmp(event, "stats")) {
+        listener = &zjs_aio_channels[pin-A0].stats;
+        listener->zjs_cb.call_function = zjs_aio_emit_stats;
+    } else {
+        PRINT("zjs_aio_pin_on: unsupported event '%s'\n", event);
         return false;
+    }
 
-    item->pin_obj = obj;
-    item->zjs_cb.js_callback = jerry_acquire_object(jerry_get_object_value(args_p[1]));
-    item->zjs_cb.call_function = zjs_aio_emit_event;
-    memcpy(item->event_type, event, len);
+    // a queued call finds the new callback, or none, when it runs
+    jerry_object_t *old = listener->zjs_cb.js_callback;
+    if (jerry_value_is_object(args_p[1])) {
+        listener->zjs_cb.js_callback =
+            jerry_acquire_object(jerry_get_object_value(args_p[1]));
+    } else {
+        listener->zjs_cb.js_callback = NULL;
+    }
+    if (old)
+        jerry_release_object(old);
 
     if (!strcmp(event, "change")) {
         if (jerry_value_is_object(args_p[1])) {
-            zjs_aio_ipm_send(TYPE_AIO_PIN_SUBSCRIBE, pin, 0);
-        } else {
-            zjs_aio_ipm_send(TYPE_AIO_PIN_UNSUBSCRIBE, pin, 0);
+            uint32_t deadband = 0, hysteresis = 0, min_interval = 0;
+            if (args_cnt > 2 && jerry_value_is_object(args_p[2])) {
+                jerry_object_t *options = jerry_get_object_value(args_p[2]);
+                zjs_obj_get_uint32(options, "deadband", &deadband);
+                zjs_obj_get_uint32(options, "hysteresis", &hysteresis);
+                zjs_obj_get_uint32(options, "minIntervalMs", &min_interval);
+            }
+            if (deadband > 0xffff || hysteresis > 0xffff) {
+                PRINT("zjs_aio_pin_on: deadband or hysteresis too large\n");
+                return false;
+            }
+            // deadband and hysteresis share the value field
+            if (zjs_aio_ipm_send_msg(TYPE_AIO_PIN_SUBSCRIBE, false, 0, pin,
+                                     deadband | (hysteresis << 16),
+                                     min_interval) != 0) {
+                PRINT("zjs_aio_pin_on: couldn't subscribe to pin %lu\n",
+                      pin);
+                return false;
+            }
+        } else if (!zjs_aio_channels[pin-A0].tap &&
+                   zjs_aio_ipm_send(TYPE_AIO_PIN_UNSUBSCRIBE, pin, 0) != 0) {
+            PRINT("zjs_aio_pin_on: couldn't unsubscribe from pin %lu\n",
+                  pin);
+            return false;
         }
     }
 
     return true;
 }
 
+bool zjs_aio_set_tap(jerry_object_t *pin_obj, zjs_aio_tap_t tap,
+                     void *context, uint32_t deadband)
+{
+    // requires: pin_obj is an AIOPin object, called only from task context;
+    //             tap is called from the IPM ISR, so it must not block
+    //  effects: calls tap with each changed value ARC reports for the pin,
+    //             or stops if tap is NULL; unless JS is also listening for
+    //             'change', subscribes to the pin with deadband in raw ADC
+    //             counts, and unsubscribes again when the tap is removed;
+    //             returns false if the pin already has a tap
+    uint32_t pin;
+    if (!zjs_obj_get_uint32(pin_obj, "pin", &pin) || pin < A0 || pin > A5)
+        return false;
+
+    struct zjs_aio_channel *ch = &zjs_aio_channels[pin-A0];
+    bool listening = ch->change.zjs_cb.js_callback != NULL;
+    if (deadband > 0xffff)
+        return false;
+    if (tap && ch->tap) {
+        PRINT("zjs_aio_set_tap: pin %lu already has a tap\n", pin);
+        return false;
+    }
+    if (tap && !listening &&
+        zjs_aio_ipm_send_msg(TYPE_AIO_PIN_SUBSCRIBE, false, 0, pin,
+                             deadband, 0) != 0) {
+        PRINT("zjs_aio_set_tap: couldn't subscribe to pin %lu\n", pin);
+        return false;
+    }
+
+    int key = irq_lock();
+    ch->tap = tap;
+    ch->tap_context = context;
+    irq_unlock(key);
+
+    if (!tap && !listening)
+        zjs_aio_ipm_send(TYPE_AIO_PIN_UNSUBSCRIBE, pin, 0);
+    return true;
+}
+
 // Asynchrounous Operations
 bool zjs_aio_pin_read_async(const jerry_object_t *function_obj_p,
                             const jerry_value_t this_val,
@@ -381,21 +1083,693 @@ bool zjs_aio_pin_read_async(const jerry_object_t *function_obj_p,
     zjs_obj_get_uint32(obj, "device", &device);
     zjs_obj_get_uint32(obj, "pin", &pin);
 
-    struct zjs_cb_list_item *item = zjs_aio_get_callback_item(pin, NULL);
-    if (!item) {
-        item = zjs_aio_callback_alloc();
+    if (pin < A0 || pin > A5) {
+        PRINT("pin #%lu out of range\n", pin);
+        return false;
+    }
+
+    struct zjs_aio_read *read = NULL;
+    for (int i = 0; i < ZJS_AIO_READ_SLOTS; i++) {
+        if (!zjs_aio_reads[pin-A0][i].in_use) {
+            read = &zjs_aio_reads[pin-A0][i];
+            break;
+        }
+    }
+
+    if (!read) {
+        PRINT("error: too many reads outstanding on pin %lu\n", pin);
+        return false;
     }
 
-    if (!item)
+    // the reply completes this request from the ISR
+    struct zjs_aio_request *req = zjs_aio_request_alloc(read);
+    if (!req) {
+        PRINT("error: too many AIO requests in flight\n");
         return false;
+    }
+
+    read->in_use = true;
+    read->timed_out = false;
+    read->zjs_cb.js_callback =
+        jerry_acquire_object(jerry_get_object_value(args_p[0]));
+    read->zjs_cb.call_function = zjs_aio_call_function;
 
-    item->pin_obj = obj;
-    item->zjs_cb.js_callback = jerry_get_object_value(args_p[0]);
-    item->zjs_cb.call_function = zjs_aio_call_function;
+    // send IPM message to the ARC side
+    if (zjs_aio_ipm_send_msg(TYPE_AIO_PIN_READ, false, req->id, pin, 0,
+                             0) != 0) {
+        PRINT("error: couldn't send read request for pin %lu\n", pin);
+        jerry_release_object(read->zjs_cb.js_callback);
+        read->zjs_cb.js_callback = NULL;
+        read->in_use = false;
+        req->in_use = false;
+        return false;
+    }
 
-    jerry_acquire_object(item->zjs_cb.js_callback);
+    // give up like a sync read would if the reply never comes
+    if (!zjs_aio_expire_fiber_started) {
+        nano_sem_init(&zjs_aio_expire_sem);
+        task_fiber_start(zjs_aio_expire_stack, ZJS_AIO_EXPIRE_STACK_SIZE,
+                         zjs_aio_expire_fiber, 0, 0, ZJS_AIO_EXPIRE_PRIORITY,
+                         0);
+        zjs_aio_expire_fiber_started = true;
+    }
+    nano_task_sem_give(&zjs_aio_expire_sem);
+    return true;
+}
+
+bool zjs_aio_pin_stream(const jerry_object_t *function_obj_p,
+                        const jerry_value_t this_val,
+                        const jerry_value_t args_p[],
+                        const jerry_length_t args_cnt,
+                        jerry_value_t *ret_val_p)
+{
+    // requires: this_val is an AIOPin object, arg 0 is an object with rateHz
+    //             (required) and blockSize (defaults to 32, at most 64), arg 1
+    //             is a JS callback
+    //  effects: has ARC sample the pin at a fixed rate, timed by the ADC, and
+    //             calls the callback once per block with a Buffer of 16-bit
+    //             little-endian samples and an object with the block's
+    //             timestamp (ARC hw cycles), sequence number, samples lost on
+    //             ARC between blocks (overruns) and blocks dropped because JS
+    //             fell behind (dropped)
+    if (args_cnt < 2 || !jerry_value_is_object(args_p[0]) ||
+        !jerry_value_is_function(args_p[1])) {
+        PRINT("zjs_aio_pin_stream: invalid arguments\n");
+        return false;
+    }
+
+    jerry_object_t *options = jerry_get_object_value(args_p[0]);
+    uint32_t rate;
+    if (!zjs_obj_get_uint32(options, "rateHz", &rate)) {
+        PRINT("zjs_aio_pin_stream: missing required field (rateHz)\n");
+        return false;
+    }
+
+    uint32_t block_size = ZJS_AIO_STREAM_DEFAULT_BLOCK;
+    zjs_obj_get_uint32(options, "blockSize", &block_size);
+    if (block_size < 1 || block_size > ZJS_AIO_STREAM_MAX_BLOCK) {
+        PRINT("zjs_aio_pin_stream: blockSize must be 1 to %d\n",
+              ZJS_AIO_STREAM_MAX_BLOCK);
+        return false;
+    }
+
+    jerry_object_t *obj = jerry_get_object_value(this_val);
+    uint32_t pin;
+    zjs_obj_get_uint32(obj, "pin", &pin);
+    if (pin < A0 || pin > A5) {
+        PRINT("pin #%lu out of range\n", pin);
+        return false;
+    }
+
+    struct zjs_aio_stream *st = &zjs_aio_streams[pin-A0];
+    if (st->block_size) {
+        PRINT("zjs_aio_pin_stream: pin #%lu is already streaming\n", pin);
+        return false;
+    }
+
+    if (!st->fill) {
+        st->fill = task_malloc(ZJS_AIO_STREAM_MAX_BLOCK * sizeof(uint16_t));
+        st->ready = task_malloc(ZJS_AIO_STREAM_MAX_BLOCK * sizeof(uint16_t));
+        if (!st->fill || !st->ready) {
+            PRINT("error: out of memory allocating stream buffers\n");
+            zjs_aio_stream_free(st);
+            return false;
+        }
+    }
+
+    if (st->zjs_cb.js_callback)
+        jerry_release_object(st->zjs_cb.js_callback);
+    st->zjs_cb.js_callback =
+        jerry_acquire_object(jerry_get_object_value(args_p[1]));
+    st->zjs_cb.call_function = zjs_aio_stream_call_function;
+    st->pin_obj = obj;
+    st->count = 0;
+    st->dropped = 0;
+    st->block_size = block_size;
+
+    if (!zjs_aio_call_remote(TYPE_AIO_PIN_STREAM_START, pin, rate,
+                             block_size, NULL, NULL)) {
+        PRINT("zjs_aio_pin_stream: ARC couldn't start stream\n");
+        st->block_size = 0;
+        if (!st->pending)
+            zjs_aio_stream_free(st);
+        return false;
+    }
+
+    return true;
+}
+
+bool zjs_aio_pin_stop_stream(const jerry_object_t *function_obj_p,
+                             const jerry_value_t this_val,
+                             const jerry_value_t args_p[],
+                             const jerry_length_t args_cnt,
+                             jerry_value_t *ret_val_p)
+{
+    // requires: this_val is an AIOPin object
+    //  effects: stops a stream started with stream(); a block already queued
+    //             for JS is discarded
+    jerry_object_t *obj = jerry_get_object_value(this_val);
+    uint32_t pin;
+    zjs_obj_get_uint32(obj, "pin", &pin);
+    if (pin < A0 || pin > A5) {
+        PRINT("pin #%lu out of range\n", pin);
+        return false;
+    }
+
+    struct zjs_aio_stream *st = &zjs_aio_streams[pin-A0];
+    if (!st->block_size)
+        return true;
+
+    if (!zjs_aio_call_remote(TYPE_AIO_PIN_STREAM_STOP, pin, 0, 0, NULL,
+                             NULL)) {
+        return false;
+    }
+
+    st->block_size = 0;
+    if (!st->pending)
+        zjs_aio_stream_free(st);
+    return true;
+}
+
+bool zjs_aio_pin_get_suppressed_count(const jerry_object_t *function_obj_p,
+                                      const jerry_value_t this_val,
+                                      const jerry_value_t args_p[],
+                                      const jerry_length_t args_cnt,
+                                      jerry_value_t *ret_val_p)
+{
+    // requires: this_val is an AIOPin object
+    //  effects: returns the number of changes ARC has held back since the
+    //             last on('change') subscription
+    jerry_object_t *obj = jerry_get_object_value(this_val);
+    uint32_t pin;
+    zjs_obj_get_uint32(obj, "pin", &pin);
+    if (pin < A0 || pin > A5) {
+        PRINT("pin #%lu out of range\n", pin);
+        return false;
+    }
+
+    uint32_t count;
+    if (!zjs_aio_call_remote(TYPE_AIO_PIN_GET_SUPPRESSED, pin, 0, 0,
+                             &count, NULL)) {
+        PRINT("zjs_aio_pin_get_suppressed_count: no reply from ARC\n");
+        return false;
+    }
+
+    *ret_val_p = jerry_create_number_value((double)count);
+    return true;
+}
+
+bool zjs_aio_pin_set_filter(const jerry_object_t *function_obj_p,
+                            const jerry_value_t this_val,
+                            const jerry_value_t args_p[],
+                            const jerry_length_t args_cnt,
+                            jerry_value_t *ret_val_p)
+{
+    // requires: this_val is an AIOPin object, arg 0 is an object with
+    //             optional fields average ('none', 'boxcar' or 'ema'),
+    //             window (boxcar length, up to 32, default 8), shift (EMA
+    //             alpha is 1/2^shift, up to 8, default 3), decimate (scans
+    //             per output, default 1) and stats (true to emit 'stats'
+    //             events)
+    //  effects: has ARC filter the pin before read(), 'change' and 'stats'
+    //             see it, so x86 only handles one value per decimated window
+    if (args_cnt < 1 || !jerry_value_is_object(args_p[0])) {
+        PRINT("zjs_aio_pin_set_filter: invalid arguments\n");
+        return false;
+    }
+
+    jerry_object_t *options = jerry_get_object_value(args_p[0]);
+    char average[8] = "none";
+    uint32_t window = 8, shift = 3, decimate = 1;
+    bool stats = false;
+    zjs_obj_get_string(options, "average", average, sizeof(average));
+    zjs_obj_get_uint32(options, "window", &window);
+    zjs_obj_get_uint32(options, "shift", &shift);
+    zjs_obj_get_uint32(options, "decimate", &decimate);
+    zjs_obj_get_boolean(options, "stats", &stats);
+
+    uint32_t mode;
+    if (!strcmp(average, "none")) {
+        mode = ZJS_AIO_FILTER_NONE;
+        window = 0;
+    } else if (!strcmp(average, "boxcar")) {
+        mode = ZJS_AIO_FILTER_BOXCAR;
+    } else if (!strcmp(average, "ema")) {
+        mode = ZJS_AIO_FILTER_EMA;
+        window = shift;
+    } else {
+        PRINT("zjs_aio_pin_set_filter: invalid average '%s'\n", average);
+        return false;
+    }
+
+    if (window > 0xff || !decimate || decimate > 0xffff) {
+        PRINT("zjs_aio_pin_set_filter: invalid window or decimate\n");
+        return false;
+    }
+
+    jerry_object_t *obj = jerry_get_object_value(this_val);
+    uint32_t pin;
+    zjs_obj_get_uint32(obj, "pin", &pin);
+    if (pin < A0 || pin > A5) {
+        PRINT("pin #%lu out of range\n", pin);
+        return false;
+    }
+
+    if (!zjs_aio_call_remote(TYPE_AIO_PIN_SET_FILTER, pin,
+                             mode | (window << 8),
+                             decimate | (stats ? ZJS_AIO_FILTER_STATS : 0),
+                             NULL, NULL)) {
+        PRINT("zjs_aio_pin_set_filter: ARC rejected filter settings\n");
+        return false;
+    }
+
+    return true;
+}
+
+bool zjs_aio_pin_read_cached(const jerry_object_t *function_obj_p,
+                             const jerry_value_t this_val,
+                             const jerry_value_t args_p[],
+                             const jerry_length_t args_cnt,
+                             jerry_value_t *ret_val_p)
+{
+    // requires: this_val is an AIOPin object
+    //  effects: returns the last value ARC reported for the pin, from a read,
+    //             a change event or a filter output, without waiting on ARC;
+    //             returns null if there hasn't been one yet
+    jerry_object_t *obj = jerry_get_object_value(this_val);
+    uint32_t pin;
+    zjs_obj_get_uint32(obj, "pin", &pin);
+    if (pin < A0 || pin > A5) {
+        PRINT("pin #%lu out of range\n", pin);
+        return false;
+    }
+
+    if (!pin_cache_valid[pin-A0]) {
+        *ret_val_p = jerry_create_null_value();
+    } else {
+        *ret_val_p = jerry_create_number_value((double)pin_cache[pin-A0]);
+    }
+    return true;
+}
+
+bool zjs_aio_pin_set_sample_rate(const jerry_object_t *function_obj_p,
+                                 const jerry_value_t this_val,
+                                 const jerry_value_t args_p[],
+                                 const jerry_length_t args_cnt,
+                                 jerry_value_t *ret_val_p)
+{
+    // requires: this_val is an AIOPin object, arg 0 is the number of scans
+    //             per second, or 0 for the default of 10
+    //  effects: sets how often ARC scans the pin for reads and events; ARC
+    //             can only wake on a system tick, so rates above its tick
+    //             rate show up as jitter
+    double rate;
+    if (args_cnt < 1 || !jerry_value_is_number(args_p[0]) ||
+        (rate = jerry_get_number_value(args_p[0])) < 0) {
+        PRINT("zjs_aio_pin_set_sample_rate: invalid argument\n");
+        return false;
+    }
+
+    jerry_object_t *obj = jerry_get_object_value(this_val);
+    uint32_t pin;
+    zjs_obj_get_uint32(obj, "pin", &pin);
+    if (pin < A0 || pin > A5) {
+        PRINT("pin #%lu out of range\n", pin);
+        return false;
+    }
+
+    uint32_t period_us = rate > 0 ? (uint32_t)(1000000 / rate) : 0;
+    if (rate > 0 && !period_us)
+        period_us = 1;
+
+    if (!zjs_aio_call_remote(TYPE_AIO_PIN_SET_PERIOD, pin, period_us, 0,
+                             NULL, NULL)) {
+        PRINT("zjs_aio_pin_set_sample_rate: ARC rejected the rate\n");
+        return false;
+    }
+
+    return true;
+}
+
+bool zjs_aio_pin_get_jitter(const jerry_object_t *function_obj_p,
+                            const jerry_value_t this_val,
+                            const jerry_value_t args_p[],
+                            const jerry_length_t args_cnt,
+                            jerry_value_t *ret_val_p)
+{
+    // requires: this_val is an AIOPin object
+    //  effects: returns an object with the max and mean time, in us, by
+    //             which ARC's scans of the pin started late since its rate
+    //             was last set
+    jerry_object_t *obj = jerry_get_object_value(this_val);
+    uint32_t pin;
+    zjs_obj_get_uint32(obj, "pin", &pin);
+    if (pin < A0 || pin > A5) {
+        PRINT("pin #%lu out of range\n", pin);
+        return false;
+    }
+
+    uint32_t max, mean;
+    if (!zjs_aio_call_remote(TYPE_AIO_PIN_GET_JITTER, pin, 0, 0, &max,
+                             &mean)) {
+        PRINT("zjs_aio_pin_get_jitter: no reply from ARC\n");
+        return false;
+    }
+
+    jerry_object_t *jitter = jerry_create_object();
+    zjs_obj_add_number(jitter, max, "max");
+    zjs_obj_add_number(jitter, mean, "mean");
+    *ret_val_p = jerry_create_object_value(jitter);
+    return true;
+}
+
+static jerry_object_t *zjs_aio_counters_object(bool remote)
+{
+    // effects: returns a new object holding one core's IPM counters
+    struct zjs_ipm_counters counters;
+    zjs_ipm_get_counters(remote, &counters);
+
+    jerry_object_t *obj = jerry_create_object();
+    zjs_obj_add_number(obj, counters.sent, "sent");
+    zjs_obj_add_number(obj, counters.dropped, "dropped");
+    zjs_obj_add_number(obj, counters.retried, "retried");
+    zjs_obj_add_number(obj, counters.high_water, "highWater");
+    return obj;
+}
+
+bool zjs_aio_get_ipm_stats(const jerry_object_t *function_obj_p,
+                           const jerry_value_t this_val,
+                           const jerry_value_t args_p[],
+                           const jerry_length_t args_cnt,
+                           jerry_value_t *ret_val_p)
+{
+    //  effects: returns an object with the IPM counters of x86 and of ARC,
+    //             each with the messages sent, dropped and retried, and the
+    //             high-water mark of its queue: for x86, the most events
+    //             waiting on JS at once; for ARC, the most ring entries in use
+    jerry_object_t *stats = jerry_create_object();
+    zjs_obj_add_object(stats, zjs_aio_counters_object(false), "x86");
+    zjs_obj_add_object(stats, zjs_aio_counters_object(true), "arc");
+    *ret_val_p = jerry_create_object_value(stats);
+    return true;
+}
+
+static bool zjs_aio_pid_send_gains(uint32_t pin, struct zjs_aio_pid *pid)
+{
+    // requires: called only from task context
+    //  effects: sends the loop's gains to ARC as 16.16 fixed point duty
+    //             cycles per ADC unit, scaled from per second to per loop
+    //             period; returns false if one is out of range or ARC
+    //             refused it
+    double period = pid->period_us / 1000000.0;
+    double gains[3] = { pid->kp, pid->ki * period, pid->kd / period };
+    for (int i = 0; i < 3; i++) {
+        double fixed = gains[i] * ZJS_AIO_PID_DUTY_MAX * 65536;
+        if (fixed >= 2147483648.0 || fixed < -2147483648.0) {
+            PRINT("error: control loop gain out of range\n");
+            return false;
+        }
+        if (!zjs_aio_call_remote(TYPE_AIO_PIN_PID_CONFIG, pin,
+                                 ZJS_AIO_PID_KP + i,
+                                 (uint32_t)(int32_t)fixed, NULL, NULL)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static struct zjs_aio_pid *zjs_aio_pid_from_this(const jerry_value_t this_val,
+                                                 uint32_t *pin)
+{
+    // effects: returns the running control loop this_val, a PIDLoop object,
+    //            stands for and its pin in pin, or NULL if it has stopped
+    jerry_object_t *obj = jerry_get_object_value(this_val);
+    if (!zjs_obj_get_uint32(obj, "pin", pin) || *pin < A0 || *pin > A5) {
+        PRINT("error: not a control loop\n");
+        return NULL;
+    }
+
+    struct zjs_aio_pid *pid = &zjs_aio_pids[*pin-A0];
+    if (!pid->running || pid->loop_obj != obj) {
+        PRINT("error: control loop on pin %lu has stopped\n", *pin);
+        return NULL;
+    }
+    return pid;
+}
+
+bool zjs_aio_pin_pid(const jerry_object_t *function_obj_p,
+                     const jerry_value_t this_val,
+                     const jerry_value_t args_p[],
+                     const jerry_length_t args_cnt,
+                     jerry_value_t *ret_val_p)
+{
+    // requires: this_val is an AIOPin object, arg 0 is a PWMPin object, arg 1
+    //             is an object with setpoint (required, in ADC units), kp, ki
+    //             (per second) and kd (seconds), in fractions of full duty
+    //             per ADC unit of error and all defaulting to 0, rateHz
+    //             (defaults to 100), outputMin and outputMax as fractions of
+    //             full duty (default 0 and 1), and telemetryEvery, in outputs
+    //  effects: starts a PID loop on ARC that reads this pin at rateHz and
+    //             drives the PWM pin's duty cycle from native code, without
+    //             JS; returns a PIDLoop object to control it. ARC schedules
+    //             scans by system tick, so rates above the tick rate run
+    //             at about the tick rate
+    if (args_cnt < 2 || !jerry_value_is_object(args_p[0]) ||
+        !jerry_value_is_object(args_p[1])) {
+        PRINT("zjs_aio_pin_pid: invalid arguments\n");
+        return false;
+    }
+
+    jerry_object_t *obj = jerry_get_object_value(this_val);
+    uint32_t pin;
+    zjs_obj_get_uint32(obj, "pin", &pin);
+    if (pin < A0 || pin > A5) {
+        PRINT("pin #%lu out of range\n", pin);
+        return false;
+    }
+
+    struct zjs_aio_pid *pid = &zjs_aio_pids[pin-A0];
+    if (pid->running) {
+        PRINT("zjs_aio_pin_pid: pin #%lu already has a control loop\n", pin);
+        return false;
+    }
+
+    struct zjs_pwm_output output;
+    if (!zjs_pwm_get_output(jerry_get_object_value(args_p[0]), &output)) {
+        PRINT("zjs_aio_pin_pid: arg 0 isn't a PWM pin\n");
+        return false;
+    }
+
+    jerry_object_t *options = jerry_get_object_value(args_p[1]);
+    uint32_t setpoint;
+    if (!zjs_obj_get_uint32(options, "setpoint", &setpoint)) {
+        PRINT("zjs_aio_pin_pid: missing required field (setpoint)\n");
+        return false;
+    }
+
+    uint32_t rate = ZJS_AIO_PID_DEFAULT_RATE;
+    zjs_obj_get_uint32(options, "rateHz", &rate);
+    double kp = 0, ki = 0, kd = 0, out_min = 0, out_max = 1;
+    zjs_obj_get_double(options, "kp", &kp);
+    zjs_obj_get_double(options, "ki", &ki);
+    zjs_obj_get_double(options, "kd", &kd);
+    zjs_obj_get_double(options, "outputMin", &out_min);
+    zjs_obj_get_double(options, "outputMax", &out_max);
+    uint32_t telemetry = 0;
+    zjs_obj_get_uint32(options, "telemetryEvery", &telemetry);
+    if (!rate || rate > 1000000 || out_min < 0 || out_max > 1 ||
+        out_min > out_max) {
+        PRINT("zjs_aio_pin_pid: rateHz or output limits out of range\n");
+        return false;
+    }
+
+    // nothing else may write the PWM pin while the loop drives it
+    if (!zjs_pwm_output_claim(&output)) {
+        PRINT("zjs_aio_pin_pid: arg 0 is already driven by a control loop "
+              "or pipe\n");
+        return false;
+    }
+
+    pid->output = output;
+    pid->period_us = 1000000 / rate;
+    pid->kp = kp;
+    pid->ki = ki;
+    pid->kd = kd;
+    if (!zjs_aio_pid_send_gains(pin, pid) ||
+        !zjs_aio_call_remote(TYPE_AIO_PIN_PID_CONFIG, pin,
+                             ZJS_AIO_PID_OUTPUT_MIN,
+                             out_min * ZJS_AIO_PID_DUTY_MAX, NULL, NULL) ||
+        !zjs_aio_call_remote(TYPE_AIO_PIN_PID_CONFIG, pin,
+                             ZJS_AIO_PID_OUTPUT_MAX,
+                             out_max * ZJS_AIO_PID_DUTY_MAX, NULL, NULL) ||
+        !zjs_aio_call_remote(TYPE_AIO_PIN_PID_CONFIG, pin,
+                             ZJS_AIO_PID_TELEMETRY, telemetry, NULL, NULL)) {
+        PRINT("zjs_aio_pin_pid: ARC couldn't configure the loop\n");
+        zjs_pwm_output_release(&output);
+        return false;
+    }
+
+    if (!zjs_aio_pid_fiber_started) {
+        task_fiber_start(zjs_aio_pid_stack, ZJS_AIO_PID_STACK_SIZE,
+                         zjs_aio_pid_fiber, 0, 0, ZJS_AIO_PID_PRIORITY, 0);
+        zjs_aio_pid_fiber_started = true;
+    }
+
+    // outputs can arrive as soon as ARC has started the loop
+    pid->applied = 0;
+    pid->dirty = false;
+    pid->running = true;
+    if (!zjs_aio_call_remote(TYPE_AIO_PIN_PID_START, pin, setpoint,
+                             pid->period_us, NULL, NULL)) {
+        PRINT("zjs_aio_pin_pid: ARC couldn't start the loop\n");
+        pid->running = false;
+        zjs_pwm_output_release(&output);
+        return false;
+    }
+
+    jerry_object_t *loop_obj = jerry_create_object();
+    zjs_obj_add_function(loop_obj, zjs_aio_pid_set_setpoint, "setSetpoint");
+    zjs_obj_add_function(loop_obj, zjs_aio_pid_set_gains, "setGains");
+    zjs_obj_add_function(loop_obj, zjs_aio_pid_on, "on");
+    zjs_obj_add_function(loop_obj, zjs_aio_pid_stop, "stop");
+    zjs_obj_add_number(loop_obj, pin, "pin");
+    if (telemetry)
+        zjs_obj_add_number(loop_obj, telemetry, "telemetryEvery");
+    pid->loop_obj = jerry_acquire_object(loop_obj);
+
+    *ret_val_p = jerry_create_object_value(loop_obj);
+    return true;
+}
+
+bool zjs_aio_pid_set_setpoint(const jerry_object_t *function_obj_p,
+                              const jerry_value_t this_val,
+                              const jerry_value_t args_p[],
+                              const jerry_length_t args_cnt,
+                              jerry_value_t *ret_val_p)
+{
+    // requires: this_val is a PIDLoop object, arg 0 is the new setpoint in
+    //             ADC units
+    //  effects: moves the loop's setpoint, keeping its integral so the
+    //             output doesn't jump
+    if (args_cnt < 1 || !jerry_value_is_number(args_p[0])) {
+        PRINT("zjs_aio_pid_set_setpoint: invalid argument\n");
+        return false;
+    }
+
+    uint32_t pin;
+    if (!zjs_aio_pid_from_this(this_val, &pin))
+        return false;
+
+    uint32_t setpoint = (uint32_t)jerry_get_number_value(args_p[0]);
+    return zjs_aio_call_remote(TYPE_AIO_PIN_PID_SETPOINT, pin, setpoint, 0,
+                               NULL, NULL);
+}
+
+bool zjs_aio_pid_set_gains(const jerry_object_t *function_obj_p,
+                           const jerry_value_t this_val,
+                           const jerry_value_t args_p[],
+                           const jerry_length_t args_cnt,
+                           jerry_value_t *ret_val_p)
+{
+    // requires: this_val is a PIDLoop object, arg 0 is an object with any of
+    //             kp, ki (per second) and kd (seconds)
+    //  effects: changes the given gains of the running loop
+    if (args_cnt < 1 || !jerry_value_is_object(args_p[0])) {
+        PRINT("zjs_aio_pid_set_gains: invalid argument\n");
+        return false;
+    }
+
+    uint32_t pin;
+    struct zjs_aio_pid *pid = zjs_aio_pid_from_this(this_val, &pin);
+    if (!pid)
+        return false;
+
+    jerry_object_t *gains = jerry_get_object_value(args_p[0]);
+    zjs_obj_get_double(gains, "kp", &pid->kp);
+    zjs_obj_get_double(gains, "ki", &pid->ki);
+    zjs_obj_get_double(gains, "kd", &pid->kd);
+    return zjs_aio_pid_send_gains(pin, pid);
+}
+
+bool zjs_aio_pid_on(const jerry_object_t *function_obj_p,
+                    const jerry_value_t this_val,
+                    const jerry_value_t args_p[],
+                    const jerry_length_t args_cnt,
+                    jerry_value_t *ret_val_p)
+{
+    // requires: this_val is a PIDLoop object, arg 0 is 'telemetry', arg 1 is
+    //             a function, or null to remove the listener
+    //  effects: calls the function with every telemetryEvery-th output, 10
+    //             if the loop was started without it
+    if (args_cnt < 2 || !jerry_value_is_string(args_p[0]) ||
+        !(jerry_value_is_object(args_p[1]) || jerry_value_is_null(args_p[1]))) {
+        PRINT("zjs_aio_pid_on: invalid arguments\n");
+        return false;
+    }
+
+    if (!zjs_strequal(jerry_get_string_value(args_p[0]), "telemetry")) {
+        PRINT("zjs_aio_pid_on: unsupported event\n");
+        return false;
+    }
+
+    uint32_t pin;
+    struct zjs_aio_pid *pid = zjs_aio_pid_from_this(this_val, &pin);
+    if (!pid)
+        return false;
+
+    struct zjs_aio_listener *listener = &pid->telemetry;
+    listener->zjs_cb.call_function = zjs_aio_emit_telemetry;
+    jerry_object_t *old = listener->zjs_cb.js_callback;
+    if (jerry_value_is_object(args_p[1])) {
+        listener->zjs_cb.js_callback =
+            jerry_acquire_object(jerry_get_object_value(args_p[1]));
+    } else {
+        listener->zjs_cb.js_callback = NULL;
+    }
+    if (old)
+        jerry_release_object(old);
+
+    if (listener->zjs_cb.js_callback) {
+        uint32_t every;
+        jerry_object_t *obj = jerry_get_object_value(this_val);
+        if (!zjs_obj_get_uint32(obj, "telemetryEvery", &every) || !every) {
+            every = ZJS_AIO_PID_DEFAULT_TELEMETRY;
+            if (!zjs_aio_call_remote(TYPE_AIO_PIN_PID_CONFIG, pin,
+                                     ZJS_AIO_PID_TELEMETRY, every, NULL,
+                                     NULL)) {
+                return false;
+            }
+            zjs_obj_add_number(obj, every, "telemetryEvery");
+        }
+    }
+    return true;
+}
+
+bool zjs_aio_pid_stop(const jerry_object_t *function_obj_p,
+                      const jerry_value_t this_val,
+                      const jerry_value_t args_p[],
+                      const jerry_length_t args_cnt,
+                      jerry_value_t *ret_val_p)
+{
+    // requires: this_val is a PIDLoop object
+    //  effects: stops the loop, leaving the PWM pin at its last output and
+    //             free for JS to write again, and restores the AIO pin's
+    //             default sample rate
+    uint32_t pin;
+    struct zjs_aio_pid *pid = zjs_aio_pid_from_this(this_val, &pin);
+    if (!pid)
+        return false;
+
+    if (!zjs_aio_call_remote(TYPE_AIO_PIN_PID_STOP, pin, 0, 0, NULL, NULL))
+        return false;
 
-    // send IPM message to the ARC side and wait for reponse
-    zjs_aio_ipm_send(TYPE_AIO_PIN_READ, pin, 0);
+    pid->running = false;
+    zjs_pwm_output_release(&pid->output);
+    jerry_object_t *callback = pid->telemetry.zjs_cb.js_callback;
+    pid->telemetry.zjs_cb.js_callback = NULL;
+    if (callback)
+        jerry_release_object(callback);
+    jerry_release_object(pid->loop_obj);
+    pid->loop_obj = NULL;
     return true;
 }
@@ -2,8 +2,14 @@
 
 #include "jerry-api.h"
 
+// native code fed an analog pin's changes from the IPM ISR, in raw ADC units
+typedef void (*zjs_aio_tap_t)(void *context, uint32_t value);
+
 jerry_object_t *zjs_aio_init();
 
+bool zjs_aio_set_tap(jerry_object_t *pin_obj, zjs_aio_tap_t tap,
+                     void *context, uint32_t deadband);
+
 bool zjs_aio_open(const jerry_object_t *function_obj_p,
                   const jerry_value_t this_val,
                   const jerry_value_t args_p[],
@@ -39,3 +45,81 @@ bool zjs_aio_pin_on(const jerry_object_t *function_obj_p,
                     const jerry_value_t args_p[],
                     const jerry_length_t args_cnt,
                     jerry_value_t *ret_val_p);
+
+bool zjs_aio_pin_stream(const jerry_object_t *function_obj_p,
+                        const jerry_value_t this_val,
+                        const jerry_value_t args_p[],
+                        const jerry_length_t args_cnt,
+                        jerry_value_t *ret_val_p);
+
+bool zjs_aio_pin_stop_stream(const jerry_object_t *function_obj_p,
+                             const jerry_value_t this_val,
+                             const jerry_value_t args_p[],
+                             const jerry_length_t args_cnt,
+                             jerry_value_t *ret_val_p);
+
+bool zjs_aio_pin_get_suppressed_count(const jerry_object_t *function_obj_p,
+                                      const jerry_value_t this_val,
+                                      const jerry_value_t args_p[],
+                                      const jerry_length_t args_cnt,
+                                      jerry_value_t *ret_val_p);
+
+bool zjs_aio_pin_set_filter(const jerry_object_t *function_obj_p,
+                            const jerry_value_t this_val,
+                            const jerry_value_t args_p[],
+                            const jerry_length_t args_cnt,
+                            jerry_value_t *ret_val_p);
+
+bool zjs_aio_pin_read_cached(const jerry_object_t *function_obj_p,
+                             const jerry_value_t this_val,
+                             const jerry_value_t args_p[],
+                             const jerry_length_t args_cnt,
+                             jerry_value_t *ret_val_p);
+
+bool zjs_aio_pin_set_sample_rate(const jerry_object_t *function_obj_p,
+                                 const jerry_value_t this_val,
+                                 const jerry_value_t args_p[],
+                                 const jerry_length_t args_cnt,
+                                 jerry_value_t *ret_val_p);
+
+bool zjs_aio_pin_get_jitter(const jerry_object_t *function_obj_p,
+                            const jerry_value_t this_val,
+                            const jerry_value_t args_p[],
+                            const jerry_length_t args_cnt,
+                            jerry_value_t *ret_val_p);
+
+bool zjs_aio_pin_pid(const jerry_object_t *function_obj_p,
+                     const jerry_value_t this_val,
+                     const jerry_value_t args_p[],
+                     const jerry_length_t args_cnt,
+                     jerry_value_t *ret_val_p);
+
+bool zjs_aio_pid_set_setpoint(const jerry_object_t *function_obj_p,
+                              const jerry_value_t this_val,
+                              const jerry_value_t args_p[],
+                              const jerry_length_t args_cnt,
+                              jerry_value_t *ret_val_p);
+
+bool zjs_aio_pid_set_gains(const jerry_object_t *function_obj_p,
+                           const jerry_value_t this_val,
+                           const jerry_value_t args_p[],
+                           const jerry_length_t args_cnt,
+                           jerry_value_t *ret_val_p);
+
+bool zjs_aio_pid_on(const jerry_object_t *function_obj_p,
+                    const jerry_value_t this_val,
+                    const jerry_value_t args_p[],
+                    const jerry_length_t args_cnt,
+                    jerry_value_t *ret_val_p);
+
+bool zjs_aio_pid_stop(const jerry_object_t *function_obj_p,
+                      const jerry_value_t this_val,
+                      const jerry_value_t args_p[],
+                      const jerry_length_t args_cnt,
+                      jerry_value_t *ret_val_p);
+
+bool zjs_aio_get_ipm_stats(const jerry_object_t *function_obj_p,
+                           const jerry_value_t this_val,
+                           const jerry_value_t args_p[],
+                           const jerry_length_t args_cnt,
+                           jerry_value_t *ret_val_p);
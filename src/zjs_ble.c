@@ -17,6 +17,9 @@
 
 #define ZJS_BLE_UUID_LEN                            36
 
+// longest attribute value ATT allows, for values kept in native memory
+#define ZJS_BLE_VALUE_MAX                           512
+
 #define ZJS_BLE_RESULT_SUCCESS                      0x00
 #define ZJS_BLE_RESULT_INVALID_OFFSET               BT_ATT_ERR_INVALID_OFFSET
 #define ZJS_BLE_RESULT_ATTR_NOT_LONG                BT_ATT_ERR_ATTRIBUTE_NOT_LONG
@@ -78,6 +81,11 @@ struct zjs_ble_characteristic {
     struct zjs_ble_subscribe_callback subscribe_cb;
     struct zjs_ble_unsubscribe_callback unsubscribe_cb;
     struct zjs_ble_notify_callback notify_cb;
+    // a copy of the value JS last set, if it set one; reads are then served
+    //   from here in the BT fiber instead of through onReadRequest
+    uint8_t *value;
+    uint16_t value_size;
+    uint16_t value_capacity;
     struct zjs_ble_characteristic *next;
 };
 
@@ -119,7 +127,7 @@ static void zjs_ble_free_characteristics(struct zjs_ble_characteristic *chrc)
         tmp = chrc;
         chrc = chrc->next;
 
-        jerry_release_object(chrc->chrc_obj);
+        jerry_release_object(tmp->chrc_obj);
 
         if (tmp->read_cb.zjs_cb.js_callback)
             jerry_release_object(tmp->read_cb.zjs_cb.js_callback);
@@ -131,6 +139,8 @@ static void zjs_ble_free_characteristics(struct zjs_ble_characteristic *chrc)
             jerry_release_object(tmp->unsubscribe_cb.zjs_cb.js_callback);
         if (tmp->notify_cb.zjs_cb.js_callback)
             jerry_release_object(tmp->notify_cb.zjs_cb.js_callback);
+        if (tmp->value)
+            task_free(tmp->value);
 
         task_free(tmp);
     }
@@ -240,10 +250,6 @@ static ssize_t zjs_ble_read_attr_callback(struct bt_conn *conn,
                                           void *buf, uint16_t len,
                                           uint16_t offset)
 {
-    if (offset > len) {
-        return BT_GATT_ERR(BT_ATT_ERR_INVALID_OFFSET);
-    }
-
     struct zjs_ble_characteristic* chrc = attr->user_data;
 
     if (!chrc) {
@@ -251,6 +257,18 @@ static ssize_t zjs_ble_read_attr_callback(struct bt_conn *conn,
         return BT_GATT_ERR(BT_ATT_ERR_INVALID_HANDLE);
     }
 
+    if (chrc->value) {
+        // answer from the native copy right here, without waiting on JS; the
+        //   task only changes it with interrupts locked, and can't run while
+        //   this fiber does
+        return bt_gatt_attr_read(conn, attr, buf, len, offset, chrc->value,
+                                 chrc->value_size);
+    }
+
+    if (offset > len) {
+        return BT_GATT_ERR(BT_ATT_ERR_INVALID_OFFSET);
+    }
+
     if (chrc->read_cb.zjs_cb.js_callback) {
         // This is from the FIBER context, so we queue up the callback
         // to invoke js from task context
@@ -395,6 +413,102 @@ static ssize_t zjs_ble_write_attr_callback(struct bt_conn *conn,
     return BT_GATT_ERR(BT_ATT_ERR_UNLIKELY);
 }
 
+struct zjs_ble_characteristic *zjs_ble_get_characteristic(jerry_object_t *chrc_obj)
+{
+    // requires: called only from task context
+    //  effects: returns the native characteristic behind a Characteristic
+    //             object, or NULL if it hasn't been passed to setServices
+    uintptr_t ptr;
+    if (!jerry_get_object_native_handle(chrc_obj, &ptr))
+        return NULL;
+
+    // other objects have native handles too, so only trust one that is a
+    //   registered characteristic's
+    struct zjs_ble_characteristic *chrc;
+    for (chrc = zjs_ble_service.characteristics; chrc; chrc = chrc->next) {
+        if ((uintptr_t)chrc == ptr && chrc->chrc_obj == chrc_obj)
+            return chrc;
+    }
+    return NULL;
+}
+
+void zjs_ble_notify(struct zjs_ble_characteristic *chrc, const void *data,
+                    uint16_t len)
+{
+    // requires: chrc came from zjs_ble_get_characteristic; not called from
+    //             an ISR
+    //  effects: notifies the connected central of the characteristic's new
+    //             value, if there is one
+    struct bt_conn *conn = zjs_ble_default_conn;
+    if (conn && chrc->chrc_attr)
+        bt_gatt_notify(conn, chrc->chrc_attr, data, len);
+}
+
+static bool zjs_ble_cache_value(struct zjs_ble_characteristic *chrc,
+                                const void *data, uint32_t size)
+{
+    // requires: called only from task context
+    //  effects: replaces the characteristic's native copy of its value with
+    //             size bytes from data, growing it if needed; returns false
+    //             if the value is too long or there's no memory
+    if (size > ZJS_BLE_VALUE_MAX) {
+        PRINT("error: characteristic value over %d bytes\n",
+              ZJS_BLE_VALUE_MAX);
+        return false;
+    }
+
+    uint8_t *value = chrc->value, *old = NULL;
+    if (!value || size > chrc->value_capacity) {
+        value = task_malloc(size ? size : 1);
+        if (!value) {
+            PRINT("error: out of memory allocating characteristic value\n");
+            return false;
+        }
+        old = chrc->value;
+        chrc->value_capacity = size;
+    }
+
+    // keep the BT fiber from seeing a half-written value
+    int key = irq_lock();
+    memcpy(value, data, size);
+    chrc->value = value;
+    chrc->value_size = size;
+    irq_unlock(key);
+
+    if (old)
+        task_free(old);
+    return true;
+}
+
+static bool zjs_ble_set_value(const jerry_object_t *function_obj_p,
+                              const jerry_value_t this_val,
+                              const jerry_value_t args_p[],
+                              const jerry_length_t args_cnt,
+                              jerry_value_t *ret_val_p)
+{
+    // requires: this_val is a Characteristic object, arg 0 is a Buffer of up
+    //             to 512 bytes
+    //  effects: makes the buffer's contents the characteristic's value; from
+    //             then on, reads are answered from a native copy and
+    //             onReadRequest isn't called; before setServices, the buffer
+    //             is kept as the value property and copied in then
+    struct zjs_buffer_t *buf = NULL;
+    if (args_cnt >= 1 && jerry_value_is_object(args_p[0]))
+        buf = zjs_buffer_find(jerry_get_object_value(args_p[0]));
+    if (!buf || buf->bufsize > ZJS_BLE_VALUE_MAX) {
+        PRINT("zjs_ble_set_value: invalid arguments\n");
+        return false;
+    }
+
+    jerry_object_t *obj = jerry_get_object_value(this_val);
+    jerry_set_object_field_value(obj, (jerry_char_t *)"value", args_p[0]);
+
+    struct zjs_ble_characteristic *chrc = zjs_ble_get_characteristic(obj);
+    if (chrc)
+        return zjs_ble_cache_value(chrc, buf->buffer, buf->bufsize);
+    return true;
+}
+
 static bool zjs_ble_update_value_call_function(const jerry_object_t *function_obj_p,
                                                const jerry_value_t this_val,
                                                const jerry_value_t args_p[],
@@ -412,15 +526,10 @@ static bool zjs_ble_update_value_call_function(const jerry_object_t *function_ob
     struct zjs_buffer_t *buf = zjs_buffer_find(obj);
 
     if (buf) {
-        if (zjs_ble_default_conn) {
-            uintptr_t ptr;
-            if (jerry_get_object_native_handle(jerry_get_object_value(this_val), &ptr)) {
-               struct zjs_ble_characteristic *chrc = (struct zjs_ble_characteristic*)ptr;
-               if (chrc->chrc_attr) {
-                   bt_gatt_notify(zjs_ble_default_conn, chrc->chrc_attr, buf->buffer, buf->bufsize);
-               }
-            }
-        }
+        struct zjs_ble_characteristic *chrc;
+        chrc = zjs_ble_get_characteristic(jerry_get_object_value(this_val));
+        if (chrc)
+            zjs_ble_notify(chrc, buf->buffer, buf->bufsize);
 
         return true;
     }
@@ -876,6 +985,20 @@ bool zjs_ble_parse_characteristic(jerry_object_t *chrc_obj,
         }
     }
 
+    // a Buffer value, given up front or with setValue, opts in to serving
+    //   reads natively
+    jerry_value_t v_value = jerry_get_object_field_value(chrc_obj, "value");
+    if (jerry_value_is_object(v_value)) {
+        struct zjs_buffer_t *buf =
+            zjs_buffer_find(jerry_get_object_value(v_value));
+        if (!buf || !zjs_ble_cache_value(chrc, buf->buffer, buf->bufsize)) {
+            PRINT("characteristic value isn't a valid Buffer\n");
+            jerry_release_value(v_value);
+            return false;
+        }
+    }
+    jerry_release_value(v_value);
+
     jerry_value_t v_func;
     v_func = jerry_get_object_field_value(chrc_obj, "onReadRequest");
     if (jerry_value_is_function(v_func)) {
@@ -1050,7 +1173,7 @@ bool zjs_ble_register_service(struct zjs_ble_service *service)
         // DESCRIPTOR
         entry_index++;
         bt_attrs[entry_index].uuid = ch->uuid;
-        if (ch->read_cb.zjs_cb.js_callback) {
+        if (ch->read_cb.zjs_cb.js_callback || ch->value) {
             bt_attrs[entry_index].perm |= BT_GATT_PERM_READ;
         }
         if (ch->write_cb.zjs_cb.js_callback) {
@@ -1224,6 +1347,8 @@ bool zjs_ble_characteristic(const jerry_object_t *function_obj_p,
                                  (jerry_char_t *)"RESULT_UNLIKELY_ERROR",
                                  val);
 
+    zjs_obj_add_function(obj, zjs_ble_set_value, "setValue");
+
     *ret_val_p = args_p[0];
 
     return true;
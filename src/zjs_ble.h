@@ -2,10 +2,16 @@
 
 #include "jerry-api.h"
 
+struct zjs_ble_characteristic;
+
 jerry_object_t *zjs_ble_init();
 
 void zjs_ble_enable();
 
+struct zjs_ble_characteristic *zjs_ble_get_characteristic(jerry_object_t *chrc_obj);
+void zjs_ble_notify(struct zjs_ble_characteristic *chrc, const void *data,
+                    uint16_t len);
+
 bool zjs_ble_on(const jerry_object_t *function_obj_p,
                 const jerry_value_t this_val,
                 const jerry_value_t args_p[],
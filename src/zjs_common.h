@@ -12,3 +12,16 @@
 
 // TODO: We should instead have a macro that changes in debug vs. release build,
 // to save string space and instead print error codes or something for release.
+
+// Keeps the compiler from reordering memory accesses across this point; used
+//   where data is shared with an ISR or the other core without a lock
+#define ZJS_BARRIER() __asm__ __volatile__ ("" ::: "memory")
+
+// Also keeps the CPU from reordering: stores before it are seen by the other
+//   core before loads after it are made; needed where each side stores one
+//   word and then loads the other's, as the IPM ring doorbell does
+#ifdef __arc__
+#define ZJS_FENCE() __asm__ __volatile__ ("sync" ::: "memory")
+#else
+#define ZJS_FENCE() __sync_synchronize()
+#endif
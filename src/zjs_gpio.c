@@ -3,11 +3,14 @@
 // Zephyr includes
 #include <zephyr.h>
 #include <gpio.h>
+#include <counter.h>
+#include <atomic.h>
 #include <misc/util.h>
 #include <string.h>
 
 // ZJS includes
 #include "zjs_gpio.h"
+#include "zjs_buffer.h"
 #include "zjs_util.h"
 
 static const char *ZJS_DIR_IN = "in";
@@ -23,28 +26,128 @@ static const char *ZJS_PULL_UP = "up";
 static const char *ZJS_PULL_DOWN = "down";
 
 static const char *ZJS_CHANGE = "change";
+static const char *ZJS_COMPLETE = "complete";
+static const char *ZJS_UNDERRUN = "underrun";
+
+// pulse measurement states
+#define ZJS_PULSE_IDLE          0
+#define ZJS_PULSE_WAIT_START    1
+#define ZJS_PULSE_WAIT_END      2
+#define ZJS_PULSE_DONE          3
+#define ZJS_PULSE_TIMEOUT       4
 
 static struct device *zjs_gpio_dev;
 
+// the always-on periodic timer that waveforms are played from
+static struct device *zjs_gpio_wave_timer;
+
+// last value written to the whole output port, so that masked updates can be
+//   done with a single port write; only touch with interrupts locked
+static uint32_t zjs_gpio_port_shadow;
+
+// native state behind a GPIOGroup object
+struct zjs_gpio_group {
+    uint32_t mask;          // port bits covered by the group
+    uint32_t invert;        // port bits of pins that are active low
+    uint32_t count;         // number of pins in the group
+    uint8_t bits[32];       // port bit used for each logical bit
+};
+
 int (*zjs_gpio_convert_pin)(int num) = zjs_identity;
 
+// number of edges buffered per pin between JS dispatches; must be a power of 2
+#define ZJS_GPIO_EVENT_RING_SIZE 16
+
+struct zjs_gpio_event {
+    uint32_t timestamp;     // hw cycle count when the edge was seen
+    uint32_t value;         // logical pin value sampled right after the edge
+};
+
+// one-shot pulse width measurement, driven by the edge ISR
+struct zjs_gpio_pulse {
+    volatile uint32_t state;
+    uint32_t level;         // logical level of the pulse to time
+    uint32_t start;         // hw cycle count when the pulse began
+    uint32_t width;         // pulse width in hw cycles
+    uint32_t deadline;      // hw cycle count to give up at
+    struct zjs_callback zjs_cb;
+};
+
+// edge counting, reported once per window
+struct zjs_gpio_counter {
+    bool active;
+    volatile uint32_t edges;    // edges counted so far this window
+    uint32_t window;            // window length in hw cycles
+    uint32_t window_start;      // hw cycle count when the window began
+    uint32_t count;             // edges seen in the last full window
+    uint32_t elapsed;           // length of the last full window in hw cycles
+    atomic_t queued;
+    struct zjs_callback zjs_cb;
+};
+
+// debounced pins are re-read, pulse measurements timed out and counting
+//   windows closed from this fiber, so they happen on time whatever the JS
+//   main loop is doing
+#define ZJS_GPIO_TIMER_STACK_SIZE 512
+#define ZJS_GPIO_TIMER_PRIORITY 1
+
+static char __stack zjs_gpio_timer_stack[ZJS_GPIO_TIMER_STACK_SIZE];
+static struct nano_sem zjs_gpio_timer_sem;
+static bool zjs_gpio_timer_started = false;
+
 // This is complicated. One thing going on here is that the GPIO functions do
 //   not let you set any "user data" to be returned to you later. So if you need
 //   to associate data, you have to embed the gpio callback within a bigger
 //   struct like this, and use CONTAINER_OF to get back to your struct.
-// The reason for the *list* is just so we're able to find the allocated struct
-//   again if it needs to be freed, which we're not really using yet, unless the
-//   pin object gets GC'd which hasn't been tested.
-// It looks like pin_obj isn't really needed at this time.
+// The list lets us find a pin object's struct again, and lets the timer
+//   fiber visit every pin. A struct lives until its pin object is GC'd, even
+//   while nothing is using it, so the object's native handle never points at
+//   freed memory; it's only freed then once none of its callbacks are still
+//   waiting in the callback fifo.
+// The events array is a single-producer, single-consumer ring: the ISR only
+//   ever advances head and the task only ever advances tail, so neither side
+//   needs a lock. The queued flag keeps the ISR from putting zjs_cb in the
+//   callback fifo a second time while it is still waiting to be run.
+// A debounced pin's ISR only notes the time of each edge; the timer fiber
+//   reads the pin again once it has been quiet for the debounce time and
+//   reports the level only if it differs from the one JS last saw, so a
+//   glitch that undoes itself is never reported at all. The list and the
+//   settling state are shared with that fiber, so only change them with
+//   interrupts locked.
 struct zjs_cb_list_item {
     struct gpio_callback gpio_cb;
     jerry_object_t *pin_obj;
     struct zjs_callback zjs_cb;
+    uint32_t pin;           // converted pin number
+    bool output;            // opened with direction "out"
+    bool activeLow;
+    bool enabled;           // pin interrupt is on
+    bool freed;             // pin object is gone, free once nothing's queued
+    bool both;              // interrupts on both edges
+    uint32_t edge_value;    // logical level a single edge interrupt lands on
+    uint32_t debounce;      // quiet time needed before reporting, in hw cycles
+    bool settling;          // waiting for the pin to stay quiet
+    uint32_t settle_edges;  // edges seen since settling began
+    uint32_t last_edge;     // hw cycle count of the most recent edge
+    uint32_t last_value;    // last logical value reported to JS
+    uint32_t bounces;       // edges suppressed by debouncing
+    atomic_t queued;
+    volatile uint32_t head;
+    volatile uint32_t tail;
+    atomic_t dropped;       // edges lost because the ring was full
+    struct zjs_gpio_event events[ZJS_GPIO_EVENT_RING_SIZE];
+    struct zjs_gpio_pulse pulse;
+    struct zjs_gpio_counter counter;
+    zjs_gpio_tap_t tap;     // native code fed every edge, from the ISR
+    void *tap_context;
     struct zjs_cb_list_item *next;
 };
 
 static struct zjs_cb_list_item *zjs_cb_list = NULL;
 
+static void zjs_gpio_item_release(struct zjs_cb_list_item *item);
+static void zjs_gpio_timer_kick();
+
 static struct zjs_cb_list_item *zjs_gpio_callback_alloc()
 {
     // effects: allocates a new callback list item and adds it to the list
@@ -54,9 +157,12 @@ static struct zjs_cb_list_item *zjs_gpio_callback_alloc()
         PRINT("error: out of memory allocating callback struct\n");
         return NULL;
     }
+    memset(item, 0, sizeof(struct zjs_cb_list_item));
 
+    int key = irq_lock();
     item->next = zjs_cb_list;
     zjs_cb_list = item;
+    irq_unlock(key);
     return item;
 }
 
@@ -72,50 +178,452 @@ static struct zjs_cb_list_item *zjs_gpio_find(jerry_object_t *pin_obj)
     return NULL;
 }
 
+static bool zjs_gpio_item_queued(struct zjs_cb_list_item *item)
+{
+    // effects: returns true if any of the pin's callbacks are waiting in the
+    //            callback fifo
+    return atomic_get(&item->queued) || atomic_get(&item->counter.queued) ||
+        item->pulse.state == ZJS_PULSE_DONE ||
+        item->pulse.state == ZJS_PULSE_TIMEOUT;
+}
+
+static bool zjs_gpio_item_reap(struct zjs_cb_list_item *item)
+{
+    // requires: called only from task context, from a callback function
+    //  effects: returns true if the pin object is gone, in which case the
+    //             item has been freed if that was the last queued callback
+    if (!item->freed)
+        return false;
+    if (!zjs_gpio_item_queued(item))
+        task_free(item);
+    return true;
+}
+
 static void zjs_gpio_callback_free(uintptr_t handle)
 {
     // requires: handle is the native pointer we registered with
     //             jerry_set_object_native_handle
-    //  effects: frees the callback list item for the given pin object
+    //  effects: stops the pin's interrupts and timers and frees its list
+    //             item, or leaves that to the last of its queued callbacks
+    struct zjs_cb_list_item *item = (struct zjs_cb_list_item *)handle;
+    gpio_pin_disable_callback(zjs_gpio_dev, item->pin);
+    gpio_remove_callback(zjs_gpio_dev, &item->gpio_cb);
+
+    // once it's off the list, neither the ISR nor the timer fiber can
+    //   queue anything more for it
+    int key = irq_lock();
     struct zjs_cb_list_item **pItem = &zjs_cb_list;
-    while (*pItem) {
-        struct zjs_cb_list_item *item = *pItem;
-        if ((uintptr_t)item == handle) {
-            uint32_t pin;
-            zjs_obj_get_uint32(item->pin_obj, "pin", &pin);
-            gpio_pin_disable_callback(zjs_gpio_dev, pin);
-            gpio_remove_callback(zjs_gpio_dev, &item->gpio_cb);
-            jerry_release_object(item->zjs_cb.js_callback);
-
-            *pItem = item->next;
-            task_free((void *)handle);
-        }
+    while (*pItem && *pItem != item)
         pItem = &(*pItem)->next;
+    if (*pItem)
+        *pItem = item->next;
+    if (item->pulse.state == ZJS_PULSE_WAIT_START ||
+        item->pulse.state == ZJS_PULSE_WAIT_END)
+        item->pulse.state = ZJS_PULSE_IDLE;
+    item->counter.active = false;
+    item->settling = false;
+    irq_unlock(key);
+
+    if (item->zjs_cb.js_callback)
+        jerry_release_object(item->zjs_cb.js_callback);
+    if (item->pulse.zjs_cb.js_callback)
+        jerry_release_object(item->pulse.zjs_cb.js_callback);
+    if (item->counter.zjs_cb.js_callback)
+        jerry_release_object(item->counter.zjs_cb.js_callback);
+    item->zjs_cb.js_callback = NULL;
+    item->pulse.zjs_cb.js_callback = NULL;
+    item->counter.zjs_cb.js_callback = NULL;
+    item->pin_obj = NULL;
+
+    item->freed = true;
+    zjs_gpio_item_reap(item);
+}
+
+static void zjs_gpio_edge(struct zjs_cb_list_item *mycb, uint32_t now,
+                          uint32_t logical)
+{
+    // requires: called from ISR context or with interrupts locked; now is
+    //             the hw cycle count of the edge, logical the level after it
+    //  effects: feeds the edge to the counter, tap and pulse measurement,
+    //             records a timestamped event in the pin's ring and queues
+    //             up the JS callback for execution, unless it is already
+    //             queued
+    if (mycb->counter.active)
+        mycb->counter.edges++;
+
+    if (mycb->tap)
+        mycb->tap(mycb->tap_context, logical);
+
+    struct zjs_gpio_pulse *pulse = &mycb->pulse;
+    if (pulse->state == ZJS_PULSE_WAIT_START && logical == pulse->level) {
+        pulse->start = now;
+        pulse->state = ZJS_PULSE_WAIT_END;
+    }
+    else if (pulse->state == ZJS_PULSE_WAIT_END && logical != pulse->level) {
+        pulse->width = now - pulse->start;
+        pulse->state = ZJS_PULSE_DONE;
+        zjs_queue_callback(&pulse->zjs_cb);
     }
+
+    if (!mycb->zjs_cb.js_callback)
+        return;
+
+    uint32_t head = mycb->head;
+    if (head - mycb->tail < ZJS_GPIO_EVENT_RING_SIZE) {
+        struct zjs_gpio_event *ev;
+        ev = &mycb->events[head & (ZJS_GPIO_EVENT_RING_SIZE - 1)];
+        ev->timestamp = now;
+        ev->value = logical;
+        // publish the event only after it has been written
+        ZJS_BARRIER();
+        mycb->head = head + 1;
+    }
+    else {
+        atomic_inc(&mycb->dropped);
+    }
+
+    if (!atomic_set(&mycb->queued, 1))
+        zjs_queue_callback(&mycb->zjs_cb);
 }
 
 static void zjs_gpio_callback_wrapper(struct device *port,
                                       struct gpio_callback *cb,
                                       uint32_t pins)
 {
-    // effects: handles C callback; queues up the JS callback for execution
+    // requires: called from ISR context
+    //  effects: reports the edge, or for a debounced pin, (re)starts its
+    //             quiet time and wakes the timer fiber to wait it out
+    uint32_t now = sys_cycle_get_32();
     struct zjs_cb_list_item *mycb = CONTAINER_OF(cb, struct zjs_cb_list_item,
                                                  gpio_cb);
-    zjs_queue_callback(&mycb->zjs_cb);
+
+    if (mycb->debounce) {
+        mycb->last_edge = now;
+        mycb->settle_edges++;
+        if (!mycb->settling) {
+            mycb->settling = true;
+            nano_isr_sem_give(&zjs_gpio_timer_sem);
+        }
+        return;
+    }
+
+    uint32_t value = 0;
+    gpio_pin_read(port, mycb->pin, &value);
+    uint32_t logical = (value && !mycb->activeLow) ||
+                       (!value && mycb->activeLow);
+    zjs_gpio_edge(mycb, now, logical);
+}
+
+static void zjs_gpio_settle(struct zjs_cb_list_item *mycb)
+{
+    // requires: called with interrupts locked, once the pin has been quiet
+    //             for its debounce time
+    //  effects: re-reads the pin and reports it, timestamped with the last
+    //             edge, if the level changed; every other edge seen while
+    //             settling counts as a bounce
+    uint32_t value = 0;
+    gpio_pin_read(zjs_gpio_dev, mycb->pin, &value);
+    uint32_t logical = (value && !mycb->activeLow) ||
+                       (!value && mycb->activeLow);
+
+    // a single edge pin isn't told when the level goes back, so just check
+    //   the pin settled at the level its edge leads to
+    bool changed = mycb->both ? logical != mycb->last_value :
+                                logical == mycb->edge_value;
+    mycb->bounces += mycb->settle_edges - (changed ? 1 : 0);
+    mycb->settle_edges = 0;
+    mycb->settling = false;
+    mycb->last_value = logical;
+
+    if (changed)
+        zjs_gpio_edge(mycb, mycb->last_edge, logical);
+}
+
+static int32_t zjs_gpio_timer_due(struct zjs_cb_list_item *item,
+                                  uint32_t now)
+{
+    // requires: called with interrupts locked, now is the hw cycle count
+    //  effects: settles the pin, times out its pulse measurement and closes
+    //             its counting window if they are due; returns the hw cycles
+    //             until the next of them is, or -1 if none are pending
+    int32_t next = -1;
+    if (item->settling) {
+        int32_t left = (int32_t)(item->last_edge + item->debounce - now);
+        if (left <= 0)
+            zjs_gpio_settle(item);
+        else
+            next = left;
+    }
+
+    struct zjs_gpio_pulse *pulse = &item->pulse;
+    if (pulse->state == ZJS_PULSE_WAIT_START ||
+        pulse->state == ZJS_PULSE_WAIT_END) {
+        int32_t left = (int32_t)(pulse->deadline - now);
+        if (left <= 0) {
+            pulse->state = ZJS_PULSE_TIMEOUT;
+            zjs_queue_callback(&pulse->zjs_cb);
+        }
+        else if (next < 0 || left < next) {
+            next = left;
+        }
+    }
+
+    struct zjs_gpio_counter *counter = &item->counter;
+    if (counter->active) {
+        int32_t left = (int32_t)(counter->window_start + counter->window -
+                                 now);
+        if (left <= 0) {
+            // the rate is worked out in the callback; fibers can't use the
+            //   FPU
+            counter->count = counter->edges;
+            counter->elapsed = now - counter->window_start;
+            counter->edges = 0;
+            counter->window_start = now;
+            if (!atomic_set(&counter->queued, 1))
+                zjs_queue_callback(&counter->zjs_cb);
+            left = counter->window;
+        }
+        if (next < 0 || left < next)
+            next = left;
+    }
+    return next;
+}
+
+static void zjs_gpio_timer_fiber(int arg1, int arg2)
+{
+    // effects: settles debounced pins, times out pulse measurements and
+    //            closes counting windows as they come due, sleeping until
+    //            the next one is, or until one starts when none are pending
+    while (1) {
+        int32_t next = -1;
+        int key = irq_lock();
+        uint32_t now = sys_cycle_get_32();
+        for (struct zjs_cb_list_item *item = zjs_cb_list; item;
+             item = item->next) {
+            int32_t left = zjs_gpio_timer_due(item, now);
+            if (left >= 0 && (next < 0 || left < next))
+                next = left;
+        }
+        irq_unlock(key);
+
+        // round up, since waking early would only mean another pass
+        int32_t ticks = TICKS_UNLIMITED;
+        if (next >= 0)
+            ticks = next / sys_clock_hw_cycles_per_tick + 1;
+        nano_fiber_sem_take(&zjs_gpio_timer_sem, ticks);
+    }
+}
+
+static void zjs_gpio_timer_kick()
+{
+    // requires: called only from task context
+    //  effects: starts the timer fiber if needed, and wakes it to pick up a
+    //             new deadline
+    if (!zjs_gpio_timer_started) {
+        nano_sem_init(&zjs_gpio_timer_sem);
+        fiber_start(zjs_gpio_timer_stack, ZJS_GPIO_TIMER_STACK_SIZE,
+                    zjs_gpio_timer_fiber, 0, 0, ZJS_GPIO_TIMER_PRIORITY, 0);
+        zjs_gpio_timer_started = true;
+    }
+    nano_task_sem_give(&zjs_gpio_timer_sem);
 }
 
 static void zjs_gpio_call_function(struct zjs_callback *cb)
 {
     // requires: called only from task context
-    //  effects: handles execution of the JS callback when ready
-    jerry_value_t rval = jerry_call_function(cb->js_callback, NULL, NULL, 0);
+    //  effects: drains the pin's event ring and calls the JS callback once
+    //             with an array of {value, timestamp} objects, oldest first
+    struct zjs_cb_list_item *mycb = CONTAINER_OF(cb, struct zjs_cb_list_item,
+                                                 zjs_cb);
+
+    // clear this first so an edge arriving while we drain queues us again
+    atomic_clear(&mycb->queued);
+    if (zjs_gpio_item_reap(mycb))
+        return;
+
+    uint32_t tail = mycb->tail;
+    uint32_t head = mycb->head;
+    ZJS_BARRIER();
+
+    jerry_object_t *array = jerry_create_array_object(head - tail);
+    for (uint32_t i = 0; tail != head; i++, tail++) {
+        struct zjs_gpio_event *ev;
+        ev = &mycb->events[tail & (ZJS_GPIO_EVENT_RING_SIZE - 1)];
+
+        jerry_object_t *evobj = jerry_create_object();
+        zjs_obj_add_boolean(evobj, ev->value, "value");
+        zjs_obj_add_number(evobj, ev->timestamp, "timestamp");
+
+        jerry_value_t val = jerry_create_object_value(evobj);
+        jerry_set_array_index_value(array, i, val);
+        jerry_release_value(val);
+    }
+    ZJS_BARRIER();
+    mycb->tail = tail;
+
+    // swap the count out so an edge dropped meanwhile isn't lost
+    uint32_t dropped = atomic_clear(&mycb->dropped);
+    if (dropped) {
+        PRINT("warning: %lu GPIO events dropped on pin #%lu\n", dropped,
+              mycb->pin);
+    }
+
+    jerry_value_t arg = jerry_create_object_value(array);
+    if (cb->js_callback) {
+        jerry_value_t rval = jerry_call_function(cb->js_callback, NULL, &arg,
+                                                 1);
+        if (jerry_value_is_error(rval)) {
+            PRINT("error: calling gpio callback\n");
+        }
+        jerry_release_value(rval);
+    }
+    jerry_release_value(arg);
+}
+
+static void zjs_gpio_pulse_call_function(struct zjs_callback *cb)
+{
+    // requires: called only from task context
+    //  effects: reports a finished pulse measurement to JS, with the width in
+    //             microseconds, or null if it timed out
+    struct zjs_gpio_pulse *pulse = CONTAINER_OF(cb, struct zjs_gpio_pulse,
+                                                zjs_cb);
+    struct zjs_cb_list_item *item = CONTAINER_OF(pulse, struct zjs_cb_list_item,
+                                                 pulse);
+    if (item->freed) {
+        pulse->state = ZJS_PULSE_IDLE;
+        zjs_gpio_item_reap(item);
+        return;
+    }
+
+    jerry_value_t arg;
+    if (pulse->state == ZJS_PULSE_DONE) {
+        arg = jerry_create_number_value((double)pulse->width * 1000000 /
+                                        sys_clock_hw_cycles_per_sec);
+    }
+    else {
+        arg = jerry_create_null_value();
+    }
+    pulse->state = ZJS_PULSE_IDLE;
+
+    jerry_object_t *func = cb->js_callback;
+    cb->js_callback = NULL;
+    if (func) {
+        jerry_value_t rval = jerry_call_function(func, item->pin_obj, &arg, 1);
+        if (jerry_value_is_error(rval)) {
+            PRINT("error: calling measurePulse callback\n");
+        }
+        jerry_release_value(rval);
+        jerry_release_object(func);
+    }
+    jerry_release_value(arg);
+
+    zjs_gpio_item_release(item);
+}
+
+static void zjs_gpio_counter_call_function(struct zjs_callback *cb)
+{
+    // requires: called only from task context
+    //  effects: reports the last counting window to JS as (rate, count),
+    //             with the rate in edges per second
+    struct zjs_gpio_counter *counter = CONTAINER_OF(cb, struct zjs_gpio_counter,
+                                                    zjs_cb);
+    struct zjs_cb_list_item *item = CONTAINER_OF(counter,
+                                                 struct zjs_cb_list_item,
+                                                 counter);
+    atomic_clear(&counter->queued);
+    if (zjs_gpio_item_reap(item))
+        return;
+
+    if (!counter->active || !cb->js_callback)
+        return;
+
+    jerry_value_t args[2];
+    args[0] = jerry_create_number_value((double)counter->count *
+                                        sys_clock_hw_cycles_per_sec /
+                                        counter->elapsed);
+    args[1] = jerry_create_number_value(counter->count);
+    jerry_value_t rval = jerry_call_function(cb->js_callback, item->pin_obj,
+                                             args, 2);
     if (jerry_value_is_error(rval)) {
-        PRINT("error: calling gpio callback\n");
+        PRINT("error: calling startCounting callback\n");
     }
     jerry_release_value(rval);
-    // NOTE: this function is actually generic and could serve to call any
-    //   JS callback function with no args, so we may move it to a generic
-    //   name as we discover how often this comes up
+}
+
+static struct zjs_cb_list_item *zjs_gpio_item_new(jerry_object_t *pinobj,
+                                                   uint32_t pin, bool output,
+                                                   bool activeLow,
+                                                   const char *edge,
+                                                   uint32_t debounce)
+{
+    // requires: called only from zjs_gpio_open, pin is a converted pin number
+    //  effects: creates the native state for a new GPIOPin object, with its
+    //             interrupt callback added but not enabled
+    struct zjs_cb_list_item *item = zjs_gpio_callback_alloc();
+    if (!item)
+        return NULL;
+
+    gpio_init_callback(&item->gpio_cb, zjs_gpio_callback_wrapper, BIT(pin));
+    item->pin_obj = pinobj;
+    item->pin = pin;
+    item->output = output;
+    item->activeLow = activeLow;
+    item->both = !strcmp(edge, ZJS_EDGE_BOTH);
+    item->edge_value = !strcmp(edge, ZJS_EDGE_FALLING) ? activeLow : !activeLow;
+    item->debounce = debounce * (sys_clock_hw_cycles_per_sec / 1000);
+    item->zjs_cb.call_function = zjs_gpio_call_function;
+    item->pulse.zjs_cb.call_function = zjs_gpio_pulse_call_function;
+    item->counter.zjs_cb.call_function = zjs_gpio_counter_call_function;
+
+    uint32_t value = 0;
+    gpio_pin_read(zjs_gpio_dev, pin, &value);
+    item->last_value = (value && !activeLow) || (!value && activeLow);
+
+    if (item->debounce)
+        zjs_gpio_timer_kick();
+
+    // watch for the object getting garbage collected, and clean up
+    jerry_set_object_native_handle(pinobj, (uintptr_t)item,
+                                   zjs_gpio_callback_free);
+
+    if (gpio_add_callback(zjs_gpio_dev, &item->gpio_cb)) {
+        PRINT("error: cannot setup callback!\n");
+        return NULL;
+    }
+    return item;
+}
+
+static struct zjs_cb_list_item *zjs_gpio_item_get(jerry_object_t *pinobj)
+{
+    // requires: called only from task context
+    //  effects: returns the native interrupt state for the pin, enabling the
+    //             pin's interrupt callback if needed; returns NULL if pinobj
+    //             isn't a GPIOPin object from zjs_gpio_open
+    struct zjs_cb_list_item *item = zjs_gpio_find(pinobj);
+    if (!item) {
+        PRINT("error: not a GPIO pin\n");
+        return NULL;
+    }
+
+    if (!item->enabled) {
+        if (gpio_pin_enable_callback(zjs_gpio_dev, item->pin)) {
+            PRINT("error: cannot enable callback!\n");
+            return NULL;
+        }
+        item->enabled = true;
+    }
+    return item;
+}
+
+static void zjs_gpio_item_release(struct zjs_cb_list_item *item)
+{
+    // effects: turns the pin's interrupt off once nothing is using it; the
+    //            item itself is kept until the pin object is GC'd
+    if (item->enabled && !item->zjs_cb.js_callback && !item->counter.active &&
+        item->pulse.state == ZJS_PULSE_IDLE && !item->tap) {
+        gpio_pin_disable_callback(zjs_gpio_dev, item->pin);
+        item->enabled = false;
+    }
 }
 
 jerry_object_t *zjs_gpio_init()
@@ -125,13 +633,109 @@ jerry_object_t *zjs_gpio_init()
     if (!zjs_gpio_dev) {
         PRINT("Cannot find GPIO_0 device\n");
     }
+    else {
+        gpio_port_read(zjs_gpio_dev, &zjs_gpio_port_shadow);
+    }
+    zjs_gpio_wave_timer = device_get_binding("AON_TIMER");
 
     // create GPIO object
     jerry_object_t *gpio_obj = jerry_create_object();
     zjs_obj_add_function(gpio_obj, zjs_gpio_open, "open");
+    zjs_obj_add_function(gpio_obj, zjs_gpio_open_group, "openGroup");
+    zjs_obj_add_function(gpio_obj, zjs_gpio_read_port, "readPort");
+    zjs_obj_add_function(gpio_obj, zjs_gpio_write_port, "writePort");
+    zjs_obj_add_function(gpio_obj, zjs_gpio_create_waveform, "createWaveform");
     return gpio_obj;
 }
 
+static int zjs_gpio_port_update(uint32_t mask, uint32_t value)
+{
+    // effects: sets the output port bits in mask to the matching bits in
+    //             value, leaving the others as they were, with one driver call
+    //             so all the pins change together
+    int key = irq_lock();
+    uint32_t port = (zjs_gpio_port_shadow & ~mask) | (value & mask);
+    int rval = gpio_port_write(zjs_gpio_dev, port);
+    if (!rval)
+        zjs_gpio_port_shadow = port;
+    irq_unlock(key);
+    return rval;
+}
+
+bool zjs_gpio_set_tap(jerry_object_t *pin_obj, zjs_gpio_tap_t tap,
+                      void *context)
+{
+    // requires: pin_obj is a GPIOPin object, called only from task context;
+    //             tap is called from the edge ISR, so it must not block
+    //  effects: calls tap with the logical value after each edge that gets
+    //             past the pin's debouncing, or stops if tap is NULL;
+    //             returns false if the pin already has a tap or its interrupt
+    //             couldn't be set up
+    if (!tap) {
+        struct zjs_cb_list_item *item = zjs_gpio_find(pin_obj);
+        if (item) {
+            int key = irq_lock();
+            item->tap = NULL;
+            irq_unlock(key);
+            zjs_gpio_item_release(item);
+        }
+        return true;
+    }
+
+    struct zjs_cb_list_item *item = zjs_gpio_find(pin_obj);
+    if (item && item->tap) {
+        PRINT("zjs_gpio_set_tap: pin %lu already has a tap\n", item->pin);
+        return false;
+    }
+
+    item = zjs_gpio_item_get(pin_obj);
+    if (!item)
+        return false;
+
+    int key = irq_lock();
+    item->tap = tap;
+    item->tap_context = context;
+    irq_unlock(key);
+    return true;
+}
+
+bool zjs_gpio_get_output(jerry_object_t *pin_obj, struct zjs_gpio_output *out)
+{
+    // requires: called only from task context
+    //  effects: fills in out with the converted pin and polarity of the
+    //             GPIOPin object pin_obj; returns false if it isn't one or
+    //             wasn't opened as an output
+    struct zjs_cb_list_item *item = zjs_gpio_find(pin_obj);
+    if (!item || !item->output)
+        return false;
+
+    out->pin = item->pin;
+    out->activeLow = item->activeLow;
+    return true;
+}
+
+int zjs_gpio_output_write(const struct zjs_gpio_output *out, bool logical)
+{
+    // requires: out came from zjs_gpio_get_output
+    //  effects: writes the logical value to the pin, keeping the port shadow
+    //             in sync for later masked port writes; returns the driver's
+    //             result
+    uint32_t value = 0;
+    if ((logical && !out->activeLow) || (!logical && out->activeLow))
+        value = 1;
+
+    int key = irq_lock();
+    int rval = gpio_pin_write(zjs_gpio_dev, out->pin, value);
+    if (!rval) {
+        if (value)
+            zjs_gpio_port_shadow |= BIT(out->pin);
+        else
+            zjs_gpio_port_shadow &= ~BIT(out->pin);
+    }
+    irq_unlock(key);
+    return rval;
+}
+
 bool zjs_gpio_open(const jerry_object_t *function_obj_p,
                    const jerry_value_t this_val,
                    const jerry_value_t args_p[],
@@ -140,7 +744,10 @@ bool zjs_gpio_open(const jerry_object_t *function_obj_p,
 {
     // requires: arg 0 is an object with these members: pin (int), direction
     //             (defaults to "out"), activeLow (defaults to false),
-    //             edge (defaults to "any"), pull (default to undefined)
+    //             edge (defaults to "any"), pull (default to undefined),
+    //             debounce in milliseconds (defaults to 0, no debouncing;
+    //             otherwise a change is reported once the pin has held it
+    //             that long, rounded up to the next tick)
     if (args_cnt < 1 || !jerry_value_is_object(args_p[0])) {
         PRINT("zjs_gpio_open: invalid argument\n");
         return false;
@@ -177,24 +784,20 @@ bool zjs_gpio_open(const jerry_object_t *function_obj_p,
     flags |= activeLow ? GPIO_POL_INV : GPIO_POL_NORMAL;
 
     const char *edge = ZJS_EDGE_NONE;
-    bool both = false;
     if (zjs_obj_get_string(data, "edge", buffer, BUFLEN)) {
         if (!strcmp(buffer, ZJS_EDGE_BOTH)) {
             flags |= GPIO_INT | GPIO_INT_DOUBLE_EDGE;
             edge = ZJS_EDGE_BOTH;
-            both = true;
         }
         else if (!strcmp(buffer, ZJS_EDGE_RISING)) {
             // Zephyr triggers on active edge, so we need to be "active high"
             flags |= GPIO_INT | GPIO_INT_EDGE | GPIO_INT_ACTIVE_HIGH;
             edge = ZJS_EDGE_RISING;
-            both = false;
         }
         else if (!strcmp(buffer, ZJS_EDGE_FALLING)) {
             // Zephyr triggers on active edge, so we need to be "active low"
             flags |= GPIO_INT | GPIO_INT_EDGE | GPIO_INT_ACTIVE_LOW;
             edge = ZJS_EDGE_FALLING;
-            both = false;
         }
         else if (strcmp(buffer, ZJS_EDGE_BOTH)) {
             PRINT("warning: invalid edge value provided\n");
@@ -219,6 +822,9 @@ bool zjs_gpio_open(const jerry_object_t *function_obj_p,
     if (pull == ZJS_PULL_NONE)
         flags |= GPIO_PUD_NORMAL;
 
+    uint32_t debounce = 0;
+    zjs_obj_get_uint32(data, "debounce", &debounce);
+
     int rval = gpio_pin_configure(zjs_gpio_dev, newpin, flags);
     if (rval) {
         PRINT("error: opening GPIO pin #%d! (%d)\n", newpin, rval);
@@ -230,13 +836,26 @@ bool zjs_gpio_open(const jerry_object_t *function_obj_p,
     zjs_obj_add_function(pinobj, zjs_gpio_pin_read, "read");
     zjs_obj_add_function(pinobj, zjs_gpio_pin_write, "write");
     zjs_obj_add_function(pinobj, zjs_gpio_pin_on, "on");
+    zjs_obj_add_function(pinobj, zjs_gpio_pin_get_bounce_count,
+                         "getBounceCount");
+    zjs_obj_add_function(pinobj, zjs_gpio_pin_measure_pulse, "measurePulse");
+    zjs_obj_add_function(pinobj, zjs_gpio_pin_start_counting,
+                         "startCounting");
+    zjs_obj_add_function(pinobj, zjs_gpio_pin_stop_counting, "stopCounting");
     zjs_obj_add_number(pinobj, pin, "pin");
     zjs_obj_add_string(pinobj, dirOut ? ZJS_DIR_OUT : ZJS_DIR_IN, "direction");
     zjs_obj_add_boolean(pinobj, activeLow, "activeLow");
     zjs_obj_add_string(pinobj, edge, "edge");
     zjs_obj_add_string(pinobj, pull, "pull");
+    zjs_obj_add_number(pinobj, debounce, "debounce");
     // TODO: When we implement close, we should release the reference on this
 
+    if (!zjs_gpio_item_new(pinobj, newpin, dirOut, activeLow, edge,
+                           debounce)) {
+        jerry_release_object(pinobj);
+        return false;
+    }
+
     *ret_val_p = jerry_create_object_value(pinobj);
     return true;
 }
@@ -291,19 +910,13 @@ bool zjs_gpio_pin_write(const jerry_object_t *function_obj_p,
     bool logical = jerry_get_boolean_value(args_p[0]);
     jerry_object_t *obj = jerry_get_object_value(this_val);
 
-    uint32_t pin;
-    zjs_obj_get_uint32(obj, "pin", &pin);
-    int newpin = zjs_gpio_convert_pin(pin);
-
-    bool activeLow = false;
-    zjs_obj_get_boolean(obj, "activeLow", &activeLow);
-
-    uint32_t value = 0;
-    if ((logical && !activeLow) || (!logical && activeLow))
-        value = 1;
-    int rval = gpio_pin_write(zjs_gpio_dev, newpin, value);
-    if (rval) {
-        PRINT("error: writing to GPIO #%d!\n", newpin);
+    struct zjs_gpio_output out;
+    if (!zjs_gpio_get_output(obj, &out)) {
+        PRINT("zjs_gpio_pin_write: pin is not an output\n");
+        return false;
+    }
+    if (zjs_gpio_output_write(&out, logical)) {
+        PRINT("error: writing to GPIO #%lu!\n", out.pin);
         return false;
     }
 
@@ -316,9 +929,11 @@ bool zjs_gpio_pin_on(const jerry_object_t *function_obj_p,
                      const jerry_length_t args_cnt,
                      jerry_value_t *ret_val_p)
 {
-    // requires: this_val is a GPIOPin object, the one arg is a JS callback
-    //             function
-    //  effects: registers this callback to be called when the GPIO changes
+    // requires: this_val is a GPIOPin object, arg 0 is "change", arg 1 is a JS
+    //             callback function
+    //  effects: registers this callback to be called when the GPIO changes;
+    //             it receives an array of the {value, timestamp} events seen
+    //             since it last ran, where timestamp is in hw cycles
     if (args_cnt < 2 || !jerry_value_is_string(args_p[0])) {
         PRINT("zjs_gpio_pin_on: invalid arguments\n");
         return false;
@@ -330,8 +945,6 @@ bool zjs_gpio_pin_on(const jerry_object_t *function_obj_p,
     }
 
     jerry_object_t *pinobj = jerry_get_object_value(this_val);
-    uint32_t pin;
-    zjs_obj_get_uint32(pinobj, "pin", &pin);
 
     jerry_object_t *func = NULL;
     if (jerry_value_is_object(args_p[1])) {
@@ -340,44 +953,732 @@ bool zjs_gpio_pin_on(const jerry_object_t *function_obj_p,
             func = NULL;
     }
 
-    // first free existing callback: updating more efficient but more code
     struct zjs_cb_list_item *item = zjs_gpio_find(pinobj);
     if (!func) {
         // no callback now, so return
-        if (item)
-            // first, free item if present
-            zjs_gpio_callback_free((uintptr_t)item);
+        if (item) {
+            if (item->zjs_cb.js_callback)
+                jerry_release_object(item->zjs_cb.js_callback);
+            item->zjs_cb.js_callback = NULL;
+            zjs_gpio_item_release(item);
+        }
         return true;
     }
 
-    if (!item) {
-        item = zjs_gpio_callback_alloc();
-        gpio_init_callback(&item->gpio_cb, zjs_gpio_callback_wrapper, BIT(pin));
-        item->pin_obj = pinobj;
-        item->zjs_cb.call_function = zjs_gpio_call_function;
+    item = zjs_gpio_item_get(pinobj);
+    if (!item)
+        return false;
 
-        // watch for the object getting garbage collected, and clean up
-        jerry_set_object_native_handle(pinobj, (uintptr_t)item,
-                                       zjs_gpio_callback_free);
+    if (item->zjs_cb.js_callback)
+        jerry_release_object(item->zjs_cb.js_callback);
+    item->zjs_cb.js_callback = jerry_acquire_object(func);
 
-        int rval = gpio_add_callback(zjs_gpio_dev, &item->gpio_cb);
-        if (rval) {
-            PRINT("error: cannot setup callback!\n");
+    return true;
+}
+
+bool zjs_gpio_pin_measure_pulse(const jerry_object_t *function_obj_p,
+                                const jerry_value_t this_val,
+                                const jerry_value_t args_p[],
+                                const jerry_length_t args_cnt,
+                                jerry_value_t *ret_val_p)
+{
+    // requires: this_val is a GPIOPin object opened with edge "any", arg 0 is
+    //             an object with these members: level (boolean, defaults to
+    //             true), timeoutMs (defaults to 1000); arg 1 is a JS callback
+    //  effects: times the next pulse at the given logical level in the edge
+    //             ISR and calls the callback once with its width in
+    //             microseconds, or null if none completed before the timeout
+    if (args_cnt < 2 || !jerry_value_is_object(args_p[0]) ||
+        !jerry_value_is_function(args_p[1])) {
+        PRINT("zjs_gpio_pin_measure_pulse: invalid arguments\n");
+        return false;
+    }
+
+    jerry_object_t *options = jerry_get_object_value(args_p[0]);
+    bool level = true;
+    zjs_obj_get_boolean(options, "level", &level);
+
+    // keep the deadline within the range of a signed 32-bit cycle delta
+    uint32_t cycles_per_ms = sys_clock_hw_cycles_per_sec / 1000;
+    uint32_t timeout = 1000;
+    zjs_obj_get_uint32(options, "timeoutMs", &timeout);
+    if (timeout > INT32_MAX / cycles_per_ms)
+        timeout = INT32_MAX / cycles_per_ms;
+
+    jerry_object_t *pinobj = jerry_get_object_value(this_val);
+    struct zjs_cb_list_item *item = zjs_gpio_item_get(pinobj);
+    if (!item)
+        return false;
+
+    struct zjs_gpio_pulse *pulse = &item->pulse;
+    if (pulse->state != ZJS_PULSE_IDLE) {
+        PRINT("zjs_gpio_pin_measure_pulse: already measuring\n");
+        return false;
+    }
+
+    pulse->zjs_cb.js_callback =
+        jerry_acquire_object(jerry_get_object_value(args_p[1]));
+    int key = irq_lock();
+    pulse->level = level;
+    pulse->deadline = sys_cycle_get_32() + timeout * cycles_per_ms;
+    pulse->state = ZJS_PULSE_WAIT_START;
+    irq_unlock(key);
+
+    zjs_gpio_timer_kick();
+    return true;
+}
+
+bool zjs_gpio_pin_start_counting(const jerry_object_t *function_obj_p,
+                                 const jerry_value_t this_val,
+                                 const jerry_value_t args_p[],
+                                 const jerry_length_t args_cnt,
+                                 jerry_value_t *ret_val_p)
+{
+    // requires: this_val is a GPIOPin object opened with an edge, arg 0 is an
+    //             object with windowMs (defaults to 1000), arg 1 is a JS
+    //             callback
+    //  effects: counts edges in the ISR and calls the callback once per
+    //             window with the edge rate per second and the edge count
+    if (args_cnt < 2 || !jerry_value_is_object(args_p[0]) ||
+        !jerry_value_is_function(args_p[1])) {
+        PRINT("zjs_gpio_pin_start_counting: invalid arguments\n");
+        return false;
+    }
+
+    jerry_object_t *options = jerry_get_object_value(args_p[0]);
+    uint32_t cycles_per_ms = sys_clock_hw_cycles_per_sec / 1000;
+    uint32_t window = 1000;
+    zjs_obj_get_uint32(options, "windowMs", &window);
+    if (window < 1)
+        window = 1;
+    if (window > INT32_MAX / cycles_per_ms)
+        window = INT32_MAX / cycles_per_ms;
+
+    jerry_object_t *pinobj = jerry_get_object_value(this_val);
+    struct zjs_cb_list_item *item = zjs_gpio_item_get(pinobj);
+    if (!item)
+        return false;
+
+    struct zjs_gpio_counter *counter = &item->counter;
+    if (counter->zjs_cb.js_callback)
+        jerry_release_object(counter->zjs_cb.js_callback);
+    counter->zjs_cb.js_callback =
+        jerry_acquire_object(jerry_get_object_value(args_p[1]));
+
+    int key = irq_lock();
+    counter->window = window * cycles_per_ms;
+    counter->window_start = sys_cycle_get_32();
+    counter->edges = 0;
+    counter->active = true;
+    irq_unlock(key);
+
+    zjs_gpio_timer_kick();
+    return true;
+}
+
+bool zjs_gpio_pin_stop_counting(const jerry_object_t *function_obj_p,
+                                const jerry_value_t this_val,
+                                const jerry_value_t args_p[],
+                                const jerry_length_t args_cnt,
+                                jerry_value_t *ret_val_p)
+{
+    // requires: this_val is a GPIOPin object
+    //  effects: stops edge counting started with startCounting
+    jerry_object_t *pinobj = jerry_get_object_value(this_val);
+    struct zjs_cb_list_item *item = zjs_gpio_find(pinobj);
+    if (!item || !item->counter.active)
+        return true;
+
+    struct zjs_gpio_counter *counter = &item->counter;
+    int key = irq_lock();
+    counter->active = false;
+    irq_unlock(key);
+    if (counter->zjs_cb.js_callback)
+        jerry_release_object(counter->zjs_cb.js_callback);
+    counter->zjs_cb.js_callback = NULL;
+
+    zjs_gpio_item_release(item);
+    return true;
+}
+
+bool zjs_gpio_pin_get_bounce_count(const jerry_object_t *function_obj_p,
+                                   const jerry_value_t this_val,
+                                   const jerry_value_t args_p[],
+                                   const jerry_length_t args_cnt,
+                                   jerry_value_t *ret_val_p)
+{
+    // requires: this_val is a GPIOPin object from zjs_gpio_open, takes no args
+    //  effects: returns the number of edges suppressed by the debounce filter
+    //             since a change callback was registered
+    jerry_object_t *pinobj = jerry_get_object_value(this_val);
+    struct zjs_cb_list_item *item = zjs_gpio_find(pinobj);
+
+    *ret_val_p = jerry_create_number_value(item ? item->bounces : 0);
+    return true;
+}
+
+bool zjs_gpio_read_port(const jerry_object_t *function_obj_p,
+                        const jerry_value_t this_val,
+                        const jerry_value_t args_p[],
+                        const jerry_length_t args_cnt,
+                        jerry_value_t *ret_val_p)
+{
+    // requires: arg 0 is an optional mask of raw port bits (defaults to all)
+    //  effects: reads the whole GPIO port once and returns the masked bits
+    uint32_t mask = 0xffffffff;
+    if (args_cnt >= 1) {
+        if (!jerry_value_is_number(args_p[0])) {
+            PRINT("zjs_gpio_read_port: invalid argument\n");
             return false;
         }
+        mask = (uint32_t)jerry_get_number_value(args_p[0]);
+    }
 
-        rval = gpio_pin_enable_callback(zjs_gpio_dev, pin);
-        if (rval) {
-            PRINT("error: cannot enable callback!\n");
+    uint32_t value;
+    int rval = gpio_port_read(zjs_gpio_dev, &value);
+    if (rval) {
+        PRINT("error: reading from GPIO port! (%d)\n", rval);
+        return false;
+    }
+
+    *ret_val_p = jerry_create_number_value(value & mask);
+    return true;
+}
+
+bool zjs_gpio_write_port(const jerry_object_t *function_obj_p,
+                         const jerry_value_t this_val,
+                         const jerry_value_t args_p[],
+                         const jerry_length_t args_cnt,
+                         jerry_value_t *ret_val_p)
+{
+    // requires: arg 0 is a mask of raw port bits to change, arg 1 holds the
+    //             new values for those bits
+    //  effects: updates all the masked output pins at the same time
+    if (args_cnt < 2 || !jerry_value_is_number(args_p[0]) ||
+        !jerry_value_is_number(args_p[1])) {
+        PRINT("zjs_gpio_write_port: invalid arguments\n");
+        return false;
+    }
+
+    uint32_t mask = (uint32_t)jerry_get_number_value(args_p[0]);
+    uint32_t value = (uint32_t)jerry_get_number_value(args_p[1]);
+
+    int rval = zjs_gpio_port_update(mask, value);
+    if (rval) {
+        PRINT("error: writing to GPIO port! (%d)\n", rval);
+        return false;
+    }
+
+    return true;
+}
+
+static void zjs_gpio_group_free(uintptr_t handle)
+{
+    // requires: handle is the native pointer we registered with
+    //             jerry_set_object_native_handle
+    //  effects: frees the native group state
+    task_free((void *)handle);
+}
+
+bool zjs_gpio_open_group(const jerry_object_t *function_obj_p,
+                         const jerry_value_t this_val,
+                         const jerry_value_t args_p[],
+                         const jerry_length_t args_cnt,
+                         jerry_value_t *ret_val_p)
+{
+    // requires: arg 0 is an object with these members: pins (array of pin
+    //             numbers, the first being logical bit 0), direction
+    //             (defaults to "out"), activeLow (defaults to false)
+    //  effects: configures the pins and returns a GPIOGroup object whose
+    //             read and write methods treat them as one binary number
+    if (args_cnt < 1 || !jerry_value_is_object(args_p[0])) {
+        PRINT("zjs_gpio_open_group: invalid argument\n");
+        return false;
+    }
+
+    jerry_object_t *data = jerry_get_object_value(args_p[0]);
+
+    jerry_value_t v_pins = jerry_get_object_field_value(data, "pins");
+    if (jerry_value_is_error(v_pins) || !jerry_value_is_object(v_pins) ||
+        !jerry_is_array(jerry_get_object_value(v_pins))) {
+        PRINT("zjs_gpio_open_group: missing pins array\n");
+        return false;
+    }
+    jerry_object_t *pins = jerry_get_object_value(v_pins);
+
+    uint32_t count = jerry_get_array_length(pins);
+    if (count < 1 || count > 32) {
+        PRINT("zjs_gpio_open_group: need 1 to 32 pins\n");
+        jerry_release_value(v_pins);
+        return false;
+    }
+
+    bool dirOut = true;
+    const int BUFLEN = 10;
+    char buffer[BUFLEN];
+    if (zjs_obj_get_string(data, "direction", buffer, BUFLEN)) {
+        if (!strcmp(buffer, ZJS_DIR_IN))
+            dirOut = false;
+    }
+
+    bool activeLow = false;
+    zjs_obj_get_boolean(data, "activeLow", &activeLow);
+
+    struct zjs_gpio_group *group = task_malloc(sizeof(struct zjs_gpio_group));
+    if (!group) {
+        PRINT("error: out of memory allocating gpio group\n");
+        jerry_release_value(v_pins);
+        return false;
+    }
+    memset(group, 0, sizeof(struct zjs_gpio_group));
+
+    int flags = (dirOut ? GPIO_DIR_OUT : GPIO_DIR_IN) | GPIO_PUD_NORMAL |
+        (activeLow ? GPIO_POL_INV : GPIO_POL_NORMAL);
+
+    for (uint32_t i = 0; i < count; i++) {
+        jerry_value_t v_pin;
+        int newpin = -1;
+        if (jerry_get_array_index_value(pins, i, &v_pin)) {
+            if (jerry_value_is_number(v_pin))
+                newpin = zjs_gpio_convert_pin(jerry_get_number_value(v_pin));
+            jerry_release_value(v_pin);
+        }
+
+        if (newpin == -1 || (group->mask & BIT(newpin))) {
+            PRINT("zjs_gpio_open_group: invalid pin at index %lu\n", i);
+            task_free(group);
+            jerry_release_value(v_pins);
             return false;
         }
+
+        int rval = gpio_pin_configure(zjs_gpio_dev, newpin, flags);
+        if (rval) {
+            PRINT("error: opening GPIO pin #%d! (%d)\n", newpin, rval);
+        }
+
+        group->bits[i] = newpin;
+        group->mask |= BIT(newpin);
     }
+    group->count = count;
+    if (activeLow)
+        group->invert = group->mask;
 
-    if (!item)
+    // create the GPIOGroup object
+    jerry_object_t *groupobj = jerry_create_object();
+    zjs_obj_add_function(groupobj, zjs_gpio_group_read, "read");
+    zjs_obj_add_function(groupobj, zjs_gpio_group_write, "write");
+    zjs_obj_add_object(groupobj, pins, "pins");
+    zjs_obj_add_string(groupobj, dirOut ? ZJS_DIR_OUT : ZJS_DIR_IN,
+                       "direction");
+    zjs_obj_add_boolean(groupobj, activeLow, "activeLow");
+    zjs_obj_add_number(groupobj, group->mask, "mask");
+    jerry_release_value(v_pins);
+
+    jerry_set_object_native_handle(groupobj, (uintptr_t)group,
+                                   zjs_gpio_group_free);
+
+    *ret_val_p = jerry_create_object_value(groupobj);
+    return true;
+}
+
+bool zjs_gpio_group_read(const jerry_object_t *function_obj_p,
+                         const jerry_value_t this_val,
+                         const jerry_value_t args_p[],
+                         const jerry_length_t args_cnt,
+                         jerry_value_t *ret_val_p)
+{
+    // requires: this_val is a GPIOGroup object from zjs_gpio_open_group
+    //  effects: reads all the group's pins at once and returns them as a
+    //             number, with the group's first pin in bit 0
+    uintptr_t ptr;
+    if (!jerry_get_object_native_handle(jerry_get_object_value(this_val),
+                                        &ptr)) {
+        PRINT("zjs_gpio_group_read: not a GPIO group\n");
+        return false;
+    }
+    struct zjs_gpio_group *group = (struct zjs_gpio_group *)ptr;
+
+    uint32_t port;
+    int rval = gpio_port_read(zjs_gpio_dev, &port);
+    if (rval) {
+        PRINT("error: reading from GPIO port! (%d)\n", rval);
+        return false;
+    }
+    port ^= group->invert;
+
+    uint32_t value = 0;
+    for (uint32_t i = 0; i < group->count; i++) {
+        if (port & BIT(group->bits[i]))
+            value |= BIT(i);
+    }
+
+    *ret_val_p = jerry_create_number_value(value);
+    return true;
+}
+
+bool zjs_gpio_group_write(const jerry_object_t *function_obj_p,
+                          const jerry_value_t this_val,
+                          const jerry_value_t args_p[],
+                          const jerry_length_t args_cnt,
+                          jerry_value_t *ret_val_p)
+{
+    // requires: this_val is a GPIOGroup object from zjs_gpio_open_group, arg 0
+    //             is a number whose bit 0 is the logical value for the group's
+    //             first pin, and so on
+    //  effects: writes all the group's pins with a single port write
+    if (args_cnt < 1 || !jerry_value_is_number(args_p[0])) {
+        PRINT("zjs_gpio_group_write: invalid argument\n");
         return false;
+    }
+
+    uintptr_t ptr;
+    if (!jerry_get_object_native_handle(jerry_get_object_value(this_val),
+                                        &ptr)) {
+        PRINT("zjs_gpio_group_write: not a GPIO group\n");
+        return false;
+    }
+    struct zjs_gpio_group *group = (struct zjs_gpio_group *)ptr;
+
+    uint32_t value = (uint32_t)jerry_get_number_value(args_p[0]);
+    uint32_t port = 0;
+    for (uint32_t i = 0; i < group->count; i++) {
+        if (value & BIT(i))
+            port |= BIT(group->bits[i]);
+    }
+
+    int rval = zjs_gpio_port_update(group->mask, port ^ group->invert);
+    if (rval) {
+        PRINT("error: writing to GPIO port! (%d)\n", rval);
+        return false;
+    }
+
+    return true;
+}
+
+// Waveforms are Buffers of 8-byte steps, played back from the always-on
+//   periodic timer's interrupt so that step timing doesn't depend on the JS
+//   main loop, and nothing has to spin between steps:
+//   bytes 0-3: mask of raw port bits to drive (little endian)
+//   byte 4:    level for those bits, 0 for low and anything else for high
+//   bytes 5-7: microseconds to wait before the next step (little endian)
+// The timer counts at 32768Hz, so the alarm is set for the whole counts
+//   before the next step and the ISR spins out the fraction of a count left,
+//   under 31us, on the cycle counter. Steps due less than a count apart are
+//   played from the same interrupt, but it never spins for more than a
+//   count in all before setting the alarm again, so even a waveform of very
+//   short steps leaves the CPU at least half free.
+#define ZJS_GPIO_WAVE_STEP_SIZE 8
+#define ZJS_GPIO_WAVE_TIMER_HZ 32768
+
+struct zjs_gpio_wave {
+    jerry_object_t *wave_obj;
+    jerry_object_t *buf_obj;
+    struct zjs_buffer_t *buf;
+    uint32_t repeat;                // times to play, 0 means until stopped
+    bool done;                      // finished or stopped
+    uint32_t pass;                  // passes played so far
+    uint32_t index;                 // next step to play
+    uint32_t deadline;              // hw cycle count the next step is due at
+    uint32_t underruns;             // steps that started late
+    atomic_t underrun_queued;
+    struct zjs_callback complete_cb;
+    struct zjs_callback underrun_cb;
+};
+
+// only one waveform plays at a time, from zjs_gpio_wave_timer's alarm
+static struct zjs_gpio_wave *zjs_gpio_wave_active = NULL;
+
+static void zjs_gpio_wave_finish(struct zjs_gpio_wave *wave)
+{
+    // requires: called from ISR context or with interrupts locked
+    //  effects: stops the timer and queues the complete callback
+    counter_stop(zjs_gpio_wave_timer);
+    wave->done = true;
+    zjs_queue_callback(&wave->complete_cb);
+}
+
+static void zjs_gpio_wave_alarm(struct device *dev, void *user_data)
+{
+    // requires: called from ISR context, or with interrupts locked to play
+    //             the first step
+    //  effects: plays every step due within the next timer count, then sets
+    //             the alarm for the one after, or finishes the waveform
+    struct zjs_gpio_wave *wave = user_data;
+    if (wave->done)
+        return;
+
+    uint32_t cycles_per_us = sys_clock_hw_cycles_per_sec / 1000000;
+    uint32_t count = wave->buf->bufsize / ZJS_GPIO_WAVE_STEP_SIZE;
+    uint32_t entered = sys_cycle_get_32();
+    while (1) {
+        // the alarm fires up to a count early; spin out the rest
+        while ((int32_t)(wave->deadline - sys_cycle_get_32()) > 0);
+
+        // the last pass ends once its last step's time is up
+        if (wave->repeat && wave->pass == wave->repeat) {
+            zjs_gpio_wave_finish(wave);
+            return;
+        }
+
+        uint8_t *step = wave->buf->buffer +
+                        wave->index * ZJS_GPIO_WAVE_STEP_SIZE;
+        uint32_t mask = step[0] | step[1] << 8 | step[2] << 16 |
+                        step[3] << 24;
+        uint32_t delay = step[5] | step[6] << 8 | step[7] << 16;
+        zjs_gpio_port_update(mask, step[4] ? mask : 0);
+        wave->deadline += delay * cycles_per_us;
+
+        if (++wave->index == count) {
+            wave->index = 0;
+            wave->pass++;
+        }
+
+        uint32_t now = sys_cycle_get_32();
+        int32_t left = (int32_t)(wave->deadline - now);
+        if (left < 0) {
+            // fell behind; start timing over from here
+            wave->deadline = now;
+            left = 0;
+            wave->underruns++;
+            if (wave->underrun_cb.js_callback &&
+                !atomic_set(&wave->underrun_queued, 1))
+                zjs_queue_callback(&wave->underrun_cb);
+        }
+
+        uint32_t counts = (uint64_t)left * ZJS_GPIO_WAVE_TIMER_HZ /
+                          sys_clock_hw_cycles_per_sec;
+        if (!counts && now - entered < sys_clock_hw_cycles_per_sec /
+                                       ZJS_GPIO_WAVE_TIMER_HZ)
+            continue;
+
+        counter_set_alarm(zjs_gpio_wave_timer, zjs_gpio_wave_alarm,
+                          counts ? counts : 1, wave);
+        return;
+    }
+}
+
+static void zjs_gpio_wave_call_complete(struct zjs_callback *cb)
+{
+    // requires: called only from task context
+    //  effects: finishes playback and calls the JS complete callback, if set,
+    //             with the number of underruns
+    struct zjs_gpio_wave *wave = CONTAINER_OF(cb, struct zjs_gpio_wave,
+                                              complete_cb);
+    zjs_gpio_wave_active = NULL;
+
+    if (cb->js_callback) {
+        jerry_value_t arg = jerry_create_number_value(wave->underruns);
+        jerry_value_t rval = jerry_call_function(cb->js_callback,
+                                                 wave->wave_obj, &arg, 1);
+        if (jerry_value_is_error(rval)) {
+            PRINT("error: calling waveform complete callback\n");
+        }
+        jerry_release_value(rval);
+    }
+
+    // references taken in play
+    jerry_release_object(wave->buf_obj);
+    jerry_release_object(wave->wave_obj);
+}
+
+static void zjs_gpio_wave_call_underrun(struct zjs_callback *cb)
+{
+    // requires: called only from task context
+    //  effects: calls the JS underrun callback with the underruns so far
+    struct zjs_gpio_wave *wave = CONTAINER_OF(cb, struct zjs_gpio_wave,
+                                              underrun_cb);
+    atomic_clear(&wave->underrun_queued);
+
+    if (!cb->js_callback)
+        return;
+
+    jerry_value_t arg = jerry_create_number_value(wave->underruns);
+    jerry_value_t rval = jerry_call_function(cb->js_callback, wave->wave_obj,
+                                             &arg, 1);
+    if (jerry_value_is_error(rval)) {
+        PRINT("error: calling waveform underrun callback\n");
+    }
+    jerry_release_value(rval);
+}
+
+static void zjs_gpio_wave_free(uintptr_t handle)
+{
+    // requires: handle is the native pointer we registered with
+    //             jerry_set_object_native_handle
+    //  effects: frees the waveform state and its callbacks; can't happen
+    //             while playing since play holds a reference to the object
+    struct zjs_gpio_wave *wave = (struct zjs_gpio_wave *)handle;
+    if (wave->complete_cb.js_callback)
+        jerry_release_object(wave->complete_cb.js_callback);
+    if (wave->underrun_cb.js_callback)
+        jerry_release_object(wave->underrun_cb.js_callback);
+    task_free(wave);
+}
+
+static struct zjs_gpio_wave *zjs_gpio_wave_get(jerry_value_t this_val)
+{
+    // effects: returns the native state of a Waveform object, or NULL
+    uintptr_t ptr;
+    if (!jerry_value_is_object(this_val) ||
+        !jerry_get_object_native_handle(jerry_get_object_value(this_val),
+                                        &ptr))
+        return NULL;
+    return (struct zjs_gpio_wave *)ptr;
+}
+
+bool zjs_gpio_create_waveform(const jerry_object_t *function_obj_p,
+                              const jerry_value_t this_val,
+                              const jerry_value_t args_p[],
+                              const jerry_length_t args_cnt,
+                              jerry_value_t *ret_val_p)
+{
+    // requires: arg 0 is a Buffer of 8-byte steps as described above
+    //  effects: returns a new Waveform object that can play the steps
+    if (args_cnt < 1 || !jerry_value_is_object(args_p[0])) {
+        PRINT("zjs_gpio_create_waveform: invalid argument\n");
+        return false;
+    }
+
+    jerry_object_t *buf_obj = jerry_get_object_value(args_p[0]);
+    struct zjs_buffer_t *buf = zjs_buffer_find(buf_obj);
+    if (!buf || buf->bufsize < ZJS_GPIO_WAVE_STEP_SIZE) {
+        PRINT("zjs_gpio_create_waveform: expected Buffer of steps\n");
+        return false;
+    }
+
+    struct zjs_gpio_wave *wave = task_malloc(sizeof(struct zjs_gpio_wave));
+    if (!wave) {
+        PRINT("error: out of memory allocating waveform\n");
+        return false;
+    }
+    memset(wave, 0, sizeof(struct zjs_gpio_wave));
+
+    jerry_object_t *waveobj = jerry_create_object();
+    zjs_obj_add_function(waveobj, zjs_gpio_waveform_play, "play");
+    zjs_obj_add_function(waveobj, zjs_gpio_waveform_stop, "stop");
+    zjs_obj_add_function(waveobj, zjs_gpio_waveform_on, "on");
+    zjs_obj_add_object(waveobj, buf_obj, "buffer");
+
+    wave->wave_obj = waveobj;
+    wave->buf_obj = buf_obj;
+    wave->buf = buf;
+    wave->complete_cb.call_function = zjs_gpio_wave_call_complete;
+    wave->underrun_cb.call_function = zjs_gpio_wave_call_underrun;
+    jerry_set_object_native_handle(waveobj, (uintptr_t)wave,
+                                   zjs_gpio_wave_free);
+
+    *ret_val_p = jerry_create_object_value(waveobj);
+    return true;
+}
+
+bool zjs_gpio_waveform_play(const jerry_object_t *function_obj_p,
+                            const jerry_value_t this_val,
+                            const jerry_value_t args_p[],
+                            const jerry_length_t args_cnt,
+                            jerry_value_t *ret_val_p)
+{
+    // requires: this_val is a Waveform object, arg 0 is an optional number of
+    //             times to play it (defaults to 1, 0 repeats until stopped)
+    //  effects: starts playing the waveform on the GPIO port; fails if any
+    //             waveform is already playing
+    struct zjs_gpio_wave *wave = zjs_gpio_wave_get(this_val);
+    if (!wave) {
+        PRINT("zjs_gpio_waveform_play: not a waveform\n");
+        return false;
+    }
+
+    if (!zjs_gpio_wave_timer) {
+        PRINT("zjs_gpio_waveform_play: no timer to play waveforms with\n");
+        return false;
+    }
+
+    if (zjs_gpio_wave_active) {
+        PRINT("zjs_gpio_waveform_play: a waveform is already playing\n");
+        return false;
+    }
+
+    wave->repeat = 1;
+    if (args_cnt >= 1 && jerry_value_is_number(args_p[0]))
+        wave->repeat = (uint32_t)jerry_get_number_value(args_p[0]);
+
+    wave->done = false;
+    wave->pass = 0;
+    wave->index = 0;
+    wave->underruns = 0;
+    atomic_clear(&wave->underrun_queued);
+    zjs_gpio_wave_active = wave;
+
+    // keep the waveform and its steps alive until playback completes
+    jerry_acquire_object(wave->wave_obj);
+    jerry_acquire_object(wave->buf_obj);
+
+    // play the first step now, as the alarm would
+    int key = irq_lock();
+    counter_start(zjs_gpio_wave_timer);
+    wave->deadline = sys_cycle_get_32();
+    zjs_gpio_wave_alarm(zjs_gpio_wave_timer, wave);
+    irq_unlock(key);
+    return true;
+}
+
+bool zjs_gpio_waveform_stop(const jerry_object_t *function_obj_p,
+                            const jerry_value_t this_val,
+                            const jerry_value_t args_p[],
+                            const jerry_length_t args_cnt,
+                            jerry_value_t *ret_val_p)
+{
+    // requires: this_val is a Waveform object
+    //  effects: stops playback where it is; the complete callback is still
+    //             called
+    struct zjs_gpio_wave *wave = zjs_gpio_wave_get(this_val);
+    if (!wave) {
+        PRINT("zjs_gpio_waveform_stop: not a waveform\n");
+        return false;
+    }
+
+    int key = irq_lock();
+    if (zjs_gpio_wave_active == wave && !wave->done)
+        zjs_gpio_wave_finish(wave);
+    irq_unlock(key);
+    return true;
+}
+
+bool zjs_gpio_waveform_on(const jerry_object_t *function_obj_p,
+                          const jerry_value_t this_val,
+                          const jerry_value_t args_p[],
+                          const jerry_length_t args_cnt,
+                          jerry_value_t *ret_val_p)
+{
+    // requires: this_val is a Waveform object, arg 0 is "complete" or
+    //             "underrun", arg 1 is a JS callback function or null
+    //  effects: registers the callback for the event; both receive the
+    //             number of steps that started late
+    struct zjs_gpio_wave *wave = zjs_gpio_wave_get(this_val);
+    if (!wave || args_cnt < 2 || !jerry_value_is_string(args_p[0])) {
+        PRINT("zjs_gpio_waveform_on: invalid arguments\n");
+        return false;
+    }
+
+    struct zjs_callback *cb;
+    jerry_string_t *event = jerry_get_string_value(args_p[0]);
+    if (zjs_strequal(event, ZJS_COMPLETE)) {
+        cb = &wave->complete_cb;
+    }
+    else if (zjs_strequal(event, ZJS_UNDERRUN)) {
+        cb = &wave->underrun_cb;
+    }
+    else {
+        PRINT("zjs_gpio_waveform_on: unknown event\n");
+        return false;
+    }
+
+    if (cb->js_callback)
+        jerry_release_object(cb->js_callback);
+    cb->js_callback = NULL;
 
-    item->zjs_cb.js_callback = jerry_get_object_value(args_p[1]);
-    jerry_acquire_object(item->zjs_cb.js_callback);
+    if (jerry_value_is_function(args_p[1]))
+        cb->js_callback =
+            jerry_acquire_object(jerry_get_object_value(args_p[1]));
 
     return true;
 }
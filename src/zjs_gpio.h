@@ -2,10 +2,26 @@
 
 #include "jerry-api.h"
 
+// native code fed a pin's edges from the ISR, with the logical value after
+//   each edge
+typedef void (*zjs_gpio_tap_t)(void *context, uint32_t value);
+
+// a GPIO pin resolved from a GPIOPin object, for native code that writes it
+//   without going through the object's JS methods
+struct zjs_gpio_output {
+    uint32_t pin;       // converted pin number
+    bool activeLow;
+};
+
 extern int (*zjs_gpio_convert_pin)(int num);
 
 jerry_object_t *zjs_gpio_init();
 
+bool zjs_gpio_set_tap(jerry_object_t *pin_obj, zjs_gpio_tap_t tap,
+                      void *context);
+bool zjs_gpio_get_output(jerry_object_t *pin_obj, struct zjs_gpio_output *out);
+int zjs_gpio_output_write(const struct zjs_gpio_output *out, bool logical);
+
 bool zjs_gpio_open(const jerry_object_t *function_obj_p,
                    const jerry_value_t this_val,
                    const jerry_value_t args_p[],
@@ -29,3 +45,81 @@ bool zjs_gpio_pin_on(const jerry_object_t *function_obj_p,
                      const jerry_value_t args_p[],
                      const jerry_length_t args_cnt,
                      jerry_value_t *ret_val_p);
+
+bool zjs_gpio_pin_get_bounce_count(const jerry_object_t *function_obj_p,
+                                   const jerry_value_t this_val,
+                                   const jerry_value_t args_p[],
+                                   const jerry_length_t args_cnt,
+                                   jerry_value_t *ret_val_p);
+
+bool zjs_gpio_read_port(const jerry_object_t *function_obj_p,
+                        const jerry_value_t this_val,
+                        const jerry_value_t args_p[],
+                        const jerry_length_t args_cnt,
+                        jerry_value_t *ret_val_p);
+
+bool zjs_gpio_write_port(const jerry_object_t *function_obj_p,
+                         const jerry_value_t this_val,
+                         const jerry_value_t args_p[],
+                         const jerry_length_t args_cnt,
+                         jerry_value_t *ret_val_p);
+
+bool zjs_gpio_open_group(const jerry_object_t *function_obj_p,
+                         const jerry_value_t this_val,
+                         const jerry_value_t args_p[],
+                         const jerry_length_t args_cnt,
+                         jerry_value_t *ret_val_p);
+
+bool zjs_gpio_group_read(const jerry_object_t *function_obj_p,
+                         const jerry_value_t this_val,
+                         const jerry_value_t args_p[],
+                         const jerry_length_t args_cnt,
+                         jerry_value_t *ret_val_p);
+
+bool zjs_gpio_group_write(const jerry_object_t *function_obj_p,
+                          const jerry_value_t this_val,
+                          const jerry_value_t args_p[],
+                          const jerry_length_t args_cnt,
+                          jerry_value_t *ret_val_p);
+
+bool zjs_gpio_create_waveform(const jerry_object_t *function_obj_p,
+                              const jerry_value_t this_val,
+                              const jerry_value_t args_p[],
+                              const jerry_length_t args_cnt,
+                              jerry_value_t *ret_val_p);
+
+bool zjs_gpio_waveform_play(const jerry_object_t *function_obj_p,
+                            const jerry_value_t this_val,
+                            const jerry_value_t args_p[],
+                            const jerry_length_t args_cnt,
+                            jerry_value_t *ret_val_p);
+
+bool zjs_gpio_waveform_stop(const jerry_object_t *function_obj_p,
+                            const jerry_value_t this_val,
+                            const jerry_value_t args_p[],
+                            const jerry_length_t args_cnt,
+                            jerry_value_t *ret_val_p);
+
+bool zjs_gpio_waveform_on(const jerry_object_t *function_obj_p,
+                          const jerry_value_t this_val,
+                          const jerry_value_t args_p[],
+                          const jerry_length_t args_cnt,
+                          jerry_value_t *ret_val_p);
+
+bool zjs_gpio_pin_measure_pulse(const jerry_object_t *function_obj_p,
+                                const jerry_value_t this_val,
+                                const jerry_value_t args_p[],
+                                const jerry_length_t args_cnt,
+                                jerry_value_t *ret_val_p);
+
+bool zjs_gpio_pin_start_counting(const jerry_object_t *function_obj_p,
+                                 const jerry_value_t this_val,
+                                 const jerry_value_t args_p[],
+                                 const jerry_length_t args_cnt,
+                                 jerry_value_t *ret_val_p);
+
+bool zjs_gpio_pin_stop_counting(const jerry_object_t *function_obj_p,
+                                const jerry_value_t this_val,
+                                const jerry_value_t args_p[],
+                                const jerry_length_t args_cnt,
+                                jerry_value_t *ret_val_p);
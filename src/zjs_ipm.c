@@ -1,5 +1,9 @@
 // Copyright (c) 2016, Intel Corporation.
 
+#include <zephyr.h>
+#include <errno.h>
+#include <string.h>
+
 // ipm for ARC communication
 #include <ipm/ipm_quark_se.h>
 
@@ -20,7 +24,35 @@ QUARK_SE_IPM_DEFINE(ipm_msg_send, IPM_CHANNEL_ARC_TO_X86, QUARK_SE_IPM_OUTBOUND)
 static struct device *ipm_send_dev;
 static struct device *ipm_receive_dev;
 
+// handlers indexed by message id, so each service sees only its own traffic
+static ipm_callback_t ipm_handlers[ZJS_IPM_MAX_SERVICES] = {};
+static bool ipm_receive_enabled = false;
+
+#ifdef CONFIG_X86
+static struct zjs_ipm_ring ipm_ring_storage = {
+    .credits = ZJS_IPM_EVENT_CREDITS,
+};
+static bool ipm_ring_attached = false;
+
+// credits of events x86 hasn't released yet, whether the message being
+//   handled now is an event, and whether its handler has kept its credit
+static uint32_t ipm_held = 0;
+static bool ipm_current_event = false;
+static bool ipm_hold_current = false;
+#endif
+
+// the ring messages from ARC travel through, NULL on ARC until x86 sends it
+static struct zjs_ipm_ring *ipm_ring = NULL;
+
+// this core's counters; on ARC, they move into the ring once x86 sends it
+static struct zjs_ipm_counters ipm_local_counters = {};
+static struct zjs_ipm_counters *ipm_counters = &ipm_local_counters;
+
 void zjs_ipm_init() {
+    // every service calls this, but the devices only need finding once
+    if (ipm_send_dev && ipm_receive_dev)
+        return;
+
     ipm_send_dev = device_get_binding("ipm_msg_send");
 
     if (!ipm_send_dev) {
@@ -34,21 +66,312 @@ void zjs_ipm_init() {
     }
 }
 
+static void zjs_ipm_dispatch(void *context, uint32_t id, volatile void *data)
+{
+    // effects: passes the message to the handler registered for its id
+    if (id < ZJS_IPM_MAX_SERVICES && ipm_handlers[id]) {
+        ipm_handlers[id](context, id, data);
+    } else {
+        PRINT("No IPM handler for message id %u\n", (unsigned int)id);
+    }
+}
+
+static int zjs_ipm_mailbox_send(uint32_t id, const void *data, int data_size)
+{
+    //  effects: sends through the mailbox; on x86, retries while it still
+    //             holds the last message; ARC mostly sends from its IPM ISR,
+    //             so it tries once without waiting rather than spin there;
+    //             returns 0 or the last error
+#ifdef CONFIG_ARC
+    int rval = ipm_send(ipm_send_dev, 0, id, data, data_size);
+    if (rval == -EBUSY)
+        ipm_counters->retried++;
+#else
+    int rval;
+    for (int i = 0; i < ZJS_IPM_MAX_RETRIES; i++) {
+        // the driver refuses a message until the other core has taken the
+        //   last one, even with wait set, which a sender that preempted
+        //   another one can see
+        rval = ipm_send(ipm_send_dev, 1, id, data, data_size);
+        if (rval != -EBUSY)
+            return rval;
+        ipm_counters->retried++;
+    }
+#endif
+    return rval;
+}
+
+#ifdef CONFIG_ARC
+// set when the mailbox was too busy to ring the doorbell, so that
+//   zjs_ipm_flush rings it later
+static volatile bool ipm_doorbell_owed = false;
+
+static void zjs_ipm_ring_doorbell()
+{
+    // requires: only called from ARC, with the ring attached
+    //  effects: rings x86's doorbell unless one is pending already; if the
+    //             mailbox is busy, leaves it owed
+    int key = irq_lock();
+    bool ring = !ipm_ring->doorbell;
+    if (ring)
+        ipm_ring->doorbell = 1;
+    ipm_doorbell_owed = false;
+    irq_unlock(key);
+
+    if (ring && zjs_ipm_mailbox_send(MSG_ID_IPM_RING, NULL, 0) != 0) {
+        // let the next message or zjs_ipm_flush ring again rather than leave
+        //   the flag set with no doorbell pending
+        key = irq_lock();
+        ipm_ring->doorbell = 0;
+        ipm_doorbell_owed = true;
+        irq_unlock(key);
+    }
+}
+
+static int zjs_ipm_ring_put(uint32_t id, const void *data, int data_size,
+                            bool event)
+{
+    // requires: only called from ARC
+    //  effects: adds the message to the ring and rings the doorbell unless
+    //             x86 already has one pending, or leaves it owed if the
+    //             mailbox is busy; returns -EAGAIN if event is
+    //             set and x86 holds all the credits, or -ENOSPC if the ring
+    //             was full
+
+    // replies go out from the IPM ISR while the main loop sends events, so
+    //   keep ARC to one producer at a time
+    int key = irq_lock();
+    uint32_t head = ipm_ring->head;
+    if (event && ipm_ring->events == ipm_ring->credits) {
+        ipm_counters->retried++;
+        irq_unlock(key);
+        return -EAGAIN;
+    }
+    if (head - ipm_ring->tail >= ZJS_IPM_RING_SIZE) {
+        ipm_counters->dropped++;
+        irq_unlock(key);
+        return -ENOSPC;
+    }
+
+    struct zjs_ipm_ring_entry *entry;
+    entry = &ipm_ring->entries[head & (ZJS_IPM_RING_SIZE - 1)];
+    entry->id = id;
+    entry->size = data_size;
+    entry->flags = event ? ZJS_IPM_ENTRY_EVENT : 0;
+    memcpy(entry->data, data, data_size);
+
+    // entry must be complete before x86 can see it
+    ZJS_BARRIER();
+    ipm_ring->head = head + 1;
+    if (event)
+        ipm_ring->events++;
+
+    // x86 clears doorbell and then reads head, while ARC stores head and
+    //   then reads doorbell; a full fence on both sides means at least one
+    //   of them sees the other's store, so either x86 drains this entry or
+    //   ARC rings for it
+    ZJS_FENCE();
+
+    ipm_counters->sent++;
+    if (head + 1 - ipm_ring->tail > ipm_counters->high_water)
+        ipm_counters->high_water = head + 1 - ipm_ring->tail;
+    irq_unlock(key);
+
+    zjs_ipm_ring_doorbell();
+    return 0;
+}
+
+bool zjs_ipm_flush()
+{
+    if (ipm_doorbell_owed)
+        zjs_ipm_ring_doorbell();
+    return ipm_doorbell_owed;
+}
+#endif
+
+#ifdef CONFIG_X86
+static void zjs_ipm_ring_drain(void *context)
+{
+    // requires: called from the doorbell ISR
+    //  effects: passes every message in the ring to the registered callback,
+    //             and returns the credits of events not held by a handler
+    struct zjs_ipm_ring *ring = ipm_ring;
+
+    // clear first, so anything added after the last check below rings
+    //   again; the fence keeps the CPU from reading head before the clear is
+    //   seen by ARC, which pairs with the fence after ARC stores head
+    ring->doorbell = 0;
+    ZJS_FENCE();
+
+    uint32_t tail = ring->tail;
+    uint32_t released = 0;
+    while (tail != ring->head) {
+        ZJS_BARRIER();
+        struct zjs_ipm_ring_entry *entry;
+        entry = &ring->entries[tail & (ZJS_IPM_RING_SIZE - 1)];
+        ipm_current_event = entry->flags & ZJS_IPM_ENTRY_EVENT;
+        ipm_hold_current = false;
+        zjs_ipm_dispatch(context, entry->id, entry->data);
+
+        if (ipm_current_event) {
+            if (ipm_hold_current) {
+                ipm_held++;
+                if (ipm_held > ipm_counters->high_water)
+                    ipm_counters->high_water = ipm_held;
+            } else {
+                released++;
+            }
+        }
+        ipm_current_event = false;
+        ipm_hold_current = false;
+
+        // entry must be consumed before ARC can reuse it
+        ZJS_BARRIER();
+        ring->tail = ++tail;
+    }
+
+    ring->credits += released;
+}
+
+bool zjs_ipm_hold()
+{
+    if (!ipm_current_event)
+        return false;
+    ipm_hold_current = true;
+    return true;
+}
+
+void zjs_ipm_release(uint32_t count)
+{
+    if (!ipm_ring)
+        return;
+
+    int key = irq_lock();
+    ipm_held -= count;
+    ipm_ring->credits += count;
+    irq_unlock(key);
+}
+#endif
+
+static void zjs_ipm_receive(void *context, uint32_t id, volatile void *data)
+{
+#ifdef CONFIG_X86
+    if (id == MSG_ID_IPM_RING) {
+        zjs_ipm_ring_drain(context);
+        return;
+    }
+#elif CONFIG_ARC
+    if (id == MSG_ID_IPM_RING) {
+        ipm_ring = (struct zjs_ipm_ring *) *(volatile uintptr_t *)data;
+
+        // keep counting from where ARC got to before the ring existed
+        ipm_ring->arc = *ipm_counters;
+        ipm_counters = &ipm_ring->arc;
+        return;
+    }
+#endif
+
+    zjs_ipm_dispatch(context, id, data);
+}
+
 int zjs_ipm_send(uint32_t id, const void* data, int data_size) {
     if (!ipm_send_dev) {
         PRINT("Cannot find outbound ipm device!\n" );
-        return -1;
+        return -ENODEV;
+    }
+
+    if (data_size > ZJS_IPM_MAX_MESSAGE) {
+        PRINT("IPM message too large: %d\n", data_size);
+        return -EMSGSIZE;
+    }
+
+#ifdef CONFIG_X86
+    if (!ipm_ring_attached) {
+        // ARC only ever sends in reply to x86, so handing it the ring before
+        //   the first request is early enough
+        uintptr_t addr = (uintptr_t) &ipm_ring_storage;
+        if (zjs_ipm_mailbox_send(MSG_ID_IPM_RING, &addr, sizeof(addr)) == 0) {
+            ipm_ring = &ipm_ring_storage;
+            ipm_ring_attached = true;
+        }
+    }
+#elif CONFIG_ARC
+    if (ipm_ring)
+        return zjs_ipm_ring_put(id, data, data_size, false);
+#endif
+
+    int rval = zjs_ipm_mailbox_send(id, data, data_size);
+    if (rval == 0) {
+        ipm_counters->sent++;
+    } else {
+        ipm_counters->dropped++;
+    }
+    return rval;
+}
+
+#ifdef CONFIG_ARC
+int zjs_ipm_send_event(uint32_t id, const void *data, int data_size) {
+    if (data_size > ZJS_IPM_MAX_MESSAGE) {
+        PRINT("IPM message too large: %d\n", data_size);
+        return -EMSGSIZE;
+    }
+
+    // without the ring there's no credit to take, and nothing to hold the
+    //   event until x86 asks for the ring
+    if (!ipm_ring) {
+        ipm_counters->retried++;
+        return -EAGAIN;
     }
 
-    return ipm_send(ipm_send_dev, 1, id, data, data_size);
+    return zjs_ipm_ring_put(id, data, data_size, true);
 }
 
-void zjs_ipm_register_callback(uint32_t msg_id, ipm_callback_t cb) {
+uint32_t zjs_ipm_credits() {
+    return ipm_ring ? ipm_ring->credits - ipm_ring->events : 0;
+}
+#endif
+
+int zjs_ipm_register_callback(uint32_t msg_id, ipm_callback_t cb) {
     if (!ipm_receive_dev) {
         PRINT("Cannot find inbound ipm device!\n" );
+        return -ENODEV;
+    }
+
+    if (msg_id >= ZJS_IPM_MAX_SERVICES) {
+        PRINT("IPM message id %u out of range\n", (unsigned int)msg_id);
+        return -EINVAL;
+    }
+
+    // another service's handler would silently lose it every message
+    if (ipm_handlers[msg_id] && ipm_handlers[msg_id] != cb) {
+        PRINT("IPM message id %u already has a handler\n",
+              (unsigned int)msg_id);
+        return -EBUSY;
+    }
+
+    ipm_handlers[msg_id] = cb;
+
+    // the device gets the one dispatcher, however many services register
+    if (!ipm_receive_enabled) {
+        ipm_register_callback(ipm_receive_dev, zjs_ipm_receive, NULL);
+        ipm_set_enabled(ipm_receive_dev, 1);
+        ipm_receive_enabled = true;
+    }
+    return 0;
+}
+
+void zjs_ipm_get_counters(bool remote, struct zjs_ipm_counters *counters) {
+    if (!remote) {
+        *counters = *ipm_counters;
         return;
     }
 
-    ipm_register_callback(ipm_receive_dev, cb, NULL);
-    ipm_set_enabled(ipm_receive_dev, 1);
+#ifdef CONFIG_X86
+    // ARC keeps its counters in the ring, once it has one
+    if (ipm_ring) {
+        *counters = ipm_ring->arc;
+        return;
+    }
+#endif
+    memset(counters, 0, sizeof(*counters));
 }
@@ -4,8 +4,17 @@
 #define IPM_CHANNEL_X86_TO_ARC                             0x01
 #define IPM_CHANNEL_ARC_TO_X86                             0x02
 
+// message ids name the service on the other core that handles a message;
+//   each has its own handler, registered with zjs_ipm_register_callback
 #define MSG_ID_AIO                                         0x01
 
+// message ids below this can have handlers
+#define ZJS_IPM_MAX_SERVICES                               16
+
+// reserved for the shared ring below, never passed to registered callbacks
+#define MSG_ID_IPM_RING                                    0xFF
+
+// each request type is followed by its _SUCCESS and then its _FAIL reply
 #define TYPE_AIO_OPEN                                      0x0000
 #define TYPE_AIO_OPEN_SUCCESS                              0x0001
 #define TYPE_AIO_OPEN_FAIL                                 0x0002
@@ -31,16 +40,257 @@
 #define TYPE_AIO_PIN_UNSUBSCRIBE_FAIL                      0x0011
 
 #define TYPE_AIO_PIN_EVENT_VALUE_CHANGE                    0x0012
+#define TYPE_AIO_PIN_EVENT_SCAN                            0x0013
+
+#define TYPE_AIO_PIN_STREAM_START                          0x0014
+#define TYPE_AIO_PIN_STREAM_START_SUCCESS                  0x0015
+#define TYPE_AIO_PIN_STREAM_START_FAIL                     0x0016
+
+#define TYPE_AIO_PIN_STREAM_STOP                           0x0017
+#define TYPE_AIO_PIN_STREAM_STOP_SUCCESS                   0x0018
+#define TYPE_AIO_PIN_STREAM_STOP_FAIL                      0x0019
+
+#define TYPE_AIO_PIN_EVENT_STREAM_DATA                     0x001A
+#define TYPE_AIO_PIN_EVENT_STREAM_END                      0x001B
+
+#define TYPE_AIO_PIN_GET_SUPPRESSED                        0x001C
+#define TYPE_AIO_PIN_GET_SUPPRESSED_SUCCESS                0x001D
+#define TYPE_AIO_PIN_GET_SUPPRESSED_FAIL                   0x001E
+
+#define TYPE_AIO_PIN_SET_FILTER                            0x001F
+#define TYPE_AIO_PIN_SET_FILTER_SUCCESS                    0x0020
+#define TYPE_AIO_PIN_SET_FILTER_FAIL                       0x0021
+
+#define TYPE_AIO_PIN_EVENT_STATS                           0x0022
+
+#define TYPE_AIO_PIN_SET_PERIOD                            0x0023
+#define TYPE_AIO_PIN_SET_PERIOD_SUCCESS                    0x0024
+#define TYPE_AIO_PIN_SET_PERIOD_FAIL                       0x0025
+
+// replies with the max scan lateness in value and the mean in param, in us
+#define TYPE_AIO_PIN_GET_JITTER                            0x0026
+#define TYPE_AIO_PIN_GET_JITTER_SUCCESS                    0x0027
+#define TYPE_AIO_PIN_GET_JITTER_FAIL                       0x0028
+
+// sets one ZJS_AIO_PID_* parameter, named by value, of a channel's control
+//   loop to param
+#define TYPE_AIO_PIN_PID_CONFIG                            0x0029
+#define TYPE_AIO_PIN_PID_CONFIG_SUCCESS                    0x002A
+#define TYPE_AIO_PIN_PID_CONFIG_FAIL                       0x002B
+
+// starts the loop with the setpoint in value and the period in param, in us
+#define TYPE_AIO_PIN_PID_START                             0x002C
+#define TYPE_AIO_PIN_PID_START_SUCCESS                     0x002D
+#define TYPE_AIO_PIN_PID_START_FAIL                        0x002E
+
+#define TYPE_AIO_PIN_PID_SETPOINT                          0x002F
+#define TYPE_AIO_PIN_PID_SETPOINT_SUCCESS                  0x0030
+#define TYPE_AIO_PIN_PID_SETPOINT_FAIL                     0x0031
 
+#define TYPE_AIO_PIN_PID_STOP                              0x0032
+#define TYPE_AIO_PIN_PID_STOP_SUCCESS                      0x0033
+#define TYPE_AIO_PIN_PID_STOP_FAIL                         0x0034
+
+#define TYPE_AIO_PIN_EVENT_PID                             0x0035
+
+// averaging modes for TYPE_AIO_PIN_SET_FILTER, in the low byte of value;
+//   the next byte is the boxcar length or the EMA shift (alpha = 1/2^shift)
+#define ZJS_AIO_FILTER_NONE                                0
+#define ZJS_AIO_FILTER_BOXCAR                              1
+#define ZJS_AIO_FILTER_EMA                                 2
+
+// longest boxcar average and largest EMA shift ARC supports
+#define ZJS_AIO_FILTER_MAX_WINDOW                          32
+#define ZJS_AIO_FILTER_MAX_SHIFT                           8
+
+// set in param of TYPE_AIO_PIN_SET_FILTER, whose low 16 bits are the
+//   decimation factor, to get a stats message per decimated output
+#define ZJS_AIO_FILTER_STATS                               0x10000
+
+// control loop parameters for TYPE_AIO_PIN_PID_CONFIG; gains are signed
+//   16.16 fixed point and per loop period, output limits are duty cycles
+#define ZJS_AIO_PID_KP                                     0
+#define ZJS_AIO_PID_KI                                     1
+#define ZJS_AIO_PID_KD                                     2
+#define ZJS_AIO_PID_OUTPUT_MIN                             3
+#define ZJS_AIO_PID_OUTPUT_MAX                             4
+#define ZJS_AIO_PID_TELEMETRY                              5   // every N outputs
+
+// full scale of a control loop output, a PWM duty cycle
+#define ZJS_AIO_PID_DUTY_MAX                               0xFFFF
+
+// set in the flags of a control loop output that should also reach JS
+#define ZJS_AIO_PID_FLAG_TELEMETRY                         0x01
+
+// number of analog input channels, A0 through A5
+#define ZJS_AIO_CHANNELS                                   6
+
+// most conversions ARC can accumulate per reading; TYPE_AIO_OPEN's value is
+//   the count to use, a power of 4, and each factor of 4 adds a bit
+#define ZJS_AIO_MAX_OVERSAMPLE                             16
+
+// most samples in one streaming block
+#define ZJS_AIO_STREAM_MAX_BLOCK                           64
+
+// samples carried by one stream data message
+#define ZJS_AIO_STREAM_CHUNK                               6
+
+// every message type starts with the 16-bit type field so the receiver can
+//   tell which layout it has; none may be larger than the 16 bytes the
+//   mailbox hardware carries
 struct zjs_ipm_message {
+    uint16_t type;
     bool block;
-    uint32_t type;
+    uint8_t id;         // request id echoed in the reply, 0 for none
     uint32_t pin;
     uint32_t value;
+    uint32_t param;     // second argument for requests that need one
+};
+
+// sent from ARC once per ADC scan with the latest readings of all subscribed
+//   channels; values[i] is for pin A0 + i, valid only if bit i of mask is set
+struct zjs_ipm_scan_message {
+    uint16_t type;
+    uint8_t mask;
+    uint8_t reserved;
+    uint16_t values[ZJS_AIO_CHANNELS];
+};
+
+// sent from ARC with the next samples of a streaming block, in order
+struct zjs_ipm_stream_message {
+    uint16_t type;
+    uint8_t pin;
+    uint8_t count;      // number of valid samples
+    uint16_t samples[ZJS_AIO_STREAM_CHUNK];
+};
+
+// sent from ARC after the last samples of a streaming block
+struct zjs_ipm_stream_end_message {
+    uint16_t type;
+    uint8_t pin;
+    uint8_t reserved;
+    uint32_t timestamp; // ARC hw cycle count when the block started
+    uint32_t sequence;  // block number since the stream started
+    uint32_t overruns;  // samples lost between blocks since the stream started
+};
+
+// largest message either side may send
+#define ZJS_IPM_MAX_MESSAGE                                16
+
+// entries in the ARC to x86 ring, must be a power of two
+#define ZJS_IPM_RING_SIZE                                  64
+
+// ring entries ARC may fill with events that x86 hasn't released; the rest
+//   are kept for replies, one for each request x86 can have outstanding
+#define ZJS_IPM_EVENT_CREDITS                              48
+
+// times an x86 send retries while the mailbox still holds the last message;
+//   ARC tries once, see zjs_ipm_flush
+#define ZJS_IPM_MAX_RETRIES                                10000
+
+// ring entry flags
+#define ZJS_IPM_ENTRY_EVENT                                0x0001
+
+struct zjs_ipm_ring_entry {
+    uint32_t id;
+    uint16_t size;
+    uint16_t flags;
+    uint8_t data[ZJS_IPM_MAX_MESSAGE];
+};
+
+// traffic counters each core keeps for the messages it sends
+struct zjs_ipm_counters {
+    uint32_t sent;          // messages sent, ring doorbells not included
+    uint32_t dropped;       // messages given up on
+    uint32_t retried;       // sends refused, because the mailbox was busy
+                            //   or ARC was out of credits, and tried again
+    uint32_t high_water;    // ARC: most ring entries in use at once
+                            // x86: most event credits held at once
+};
+
+// Messages from ARC to x86 go through this single-producer/single-consumer
+//   ring in SRAM, which both cores see at the same address, instead of one
+//   mailbox interrupt each. x86 owns the memory and passes its address to ARC
+//   before its first request; after that the mailbox is only a doorbell that
+//   ARC rings when it adds to a ring x86 isn't already draining.
+//
+// Events, the messages ARC sends on its own, also need a credit. x86 returns
+//   an event's credit once it's done with it, which can be long after the
+//   ring entry is free if a service holds it until JS has run, so a busy x86
+//   throttles ARC instead of ARC filling the ring and losing replies.
+struct zjs_ipm_ring {
+    volatile uint32_t head;     // next entry to write, only ARC changes it
+    volatile uint32_t tail;     // next entry to read, only x86 changes it
+    volatile uint32_t doorbell; // set by ARC when it rings, cleared by x86
+                                //   as it drains or by ARC if the ring
+                                //   failed; a word store, never a
+                                //   read-modify-write across cores
+    volatile uint32_t credits;  // events x86 has allowed in total, only x86
+                                //   changes it
+    volatile uint32_t events;   // events ARC has sent in total, only ARC
+                                //   changes it
+    struct zjs_ipm_counters arc; // ARC's counters, only ARC changes them
+    struct zjs_ipm_ring_entry entries[ZJS_IPM_RING_SIZE];
+};
+
+// sent from ARC with each output of a channel's control loop, for x86 to
+//   apply to the loop's PWM channel
+struct zjs_ipm_pid_message {
+    uint16_t type;
+    uint8_t pin;
+    uint8_t flags;      // ZJS_AIO_PID_FLAG_*
+    uint16_t input;     // the reading the output was computed from
+    uint16_t output;    // duty cycle, 0 to ZJS_AIO_PID_DUTY_MAX
+    int32_t error;      // setpoint - input
+    uint32_t sequence;  // outputs since the loop started
+};
+
+// sent from ARC once per decimation window of a channel with stats enabled;
+//   value is the filtered output, the rest are over the window's raw samples
+struct zjs_ipm_stats_message {
+    uint16_t type;
+    uint8_t pin;
+    uint8_t reserved;
+    uint16_t value;
+    uint16_t min;
+    uint16_t max;
+    uint16_t rms;
+    uint32_t count;     // raw samples in the window
 };
 
 void zjs_ipm_init();
 
+// returns 0 on success or a negative errno; replies and requests always get
+//   a ring entry or the mailbox, so only events are subject to credits
 int zjs_ipm_send(uint32_t id, const void *data, int data_size);
 
-void zjs_ipm_register_callback(uint32_t id, ipm_callback_t cb);
+// returns 0, or -EBUSY if another handler already has id, leaving it in place
+int zjs_ipm_register_callback(uint32_t id, ipm_callback_t cb);
+
+// fills in this core's counters, or the other core's if remote is true
+void zjs_ipm_get_counters(bool remote, struct zjs_ipm_counters *counters);
+
+#ifdef CONFIG_ARC
+// like zjs_ipm_send, for a message ARC sends on its own; returns -EAGAIN if
+//   x86 hasn't released enough earlier events, and the caller should try
+//   again later rather than drop it
+int zjs_ipm_send_event(uint32_t id, const void *data, int data_size);
+
+// returns the number of events that could be sent right now
+uint32_t zjs_ipm_credits();
+
+// rings x86's doorbell if a send found the mailbox busy, from the main loop
+//   rather than spinning in the sender, which is often the IPM ISR; returns
+//   true if the mailbox is still busy, and the caller should try again later
+bool zjs_ipm_flush();
+#endif
+
+#ifdef CONFIG_X86
+// called from a handler to keep the credit of the event it was passed until
+//   zjs_ipm_release, instead of returning it when the handler returns;
+//   returns false if the message wasn't an event, so has no credit to keep
+bool zjs_ipm_hold();
+
+// returns count held credits to ARC
+void zjs_ipm_release(uint32_t count);
+#endif
@@ -0,0 +1,672 @@
+// Copyright (c) 2016, Intel Corporation.
+
+// Zephyr includes
+#include <zephyr.h>
+#include <string.h>
+
+// ZJS includes
+#include "zjs_aio.h"
+#include "zjs_ble.h"
+#include "zjs_gpio.h"
+#include "zjs_pipe.h"
+#include "zjs_pwm.h"
+#include "zjs_util.h"
+
+// A pipe connects one source to one sink through a few transforms, all in
+//   native code: sources record their latest value from the ISR they're
+//   seen in, and a fiber runs the transforms and writes the sink. Values are
+//   32-bit integers throughout, so the fiber never touches the FPU. If a
+//   source fires again before the fiber gets to it, only the newest value
+//   is passed on.
+#define ZJS_PIPE_MAX            4
+#define ZJS_PIPE_MAX_STAGES     4
+#define ZJS_PIPE_MAX_TABLE      16
+#define ZJS_PIPE_STACK_SIZE     512
+#define ZJS_PIPE_PRIORITY       1
+
+#define ZJS_PIPE_SOURCE_AIO     0
+#define ZJS_PIPE_SOURCE_GPIO    1
+#define ZJS_PIPE_SOURCE_TIMER   2
+
+#define ZJS_PIPE_SCALE          0
+#define ZJS_PIPE_CLAMP          1
+#define ZJS_PIPE_MAP            2
+#define ZJS_PIPE_THRESHOLD      3
+
+#define ZJS_PIPE_SINK_PWM       0
+#define ZJS_PIPE_SINK_GPIO      1
+#define ZJS_PIPE_SINK_BLE       2
+
+struct zjs_pipe_stage {
+    uint32_t type;
+    union {
+        struct {
+            int32_t factor;         // 16.16 fixed point
+            int32_t offset;
+        } scale;
+        struct {
+            int32_t min;
+            int32_t max;
+        } clamp;
+        struct {
+            int32_t in_min;         // input for the first entry
+            int32_t in_max;         // input for the last entry
+            bool wrap;              // index by input modulo count instead
+            uint32_t count;
+            int32_t table[ZJS_PIPE_MAX_TABLE];
+        } map;
+        struct {
+            int32_t level;          // rising input at or above this is high
+            int32_t hysteresis;     // falling input must drop this far below
+            int32_t low;
+            int32_t high;
+            bool above;
+        } threshold;
+    };
+};
+
+struct zjs_pipe {
+    bool active;
+    volatile bool busy;             // the fiber is running this pipe
+    uint32_t id;                    // tells a stopped pipe's object apart
+    uint32_t source;
+    jerry_object_t *source_obj;     // pin the source taps, if any
+    volatile bool pending;          // input is new since the fiber last ran
+    volatile int32_t input;
+    uint32_t period;                // timer source, in ticks
+    uint32_t due;                   // timer source, tick of the next firing
+    uint32_t fired;
+    uint32_t stage_count;
+    struct zjs_pipe_stage stages[ZJS_PIPE_MAX_STAGES];
+    uint32_t sink;
+    union {
+        struct zjs_pwm_output pwm;
+        struct zjs_gpio_output gpio;
+        struct zjs_ble_characteristic *ble;
+    } out;
+    int32_t sink_min;               // PWM input for 0 and full duty
+    int32_t sink_max;
+    uint32_t sink_size;             // BLE value bytes, little endian
+    bool written;
+    int32_t last;                   // last value written to the sink
+    volatile uint32_t inputs;       // source values seen
+    uint32_t outputs;               // sink writes
+};
+
+static struct zjs_pipe zjs_pipes[ZJS_PIPE_MAX] = {};
+static uint32_t zjs_pipe_next_id = 1;
+static struct nano_sem zjs_pipe_sem;
+static char __stack zjs_pipe_stack[ZJS_PIPE_STACK_SIZE];
+static bool zjs_pipe_fiber_started = false;
+
+static int32_t zjs_pipe_saturate(int64_t value)
+{
+    if (value > INT32_MAX)
+        return INT32_MAX;
+    if (value < INT32_MIN)
+        return INT32_MIN;
+    return value;
+}
+
+static int32_t zjs_pipe_transform(struct zjs_pipe_stage *stage, int32_t value)
+{
+    // requires: called only from the pipe fiber
+    //  effects: returns value passed through stage
+    switch (stage->type) {
+    case ZJS_PIPE_SCALE:
+        return zjs_pipe_saturate((((int64_t)value * stage->scale.factor) >> 16)
+                                 + stage->scale.offset);
+
+    case ZJS_PIPE_CLAMP:
+        if (value < stage->clamp.min)
+            return stage->clamp.min;
+        if (value > stage->clamp.max)
+            return stage->clamp.max;
+        return value;
+
+    case ZJS_PIPE_MAP: {
+        uint32_t count = stage->map.count;
+        if (stage->map.wrap) {
+            int32_t index = value % (int32_t)count;
+            if (index < 0)
+                index += count;
+            return stage->map.table[index];
+        }
+
+        if (count == 1)
+            return stage->map.table[0];
+
+        // interpolate between the two nearest entries, in 16.16
+        int64_t span = (int64_t)stage->map.in_max - stage->map.in_min;
+        int64_t pos = (((int64_t)value - stage->map.in_min) << 16) *
+                      (count - 1) / span;
+        if (pos <= 0)
+            return stage->map.table[0];
+        if (pos >= (int64_t)(count - 1) << 16)
+            return stage->map.table[count - 1];
+
+        uint32_t i = pos >> 16;
+        int64_t a = stage->map.table[i];
+        int64_t b = stage->map.table[i + 1];
+        return a + (((b - a) * (pos & 0xffff)) >> 16);
+    }
+
+    case ZJS_PIPE_THRESHOLD:
+        if (stage->threshold.above) {
+            if ((int64_t)value <
+                (int64_t)stage->threshold.level - stage->threshold.hysteresis)
+                stage->threshold.above = false;
+        } else if (value >= stage->threshold.level) {
+            stage->threshold.above = true;
+        }
+        return stage->threshold.above ? stage->threshold.high :
+                                        stage->threshold.low;
+    }
+    return value;
+}
+
+static void zjs_pipe_write(struct zjs_pipe *pipe, int32_t value)
+{
+    // requires: called only from the pipe fiber
+    //  effects: writes value to the pipe's sink
+    switch (pipe->sink) {
+    case ZJS_PIPE_SINK_PWM: {
+        int64_t span = (int64_t)pipe->sink_max - pipe->sink_min;
+        int64_t duty = ((int64_t)value - pipe->sink_min) *
+                       ZJS_PWM_DUTY_MAX / span;
+        if (duty < 0)
+            duty = 0;
+        if (duty > ZJS_PWM_DUTY_MAX)
+            duty = ZJS_PWM_DUTY_MAX;
+        zjs_pwm_output_set(&pipe->out.pwm, duty);
+        break;
+    }
+
+    case ZJS_PIPE_SINK_GPIO:
+        zjs_gpio_output_write(&pipe->out.gpio, value != 0);
+        break;
+
+    case ZJS_PIPE_SINK_BLE: {
+        uint8_t bytes[4];
+        for (int i = 0; i < 4; i++)
+            bytes[i] = (uint32_t)value >> (8 * i);
+        zjs_ble_notify(pipe->out.ble, bytes, pipe->sink_size);
+        break;
+    }
+    }
+}
+
+static int32_t zjs_pipe_fire_timers()
+{
+    // requires: called only from the pipe fiber
+    //  effects: gives each due timer source its firing count as its new
+    //             value; returns the ticks until the next one is due
+    uint32_t now = sys_tick_get_32();
+    int32_t wait = TICKS_UNLIMITED;
+    for (int i = 0; i < ZJS_PIPE_MAX; i++) {
+        struct zjs_pipe *pipe = &zjs_pipes[i];
+        if (!pipe->active || pipe->source != ZJS_PIPE_SOURCE_TIMER)
+            continue;
+
+        if ((int32_t)(now - pipe->due) >= 0) {
+            pipe->input = pipe->fired++;
+            pipe->inputs++;
+            pipe->pending = true;
+
+            // keep to the original grid unless a whole period was missed
+            pipe->due += pipe->period;
+            if ((int32_t)(now - pipe->due) >= 0)
+                pipe->due = now + pipe->period;
+        }
+
+        int32_t left = pipe->due - now;
+        if (wait == TICKS_UNLIMITED || left < wait)
+            wait = left;
+    }
+    return wait;
+}
+
+static void zjs_pipe_fiber(int arg1, int arg2)
+{
+    // effects: runs each pipe with a new source value through its transforms
+    //            to its sink, skipping the sink write if nothing changed
+    while (1) {
+        int32_t wait = zjs_pipe_fire_timers();
+        for (int i = 0; i < ZJS_PIPE_MAX; i++) {
+            struct zjs_pipe *pipe = &zjs_pipes[i];
+            int key = irq_lock();
+            bool pending = pipe->pending && pipe->active;
+            int32_t value = pipe->input;
+            pipe->pending = false;
+            pipe->busy = pending;
+            irq_unlock(key);
+            if (!pending)
+                continue;
+
+            for (uint32_t j = 0; j < pipe->stage_count; j++)
+                value = zjs_pipe_transform(&pipe->stages[j], value);
+
+            if (!pipe->written || value != pipe->last) {
+                zjs_pipe_write(pipe, value);
+                pipe->written = true;
+                pipe->last = value;
+                pipe->outputs++;
+            }
+            pipe->busy = false;
+        }
+        nano_fiber_sem_take(&zjs_pipe_sem, wait);
+    }
+}
+
+static void zjs_pipe_tap(void *context, uint32_t value)
+{
+    // requires: called from the source's ISR
+    //  effects: hands the new value to the fiber
+    struct zjs_pipe *pipe = (struct zjs_pipe *)context;
+    pipe->input = value;
+    pipe->inputs++;
+    pipe->pending = true;
+    nano_isr_sem_give(&zjs_pipe_sem);
+}
+
+static jerry_object_t *zjs_pipe_get_object(jerry_object_t *obj,
+                                           const char *name)
+{
+    // effects: returns the object held in obj's field name, or NULL if the
+    //            field is missing or not an object
+    jerry_value_t value = jerry_get_object_field_value(obj,
+                                                       (jerry_char_t *)name);
+    if (jerry_value_is_error(value))
+        return NULL;
+
+    jerry_object_t *rval = NULL;
+    if (jerry_value_is_object(value))
+        rval = jerry_get_object_value(value);
+    jerry_release_value(value);
+    return rval;
+}
+
+static bool zjs_pipe_get_int32(jerry_object_t *obj, const char *name,
+                               int32_t *num)
+{
+    // effects: retrieves field name as a signed integer; returns false and
+    //            leaves *num alone if it is missing or out of range
+    double value;
+    if (!zjs_obj_get_double(obj, name, &value) ||
+        value < INT32_MIN || value > INT32_MAX)
+        return false;
+
+    *num = (int32_t)value;
+    return true;
+}
+
+static bool zjs_pipe_parse_source(struct zjs_pipe *pipe, jerry_object_t *obj)
+{
+    // requires: obj is { aio: AIOPin, deadband } with deadband in raw ADC
+    //             counts, { gpio: GPIOPin } or { timer: ms }
+    //  effects: sets up the pipe's source, without starting it
+    double ms;
+    if ((pipe->source_obj = zjs_pipe_get_object(obj, "aio"))) {
+        pipe->source = ZJS_PIPE_SOURCE_AIO;
+    } else if ((pipe->source_obj = zjs_pipe_get_object(obj, "gpio"))) {
+        pipe->source = ZJS_PIPE_SOURCE_GPIO;
+    } else if (zjs_obj_get_double(obj, "timer", &ms) && ms > 0) {
+        pipe->source = ZJS_PIPE_SOURCE_TIMER;
+        pipe->period = ms * CONFIG_SYS_CLOCK_TICKS_PER_SEC / 1000;
+        if (!pipe->period)
+            pipe->period = 1;
+    } else {
+        PRINT("zjs_pipe_create: source needs aio, gpio or timer\n");
+        return false;
+    }
+    return true;
+}
+
+static bool zjs_pipe_parse_stage(struct zjs_pipe_stage *stage,
+                                 jerry_object_t *obj)
+{
+    // requires: obj is one of { type: "scale", factor, offset },
+    //             { type: "clamp", min, max }, { type: "map", table, inMin,
+    //             inMax, wrap } or { type: "threshold", level, hysteresis,
+    //             low, high }
+    //  effects: fills in stage from obj; returns false if it's invalid
+    const int BUFLEN = 10;
+    char type[BUFLEN];
+    if (!zjs_obj_get_string(obj, "type", type, BUFLEN)) {
+        PRINT("zjs_pipe_create: transform needs a type\n");
+        return false;
+    }
+
+    memset(stage, 0, sizeof(struct zjs_pipe_stage));
+    if (!strcmp(type, "scale")) {
+        double factor = 1;
+        zjs_obj_get_double(obj, "factor", &factor);
+        if (factor * 65536 >= 2147483648.0 || factor * 65536 < -2147483648.0) {
+            PRINT("zjs_pipe_create: scale factor out of range\n");
+            return false;
+        }
+        stage->type = ZJS_PIPE_SCALE;
+        stage->scale.factor = factor * 65536;
+        zjs_pipe_get_int32(obj, "offset", &stage->scale.offset);
+    } else if (!strcmp(type, "clamp")) {
+        stage->type = ZJS_PIPE_CLAMP;
+        stage->clamp.min = INT32_MIN;
+        stage->clamp.max = INT32_MAX;
+        zjs_pipe_get_int32(obj, "min", &stage->clamp.min);
+        zjs_pipe_get_int32(obj, "max", &stage->clamp.max);
+    } else if (!strcmp(type, "map")) {
+        jerry_object_t *table = zjs_pipe_get_object(obj, "table");
+        uint32_t count = table && jerry_is_array(table) ?
+                         jerry_get_array_length(table) : 0;
+        if (count < 1 || count > ZJS_PIPE_MAX_TABLE) {
+            PRINT("zjs_pipe_create: map needs 1 to %d table entries\n",
+                  ZJS_PIPE_MAX_TABLE);
+            return false;
+        }
+
+        stage->type = ZJS_PIPE_MAP;
+        stage->map.count = count;
+        for (uint32_t i = 0; i < count; i++) {
+            jerry_value_t entry;
+            if (!jerry_get_array_index_value(table, i, &entry) ||
+                !jerry_value_is_number(entry)) {
+                PRINT("zjs_pipe_create: map table entries must be numbers\n");
+                return false;
+            }
+            stage->map.table[i] = jerry_get_number_value(entry);
+            jerry_release_value(entry);
+        }
+
+        zjs_obj_get_boolean(obj, "wrap", &stage->map.wrap);
+        stage->map.in_max = count - 1;
+        zjs_pipe_get_int32(obj, "inMin", &stage->map.in_min);
+        zjs_pipe_get_int32(obj, "inMax", &stage->map.in_max);
+        if (!stage->map.wrap && count > 1 &&
+            stage->map.in_max <= stage->map.in_min) {
+            PRINT("zjs_pipe_create: map needs inMax above inMin\n");
+            return false;
+        }
+    } else if (!strcmp(type, "threshold")) {
+        stage->type = ZJS_PIPE_THRESHOLD;
+        stage->threshold.high = 1;
+        if (!zjs_pipe_get_int32(obj, "level", &stage->threshold.level)) {
+            PRINT("zjs_pipe_create: threshold needs a level\n");
+            return false;
+        }
+        zjs_pipe_get_int32(obj, "hysteresis", &stage->threshold.hysteresis);
+        zjs_pipe_get_int32(obj, "low", &stage->threshold.low);
+        zjs_pipe_get_int32(obj, "high", &stage->threshold.high);
+    } else {
+        PRINT("zjs_pipe_create: unknown transform '%s'\n", type);
+        return false;
+    }
+    return true;
+}
+
+static bool zjs_pipe_parse_sink(struct zjs_pipe *pipe, jerry_object_t *obj)
+{
+    // requires: obj is { pwm: PWMPin, min, max }, where min and max are the
+    //             values for 0 and full duty (default 0 and 4095, the range
+    //             of an ADC reading), { gpio: GPIOPin } for an output pin,
+    //             or { ble: Characteristic, size } with size 1, 2 or 4 bytes
+    //             (default 1), for a characteristic already given to
+    //             setServices
+    //  effects: resolves the pipe's sink
+    jerry_object_t *target;
+    if ((target = zjs_pipe_get_object(obj, "pwm"))) {
+        if (!zjs_pwm_get_output(target, &pipe->out.pwm)) {
+            PRINT("zjs_pipe_create: sink pwm isn't a PWM pin\n");
+            return false;
+        }
+        pipe->sink = ZJS_PIPE_SINK_PWM;
+        pipe->sink_min = 0;
+        pipe->sink_max = 4095;
+        zjs_pipe_get_int32(obj, "min", &pipe->sink_min);
+        zjs_pipe_get_int32(obj, "max", &pipe->sink_max);
+        if (pipe->sink_max <= pipe->sink_min) {
+            PRINT("zjs_pipe_create: sink needs max above min\n");
+            return false;
+        }
+    } else if ((target = zjs_pipe_get_object(obj, "gpio"))) {
+        if (!zjs_gpio_get_output(target, &pipe->out.gpio)) {
+            PRINT("zjs_pipe_create: sink gpio isn't a GPIO output\n");
+            return false;
+        }
+        pipe->sink = ZJS_PIPE_SINK_GPIO;
+    } else if ((target = zjs_pipe_get_object(obj, "ble"))) {
+        pipe->out.ble = zjs_ble_get_characteristic(target);
+        if (!pipe->out.ble) {
+            PRINT("zjs_pipe_create: sink ble isn't a registered "
+                  "characteristic\n");
+            return false;
+        }
+        pipe->sink = ZJS_PIPE_SINK_BLE;
+        pipe->sink_size = 1;
+        zjs_obj_get_uint32(obj, "size", &pipe->sink_size);
+        if (pipe->sink_size != 1 && pipe->sink_size != 2 &&
+            pipe->sink_size != 4) {
+            PRINT("zjs_pipe_create: sink size must be 1, 2 or 4\n");
+            return false;
+        }
+    } else {
+        PRINT("zjs_pipe_create: sink needs pwm, gpio or ble\n");
+        return false;
+    }
+    return true;
+}
+
+static bool zjs_pipe_start_source(struct zjs_pipe *pipe, uint32_t deadband)
+{
+    // requires: called only from task context, pipe is active
+    //  effects: starts feeding the pipe from its source
+    switch (pipe->source) {
+    case ZJS_PIPE_SOURCE_AIO:
+        return zjs_aio_set_tap(pipe->source_obj, zjs_pipe_tap, pipe,
+                               deadband);
+    case ZJS_PIPE_SOURCE_GPIO:
+        return zjs_gpio_set_tap(pipe->source_obj, zjs_pipe_tap, pipe);
+    case ZJS_PIPE_SOURCE_TIMER:
+        pipe->fired = 0;
+        pipe->due = sys_tick_get_32();
+        // wake the fiber so it sees the new timer
+        nano_task_sem_give(&zjs_pipe_sem);
+        return true;
+    }
+    return false;
+}
+
+static void zjs_pipe_stop_source(struct zjs_pipe *pipe)
+{
+    // requires: called only from task context
+    //  effects: stops feeding the pipe from its source
+    if (pipe->source == ZJS_PIPE_SOURCE_AIO)
+        zjs_aio_set_tap(pipe->source_obj, NULL, NULL, 0);
+    else if (pipe->source == ZJS_PIPE_SOURCE_GPIO)
+        zjs_gpio_set_tap(pipe->source_obj, NULL, NULL);
+}
+
+static struct zjs_pipe *zjs_pipe_from_this(const jerry_value_t this_val)
+{
+    // effects: returns the running pipe this_val, a Pipe object, stands for,
+    //            or NULL if it has stopped
+    uint32_t slot, id;
+    jerry_object_t *obj = jerry_get_object_value(this_val);
+    if (!zjs_obj_get_uint32(obj, "slot", &slot) ||
+        !zjs_obj_get_uint32(obj, "id", &id) || slot >= ZJS_PIPE_MAX) {
+        PRINT("error: not a pipe\n");
+        return NULL;
+    }
+
+    struct zjs_pipe *pipe = &zjs_pipes[slot];
+    if (!pipe->active || pipe->id != id) {
+        PRINT("error: pipe has stopped\n");
+        return NULL;
+    }
+    return pipe;
+}
+
+jerry_object_t *zjs_pipe_init()
+{
+    // effects: returns the pipe JS object
+    static bool initialized = false;
+    if (!initialized) {
+        nano_sem_init(&zjs_pipe_sem);
+        initialized = true;
+    }
+
+    jerry_object_t *pipe_obj = jerry_create_object();
+    zjs_obj_add_function(pipe_obj, zjs_pipe_create, "create");
+    return pipe_obj;
+}
+
+bool zjs_pipe_create(const jerry_object_t *function_obj_p,
+                     const jerry_value_t this_val,
+                     const jerry_value_t args_p[],
+                     const jerry_length_t args_cnt,
+                     jerry_value_t *ret_val_p)
+{
+    // requires: arg 0 is an object with source and sink objects, and an
+    //             optional transforms array of up to four stages applied in
+    //             order; see the zjs_pipe_parse_* functions
+    //  effects: starts passing each new source value through the
+    //             transforms to the sink, without calling into JS, and
+    //             returns a Pipe object with stop() and getStats()
+    if (args_cnt < 1 || !jerry_value_is_object(args_p[0])) {
+        PRINT("zjs_pipe_create: invalid argument\n");
+        return false;
+    }
+
+    struct zjs_pipe *pipe = NULL;
+    uint32_t slot;
+    for (slot = 0; slot < ZJS_PIPE_MAX; slot++) {
+        if (!zjs_pipes[slot].active && !zjs_pipes[slot].busy) {
+            pipe = &zjs_pipes[slot];
+            break;
+        }
+    }
+    if (!pipe) {
+        PRINT("zjs_pipe_create: all %d pipes in use\n", ZJS_PIPE_MAX);
+        return false;
+    }
+
+    jerry_object_t *spec = jerry_get_object_value(args_p[0]);
+    jerry_object_t *source = zjs_pipe_get_object(spec, "source");
+    jerry_object_t *sink = zjs_pipe_get_object(spec, "sink");
+    jerry_object_t *transforms = zjs_pipe_get_object(spec, "transforms");
+    if (!source || !sink) {
+        PRINT("zjs_pipe_create: missing source or sink\n");
+        return false;
+    }
+
+    memset(pipe, 0, sizeof(struct zjs_pipe));
+    if (!zjs_pipe_parse_source(pipe, source) ||
+        !zjs_pipe_parse_sink(pipe, sink))
+        return false;
+
+    if (transforms) {
+        uint32_t count = jerry_is_array(transforms) ?
+                         jerry_get_array_length(transforms) : 0;
+        if (count > ZJS_PIPE_MAX_STAGES) {
+            PRINT("zjs_pipe_create: at most %d transforms\n",
+                  ZJS_PIPE_MAX_STAGES);
+            return false;
+        }
+        for (uint32_t i = 0; i < count; i++) {
+            jerry_value_t entry;
+            if (!jerry_get_array_index_value(transforms, i, &entry))
+                return false;
+            bool ok = jerry_value_is_object(entry) &&
+                      zjs_pipe_parse_stage(&pipe->stages[i],
+                                           jerry_get_object_value(entry));
+            jerry_release_value(entry);
+            if (!ok)
+                return false;
+        }
+        pipe->stage_count = count;
+    }
+
+    if (!zjs_pipe_fiber_started) {
+        fiber_start(zjs_pipe_stack, ZJS_PIPE_STACK_SIZE, zjs_pipe_fiber, 0, 0,
+                    ZJS_PIPE_PRIORITY, 0);
+        zjs_pipe_fiber_started = true;
+    }
+
+    uint32_t deadband = 0;
+    zjs_obj_get_uint32(source, "deadband", &deadband);
+    // nothing else may write a PWM sink while the pipe drives it
+    if (pipe->sink == ZJS_PIPE_SINK_PWM &&
+        !zjs_pwm_output_claim(&pipe->out.pwm)) {
+        PRINT("zjs_pipe_create: sink pwm is already driven by a control "
+              "loop or pipe\n");
+        return false;
+    }
+
+    pipe->id = zjs_pipe_next_id++;
+    pipe->active = true;
+    if (!zjs_pipe_start_source(pipe, deadband)) {
+        PRINT("zjs_pipe_create: couldn't start the source\n");
+        pipe->active = false;
+        if (pipe->sink == ZJS_PIPE_SINK_PWM)
+            zjs_pwm_output_release(&pipe->out.pwm);
+        return false;
+    }
+    if (pipe->source_obj)
+        jerry_acquire_object(pipe->source_obj);
+
+    jerry_object_t *pipe_obj = jerry_create_object();
+    zjs_obj_add_function(pipe_obj, zjs_pipe_stop, "stop");
+    zjs_obj_add_function(pipe_obj, zjs_pipe_get_stats, "getStats");
+    zjs_obj_add_number(pipe_obj, slot, "slot");
+    zjs_obj_add_number(pipe_obj, pipe->id, "id");
+
+    *ret_val_p = jerry_create_object_value(pipe_obj);
+    return true;
+}
+
+bool zjs_pipe_stop(const jerry_object_t *function_obj_p,
+                   const jerry_value_t this_val,
+                   const jerry_value_t args_p[],
+                   const jerry_length_t args_cnt,
+                   jerry_value_t *ret_val_p)
+{
+    // requires: this_val is a Pipe object
+    //  effects: disconnects the pipe, leaving the sink at its last value and
+    //             a PWM sink free for JS to write again
+    struct zjs_pipe *pipe = zjs_pipe_from_this(this_val);
+    if (!pipe)
+        return false;
+
+    zjs_pipe_stop_source(pipe);
+    int key = irq_lock();
+    pipe->active = false;
+    pipe->pending = false;
+    irq_unlock(key);
+
+    if (pipe->sink == ZJS_PIPE_SINK_PWM)
+        zjs_pwm_output_release(&pipe->out.pwm);
+    if (pipe->source_obj)
+        jerry_release_object(pipe->source_obj);
+    pipe->source_obj = NULL;
+    return true;
+}
+
+bool zjs_pipe_get_stats(const jerry_object_t *function_obj_p,
+                        const jerry_value_t this_val,
+                        const jerry_value_t args_p[],
+                        const jerry_length_t args_cnt,
+                        jerry_value_t *ret_val_p)
+{
+    // requires: this_val is a Pipe object
+    //  effects: returns { inputs, outputs }: the source values seen, and the
+    //             sink writes made; a sink is only written when its value
+    //             changes, and only the newest of a burst of inputs is used
+    struct zjs_pipe *pipe = zjs_pipe_from_this(this_val);
+    if (!pipe)
+        return false;
+
+    jerry_object_t *stats = jerry_create_object();
+    zjs_obj_add_number(stats, pipe->inputs, "inputs");
+    zjs_obj_add_number(stats, pipe->outputs, "outputs");
+    *ret_val_p = jerry_create_object_value(stats);
+    return true;
+}
@@ -0,0 +1,23 @@
+// Copyright (c) 2016, Intel Corporation.
+
+#include "jerry-api.h"
+
+jerry_object_t *zjs_pipe_init();
+
+bool zjs_pipe_create(const jerry_object_t *function_obj_p,
+                     const jerry_value_t this_val,
+                     const jerry_value_t args_p[],
+                     const jerry_length_t args_cnt,
+                     jerry_value_t *ret_val_p);
+
+bool zjs_pipe_stop(const jerry_object_t *function_obj_p,
+                   const jerry_value_t this_val,
+                   const jerry_value_t args_p[],
+                   const jerry_length_t args_cnt,
+                   jerry_value_t *ret_val_p);
+
+bool zjs_pipe_get_stats(const jerry_object_t *function_obj_p,
+                        const jerry_value_t this_val,
+                        const jerry_value_t args_p[],
+                        const jerry_length_t args_cnt,
+                        jerry_value_t *ret_val_p);
@@ -13,13 +13,95 @@
 static const char *ZJS_POLARITY_NORMAL = "normal";
 static const char *ZJS_POLARITY_REVERSE = "reverse";
 
+// The QMSI PWM driver only writes the timer's registers, so it is safe to
+//   call with interrupts masked; with CONFIG_PWM_QMSI_API_REENTRANCY it
+//   would take a semaphore instead, and could sleep with them masked
+#ifdef CONFIG_PWM_QMSI_API_REENTRANCY
+#error "zjs_pwm calls the PWM driver with interrupts masked"
+#endif
+
 static struct device *zjs_pwm_dev;
 
+// A fade moves a channel through a sequence of keyframes, each a target
+//   level reached over a number of ticks along a curve. A fiber steps every
+//   fading channel once a tick, with integer math only, and queues the
+//   pin's 'fadeEnd' listener when the last pass is done.
+#define ZJS_PWM_FADE_KEYFRAMES  8
+#define ZJS_PWM_FADE_STACK_SIZE 512
+#define ZJS_PWM_FADE_PRIORITY   1
+
+// gamma 2.2 brightness curve, sampled at 33 evenly spaced levels; the low
+//   ZJS_PWM_CURVE_SHIFT bits of a level interpolate between entries
+#define ZJS_PWM_CURVE_SHIFT     11
+#define ZJS_PWM_CURVE_ENTRIES   33
+
+static const uint16_t zjs_pwm_gamma[ZJS_PWM_CURVE_ENTRIES] = {
+    0, 32, 147, 359, 676, 1104, 1648, 2314, 3104, 4022, 5072, 6255, 7574,
+    9033, 10632, 12375, 14263, 16298, 18482, 20816, 23303, 25943, 28739,
+    31692, 34802, 38072, 41503, 45097, 48853, 52774, 56860, 61114, 65535
+};
+
+struct zjs_pwm_keyframe {
+    uint32_t level;             // target, 0 to ZJS_PWM_DUTY_MAX
+    uint32_t ticks;             // time to reach it
+    const uint16_t *curve;      // maps level to duty; NULL for linear
+};
+
+struct zjs_pwm_fade {
+    volatile bool active;
+    uint32_t seq;               // bumped each time the task restarts or stops
+    uint32_t count;
+    struct zjs_pwm_keyframe frames[ZJS_PWM_FADE_KEYFRAMES];
+    uint32_t repeat;            // passes through frames, 0 for forever
+    uint32_t pass;
+    uint32_t index;             // current keyframe
+    uint32_t start;             // tick the current keyframe started
+    uint32_t from;              // level the current keyframe started at
+    bool queued;                // done_cb is in the callback queue
+    jerry_object_t *pin_obj;    // held while fading or queued
+    struct zjs_callback done_cb;
+};
+
+// servos take a pulse every 20ms, and by default 1ms to 2ms long for their
+//   0 to 180 degree range
+#define ZJS_PWM_SERVO_PERIOD_US 20000
+#define ZJS_PWM_SERVO_MIN_US    1000
+#define ZJS_PWM_SERVO_MAX_US    2000
+#define ZJS_PWM_SERVO_DEGREES   180
+
+// native state of each hardware channel opened as a PWMPin or Servo, so the
+//   setters work from cached hw cycle counts instead of the object's
+//   properties
+struct zjs_pwm_channel {
+    bool opened;
+    bool claimed;           // a control loop or pipe drives the output
+    uint32_t channel;       // hardware channel
+    uint32_t period;        // hw cycles
+    bool reverse;           // on means low
+    uint32_t pulse;         // hw cycles
+    uint32_t duty;          // last duty a claimed channel was set to
+    struct zjs_pwm_fade fade;
+    uint32_t servo_min;     // hw cycles for 0 degrees
+    uint32_t servo_max;     // hw cycles for the far end of the range
+    uint32_t servo_step;    // hw cycles per degree, 16.16 fixed point
+};
+
+static struct zjs_pwm_channel zjs_pwm_channels[ZJS_PWM_CHANNELS];
+
+static uint32_t zjs_pwm_cycles_per_ms;
+static uint32_t zjs_pwm_cycles_per_us;
+
+static struct nano_sem zjs_pwm_fade_sem;
+static char __stack zjs_pwm_fade_stack[ZJS_PWM_FADE_STACK_SIZE];
+static bool zjs_pwm_fade_started = false;
+
 int (*zjs_pwm_convert_pin)(int num) = zjs_identity;
 
 jerry_object_t *zjs_pwm_init()
 {
     // effects: finds the PWM driver and registers the PWM JS object
+    zjs_pwm_cycles_per_ms = sys_clock_hw_cycles_per_sec / 1000;
+    zjs_pwm_cycles_per_us = sys_clock_hw_cycles_per_sec / 1000000;
     zjs_pwm_dev = device_get_binding("PWM_0");
     if (!zjs_pwm_dev) {
         PRINT("error: cannot find PWM_0 device\n");
@@ -28,38 +110,31 @@ jerry_object_t *zjs_pwm_init()
     // create PWM object
     jerry_object_t *pwm_obj = jerry_create_object();
     zjs_obj_add_function(pwm_obj, zjs_pwm_open, "open");
+    zjs_obj_add_function(pwm_obj, zjs_pwm_set_channels, "setChannels");
+    zjs_obj_add_function(pwm_obj, zjs_pwm_open_servo, "openServo");
     return pwm_obj;
 }
 
-static void zjs_pwm_set(uint32_t channel, uint32_t period, uint32_t pulseWidth,
-                        const char *polarity)
+static void zjs_pwm_timing(const struct zjs_pwm_channel *ch, uint32_t pulse,
+                           uint32_t *on, uint32_t *off)
 {
-    // requires: channel is 0-3 on Arduino 101, period is the time in hw cycles
-    //             for the on/off cycle to complete, pulse width is the time in
-    //             hw cycles for the signal to be on, polarity is "normal" if
-    //             on means high, "reversed" if on means low
-    //  effects: sets the given period and pulse width, but the true pulse
-    //             must always be off for at least one hw cycle
+    // requires: ch is an open channel, pulse is the time in hw cycles for
+    //             the signal to be on
+    //  effects: computes the on and off times to give the driver for ch,
+    //             but the true pulse must always be off for at least one hw
+    //             cycle
+    uint32_t period = ch->period;
     if (period < 1) {
         // period must be at least one cycle
         period = 1;
     }
-    if (pulseWidth > period) {
+    if (pulse > period) {
         PRINT("warning: pulseWidth was greater than period\n");
-        pulseWidth = period;
+        pulse = period;
     }
 
-    uint32_t offduty = period - pulseWidth;
-
-    uint32_t onTime, offTime;
-    if (strcmp(polarity, ZJS_POLARITY_REVERSE)) {
-        onTime = pulseWidth;
-        offTime = offduty;
-    }
-    else {
-        onTime = offduty;
-        offTime = pulseWidth;
-    }
+    uint32_t onTime = ch->reverse ? period - pulse : pulse;
+    uint32_t offTime = period - onTime;
 
     // work around the fact that Zephyr API won't allow fully on
     if (offTime == 0) {
@@ -68,7 +143,319 @@ static void zjs_pwm_set(uint32_t channel, uint32_t period, uint32_t pulseWidth,
         onTime -= 1;
     }
 
-    pwm_pin_set_values(zjs_pwm_dev, channel, onTime, offTime);
+    *on = onTime;
+    *off = offTime;
+}
+
+static void zjs_pwm_write(const struct zjs_pwm_channel *ch)
+{
+    // requires: ch is an open channel
+    //  effects: sets the channel's on and off times from its period and
+    //             pulse in one driver call, with interrupts masked so a
+    //             fiber's write can't land between working out the times
+    //             and setting them
+    uint32_t onTime, offTime;
+    int key = irq_lock();
+    zjs_pwm_timing(ch, ch->pulse, &onTime, &offTime);
+    pwm_pin_set_values(zjs_pwm_dev, ch->channel, onTime, offTime);
+    irq_unlock(key);
+}
+
+static uint32_t zjs_pwm_duty_to_pulse(uint32_t period, uint32_t duty)
+{
+    // requires: duty is at most ZJS_PWM_DUTY_MAX
+    //  effects: returns duty / ZJS_PWM_DUTY_MAX of period, rounded
+    return ((uint64_t)period * duty + ZJS_PWM_DUTY_MAX / 2) / ZJS_PWM_DUTY_MAX;
+}
+
+static uint32_t zjs_pwm_pulse_to_duty(const struct zjs_pwm_channel *ch)
+{
+    // effects: returns ch's current pulse as a fraction of its period, in
+    //            units of 1 / ZJS_PWM_DUTY_MAX
+    if (!ch->period)
+        return 0;
+
+    uint64_t ratio = (uint64_t)ch->pulse * ZJS_PWM_DUTY_MAX / ch->period;
+    return ratio > ZJS_PWM_DUTY_MAX ? ZJS_PWM_DUTY_MAX : ratio;
+}
+
+static void zjs_pwm_set_period(struct zjs_pwm_channel *ch, uint32_t period)
+{
+    // requires: called only from task context, ch is an open channel
+    //  effects: changes ch's period in hw cycles, keeping a claimed
+    //             channel's duty cycle so the last output of its loop or
+    //             pipe still holds; masks interrupts so a fiber's write
+    //             can't land between the two
+    int key = irq_lock();
+    ch->period = period;
+    if (ch->claimed)
+        ch->pulse = zjs_pwm_duty_to_pulse(period, ch->duty);
+    irq_unlock(key);
+    zjs_pwm_write(ch);
+}
+
+static bool zjs_pwm_check_unclaimed(const struct zjs_pwm_channel *ch,
+                                    const char *func)
+{
+    // effects: returns true if JS may set ch's output, or prints why not
+    if (ch->claimed) {
+        PRINT("%s: channel is driven by a control loop or pipe\n", func);
+        return false;
+    }
+    return true;
+}
+
+static struct zjs_pwm_channel *zjs_pwm_get_channel(jerry_object_t *pin_obj)
+{
+    // effects: returns the native state of the PWMPin object pin_obj, or
+    //            NULL if it isn't one
+    uintptr_t ptr;
+    if (!jerry_get_object_native_handle(pin_obj, &ptr))
+        return NULL;
+
+    struct zjs_pwm_channel *ch = (struct zjs_pwm_channel *)ptr;
+    if (ch < zjs_pwm_channels || ch >= zjs_pwm_channels + ZJS_PWM_CHANNELS)
+        return NULL;
+    return ch;
+}
+
+static uint32_t zjs_pwm_curve(const uint16_t *curve, uint32_t level)
+{
+    // requires: level is at most ZJS_PWM_DUTY_MAX
+    //  effects: returns the duty cycle curve gives for level, or level itself
+    //             if curve is NULL
+    if (!curve)
+        return level;
+
+    uint32_t i = level >> ZJS_PWM_CURVE_SHIFT;
+    uint32_t frac = level & ((1 << ZJS_PWM_CURVE_SHIFT) - 1);
+    return curve[i] + (((curve[i + 1] - curve[i]) * frac) >>
+                       ZJS_PWM_CURVE_SHIFT);
+}
+
+static uint32_t zjs_pwm_curve_level(const uint16_t *curve, uint32_t duty)
+{
+    // requires: duty is at most ZJS_PWM_DUTY_MAX
+    //  effects: returns the level curve maps closest to duty, or duty itself
+    //             if curve is NULL
+    if (!curve)
+        return duty;
+
+    // find the entries on either side of duty
+    uint32_t lo = 0, hi = ZJS_PWM_CURVE_ENTRIES - 1;
+    while (hi - lo > 1) {
+        uint32_t mid = (lo + hi) / 2;
+        if (curve[mid] <= duty)
+            lo = mid;
+        else
+            hi = mid;
+    }
+
+    uint32_t level = (lo << ZJS_PWM_CURVE_SHIFT) +
+        ((duty - curve[lo]) << ZJS_PWM_CURVE_SHIFT) / (curve[hi] - curve[lo]);
+    return level > ZJS_PWM_DUTY_MAX ? ZJS_PWM_DUTY_MAX : level;
+}
+
+static bool zjs_pwm_fade_step(struct zjs_pwm_channel *ch, uint32_t now)
+{
+    // requires: called only from the fade fiber, now is the current tick
+    //  effects: writes the duty cycle a fading channel should have at now,
+    //             moving on to the next keyframe once the current one's time
+    //             is up; returns true if the channel is still fading
+    struct zjs_pwm_fade *fade = &ch->fade;
+    int key = irq_lock();
+    bool active = fade->active;
+    uint32_t seq = fade->seq;
+    struct zjs_pwm_keyframe frame = fade->frames[fade->index];
+    uint32_t from = fade->from;
+    uint32_t elapsed = now - fade->start;
+    irq_unlock(key);
+    if (!active)
+        return false;
+
+    uint32_t level = frame.level;
+    if (elapsed < frame.ticks) {
+        int32_t delta = (int32_t)frame.level - (int32_t)from;
+        level = from + (int32_t)((int64_t)delta * elapsed / frame.ticks);
+    }
+
+    uint32_t pulse = zjs_pwm_duty_to_pulse(ch->period,
+                                           zjs_pwm_curve(frame.curve, level));
+    if (pulse != ch->pulse) {
+        ch->pulse = pulse;
+        zjs_pwm_write(ch);
+    }
+    if (elapsed < frame.ticks)
+        return true;
+
+    key = irq_lock();
+    if (fade->seq == seq) {
+        // start the next keyframe when this one was due to end, not now, so
+        //   a late step doesn't stretch the sequence
+        fade->start += frame.ticks;
+        fade->from = frame.level;
+        if (++fade->index == fade->count) {
+            fade->index = 0;
+            if (fade->repeat && ++fade->pass == fade->repeat) {
+                fade->active = false;
+                if (!fade->queued) {
+                    fade->queued = true;
+                    zjs_queue_callback(&fade->done_cb);
+                }
+            }
+        }
+
+        const uint16_t *curve = fade->frames[fade->index].curve;
+        if (curve != frame.curve) {
+            fade->from = zjs_pwm_curve_level(curve,
+                                             zjs_pwm_curve(frame.curve,
+                                                           frame.level));
+        }
+    }
+    active = fade->active;
+    irq_unlock(key);
+    return active;
+}
+
+static void zjs_pwm_fade_fiber(int arg1, int arg2)
+{
+    // effects: steps every fading channel once a tick, sleeping until a fade
+    //            starts when there are none
+    while (1) {
+        uint32_t now = sys_tick_get_32();
+        bool fading = false;
+        for (int i = 0; i < ZJS_PWM_CHANNELS; i++) {
+            if (zjs_pwm_fade_step(&zjs_pwm_channels[i], now))
+                fading = true;
+        }
+        nano_fiber_sem_take(&zjs_pwm_fade_sem,
+                            fading ? 1 : TICKS_UNLIMITED);
+    }
+}
+
+static void zjs_pwm_fade_call_done(struct zjs_callback *cb)
+{
+    // requires: called only from task context
+    //  effects: calls the pin's 'fadeEnd' listener, if set, then lets go of
+    //             the pin unless the listener started another fade
+    struct zjs_pwm_fade *fade = CONTAINER_OF(cb, struct zjs_pwm_fade,
+                                             done_cb);
+    int key = irq_lock();
+    fade->queued = false;
+    irq_unlock(key);
+
+    if (cb->js_callback) {
+        jerry_value_t rval = jerry_call_function(cb->js_callback,
+                                                 fade->pin_obj, NULL, 0);
+        if (jerry_value_is_error(rval)) {
+            PRINT("error: calling fadeEnd callback\n");
+        }
+        jerry_release_value(rval);
+    }
+
+    if (!fade->active && fade->pin_obj) {
+        jerry_release_object(fade->pin_obj);
+        fade->pin_obj = NULL;
+    }
+}
+
+static void zjs_pwm_fade_cancel(struct zjs_pwm_channel *ch)
+{
+    // requires: called only from task context
+    //  effects: stops any fade on ch, leaving the output where it got to
+    struct zjs_pwm_fade *fade = &ch->fade;
+    if (!fade->active && !fade->pin_obj)
+        return;
+
+    int key = irq_lock();
+    fade->active = false;
+    fade->seq++;
+    bool queued = fade->queued;
+    irq_unlock(key);
+
+    // a queued fadeEnd still needs the pin, and lets go of it itself
+    if (!queued && fade->pin_obj) {
+        jerry_release_object(fade->pin_obj);
+        fade->pin_obj = NULL;
+    }
+}
+
+bool zjs_pwm_get_output(jerry_object_t *pin_obj, struct zjs_pwm_output *out)
+{
+    // requires: called only from task context
+    //  effects: fills in out with the hardware channel of the PWMPin object
+    //             pin_obj; returns false if it isn't one
+    struct zjs_pwm_channel *ch = zjs_pwm_get_channel(pin_obj);
+    if (!ch)
+        return false;
+
+    out->channel = ch->channel;
+    return true;
+}
+
+bool zjs_pwm_output_claim(const struct zjs_pwm_output *out)
+{
+    // requires: called only from task context, out came from
+    //             zjs_pwm_get_output
+    //  effects: hands the output to native code, stopping any fade; until
+    //             it is released, the pin's fade and pulse width, duty cycle
+    //             and setChannels writes are refused; returns false if
+    //             something else has already claimed it
+    struct zjs_pwm_channel *ch = &zjs_pwm_channels[out->channel];
+    if (ch->claimed)
+        return false;
+
+    zjs_pwm_fade_cancel(ch);
+    ch->duty = zjs_pwm_pulse_to_duty(ch);
+    ch->claimed = true;
+    return true;
+}
+
+void zjs_pwm_output_release(const struct zjs_pwm_output *out)
+{
+    // requires: called only from task context, out was claimed
+    //  effects: gives the output back to the pin's JS methods, leaving it
+    //             at its last duty cycle
+    zjs_pwm_channels[out->channel].claimed = false;
+}
+
+void zjs_pwm_output_set(const struct zjs_pwm_output *out, uint32_t duty)
+{
+    // requires: out was claimed with zjs_pwm_output_claim, duty is at most
+    //             ZJS_PWM_DUTY_MAX; called from a fiber or task context
+    //  effects: sets the output's pulse width to duty / ZJS_PWM_DUTY_MAX of
+    //             the pin's period as it is now, without touching the
+    //             PWMPin object
+    struct zjs_pwm_channel *ch = &zjs_pwm_channels[out->channel];
+    ch->duty = duty;
+    ch->pulse = zjs_pwm_duty_to_pulse(ch->period, duty);
+    zjs_pwm_write(ch);
+}
+
+static bool zjs_pwm_parse_keyframe(jerry_object_t *obj,
+                                   struct zjs_pwm_keyframe *frame)
+{
+    // effects: fills in frame from obj's to, durationMs and curve fields;
+    //            returns false if they aren't valid
+    double to, ms = 0;
+    if (!zjs_obj_get_double(obj, "to", &to) || !(to >= 0 && to <= 1))
+        return false;
+    if (zjs_obj_get_double(obj, "durationMs", &ms) && !(ms >= 0))
+        return false;
+
+    const int BUFLEN = 8;
+    char buffer[BUFLEN];
+    frame->curve = NULL;
+    if (zjs_obj_get_string(obj, "curve", buffer, BUFLEN)) {
+        if (!strcmp(buffer, "gamma"))
+            frame->curve = zjs_pwm_gamma;
+        else if (strcmp(buffer, "linear"))
+            return false;
+    }
+
+    frame->level = to * ZJS_PWM_DUTY_MAX + 0.5;
+    frame->ticks = ms * CONFIG_SYS_CLOCK_TICKS_PER_SEC / 1000 + 0.5;
+    return true;
 }
 
 bool zjs_pwm_open(const jerry_object_t *function_obj_p,
@@ -78,8 +465,8 @@ bool zjs_pwm_open(const jerry_object_t *function_obj_p,
                   jerry_value_t *ret_val_p)
 {
     // requires: arg 0 is an object with these members: channel (int), period in
-    //             hardware cycles (defaults to 255), pulse width in hardware
-    //             cycles (defaults to 0), polarity (defaults to "normal")
+    //             milliseconds (defaults to 0), pulse width in milliseconds
+    //             (defaults to 0), polarity (defaults to "normal")
     //  effects: returns a new PWMPin object representing the given channel
     if (args_cnt < 1 || !jerry_value_is_object(args_p[0])) {
         PRINT("zjs_pwm_open: invalid argument\n");
@@ -96,12 +483,12 @@ bool zjs_pwm_open(const jerry_object_t *function_obj_p,
     }
 
     int newchannel = zjs_pwm_convert_pin(channel);
-    if (newchannel == -1) {
+    if (newchannel < 0 || newchannel >= ZJS_PWM_CHANNELS) {
         PRINT("invalid channel\n");
         return false;
     }
 
-    double period, pulseWidth;
+    double period = 0, pulseWidth = 0;
     zjs_obj_get_double(data, "period", &period);
     zjs_obj_get_double(data, "pulseWidth", &pulseWidth);
 
@@ -114,10 +501,17 @@ bool zjs_pwm_open(const jerry_object_t *function_obj_p,
     }
 
     // set the inital timing
-    uint32_t pulseWidthHW = pulseWidth * sys_clock_hw_cycles_per_sec / 1000;
-    uint32_t periodHW = period * sys_clock_hw_cycles_per_sec / 1000;
-
-    zjs_pwm_set(newchannel, periodHW, pulseWidthHW, polarity);
+    struct zjs_pwm_channel *ch = &zjs_pwm_channels[newchannel];
+    if (!zjs_pwm_check_unclaimed(ch, "zjs_pwm_open"))
+        return false;
+    zjs_pwm_fade_cancel(ch);
+    ch->opened = true;
+    ch->servo_max = 0;
+    ch->channel = newchannel;
+    ch->period = period * zjs_pwm_cycles_per_ms;
+    ch->reverse = polarity == ZJS_POLARITY_REVERSE;
+    ch->pulse = pulseWidth * zjs_pwm_cycles_per_ms;
+    zjs_pwm_write(ch);
 
     // create the PWMPin object
     jerry_object_t *pinobj = jerry_create_object();
@@ -127,46 +521,112 @@ bool zjs_pwm_open(const jerry_object_t *function_obj_p,
     zjs_obj_add_function(pinobj, zjs_pwm_pin_set_pulse_width, "setPulseWidth");
     zjs_obj_add_function(pinobj, zjs_pwm_pin_set_pulse_width_cycles,
                          "setPulseWidthCycles");
+    zjs_obj_add_function(pinobj, zjs_pwm_pin_set_duty_cycle, "setDutyCycle");
+    zjs_obj_add_function(pinobj, zjs_pwm_pin_fade, "fade");
+    zjs_obj_add_function(pinobj, zjs_pwm_pin_stop_fade, "stopFade");
+    zjs_obj_add_function(pinobj, zjs_pwm_pin_on, "on");
     zjs_obj_add_number(pinobj, channel, "channel");
     zjs_obj_add_number(pinobj, period, "period");
     zjs_obj_add_number(pinobj, pulseWidth, "pulseWidth");
     zjs_obj_add_string(pinobj, polarity, "polarity");
+    jerry_set_object_native_handle(pinobj, (uintptr_t)ch, NULL);
     // TODO: When we implement close, we should release the reference on this
 
     *ret_val_p = jerry_create_object_value(pinobj);
     return true;
 }
 
-static bool zjs_set_period(jerry_object_t *obj, double period)
+bool zjs_pwm_set_channels(const jerry_object_t *function_obj_p,
+                          const jerry_value_t this_val,
+                          const jerry_value_t args_p[],
+                          const jerry_length_t args_cnt,
+                          jerry_value_t *ret_val_p)
 {
-    // requires: obj is a PWM pin object, period is in milliseconds
-    //  effects: sets the PWM pin to the given period, records the period
-    //             in the object
-    uint32_t channel;
-    double pulseWidth;
-    zjs_obj_get_uint32(obj, "channel", &channel);
-    zjs_obj_get_double(obj, "pulseWidth", &pulseWidth);
+    // requires: arg 0 is an array of up to four objects, each with channel,
+    //             a channel already opened, and either pulseWidth in
+    //             milliseconds or dutyCycle, the fraction of the period to be
+    //             on
+    //  effects: converts every entry first, then updates all the channels
+    //             back to back with interrupts masked, so an RGB LED changes
+    //             colour in one step; stops any fades on those channels, and
+    //             like setDutyCycle leaves the pulseWidth properties alone
+    jerry_object_t *array = NULL;
+    if (args_cnt >= 1 && jerry_value_is_object(args_p[0]))
+        array = jerry_get_object_value(args_p[0]);
+    uint32_t count = array && jerry_is_array(array) ?
+                     jerry_get_array_length(array) : 0;
+    if (count < 1 || count > ZJS_PWM_CHANNELS) {
+        PRINT("zjs_pwm_set_channels: expected 1 to %d entries\n",
+              ZJS_PWM_CHANNELS);
+        return false;
+    }
 
-    int newchannel = zjs_pwm_convert_pin(channel);
+    struct zjs_pwm_channel *chs[ZJS_PWM_CHANNELS];
+    uint32_t pulses[ZJS_PWM_CHANNELS];
+    uint32_t on[ZJS_PWM_CHANNELS], off[ZJS_PWM_CHANNELS];
+    for (uint32_t i = 0; i < count; i++) {
+        jerry_value_t entry;
+        if (!jerry_get_array_index_value(array, i, &entry))
+            return false;
 
-    const int BUFLEN = 10;
-    char buffer[BUFLEN];
-    const char *polarity = ZJS_POLARITY_NORMAL;
-    if (zjs_obj_get_string(obj, "polarity", buffer, BUFLEN)) {
-        if (!strcmp(buffer, ZJS_POLARITY_REVERSE))
-            polarity = ZJS_POLARITY_REVERSE;
-    }
+        bool ok = jerry_value_is_object(entry);
+        jerry_object_t *obj = ok ? jerry_get_object_value(entry) : NULL;
+        uint32_t channel;
+        int newchannel = -1;
+        if (ok && zjs_obj_get_uint32(obj, "channel", &channel))
+            newchannel = zjs_pwm_convert_pin(channel);
+        ok = newchannel >= 0 && newchannel < ZJS_PWM_CHANNELS &&
+             zjs_pwm_channels[newchannel].opened;
 
-    // update the JS object
-    zjs_obj_add_number(obj, period, "period");
+        double value = -1;
+        if (ok) {
+            struct zjs_pwm_channel *ch = &zjs_pwm_channels[newchannel];
+            if (zjs_obj_get_double(obj, "pulseWidth", &value)) {
+                ok = value >= 0;
+                pulses[i] = value * zjs_pwm_cycles_per_ms;
+            } else if (zjs_obj_get_double(obj, "dutyCycle", &value)) {
+                ok = value >= 0 && value <= 1;
+                pulses[i] = zjs_pwm_duty_to_pulse(ch->period,
+                                                  value * ZJS_PWM_DUTY_MAX +
+                                                  0.5);
+            } else {
+                ok = false;
+            }
+            chs[i] = ch;
+        }
+        jerry_release_value(entry);
+        if (!ok) {
+            PRINT("zjs_pwm_set_channels: invalid entry %lu\n", i);
+            return false;
+        }
+        if (!zjs_pwm_check_unclaimed(chs[i], "zjs_pwm_set_channels"))
+            return false;
+        zjs_pwm_timing(chs[i], pulses[i], &on[i], &off[i]);
+    }
 
-    uint32_t pulseWidthHW = pulseWidth * sys_clock_hw_cycles_per_sec / 1000;
-    uint32_t periodHW = period * sys_clock_hw_cycles_per_sec / 1000;
+    for (uint32_t i = 0; i < count; i++)
+        zjs_pwm_fade_cancel(chs[i]);
 
-    zjs_pwm_set(newchannel, periodHW, pulseWidthHW, polarity);
+    int key = irq_lock();
+    for (uint32_t i = 0; i < count; i++) {
+        chs[i]->pulse = pulses[i];
+        pwm_pin_set_values(zjs_pwm_dev, chs[i]->channel, on[i], off[i]);
+    }
+    irq_unlock(key);
     return true;
 }
 
+static struct zjs_pwm_channel *zjs_pwm_this_channel(const jerry_value_t this_val,
+                                                    const jerry_value_t args_p[],
+                                                    const jerry_length_t args_cnt)
+{
+    // effects: returns the native state of this_val, a PWMPin object, if
+    //            arg 0 is a number, or NULL
+    if (args_cnt < 1 || !jerry_value_is_number(args_p[0]))
+        return NULL;
+    return zjs_pwm_get_channel(jerry_get_object_value(this_val));
+}
+
 bool zjs_pwm_pin_set_period_cycles(const jerry_object_t *function_obj_p,
                                    const jerry_value_t this_val,
                                    const jerry_value_t args_p[],
@@ -178,18 +638,20 @@ bool zjs_pwm_pin_set_period_cycles(const jerry_object_t *function_obj_p,
     //             underlying hardware (31.25ns each for Arduino 101)
     //  effects: updates the period of this PWM pin, using the finest grain
     //             units provided by the platform, providing the widest range
-    jerry_object_t *obj = jerry_get_object_value(this_val);
-
-    if (args_cnt < 1 || !jerry_value_is_number(args_p[0])) {
+    struct zjs_pwm_channel *ch = zjs_pwm_this_channel(this_val, args_p,
+                                                      args_cnt);
+    if (!ch) {
         PRINT("zjs_pwm_pin_set_period: invalid argument\n");
         return false;
     }
 
-    // convert to milliseconds
-    double periodHW = jerry_get_number_value(args_p[0]);
-    double period = periodHW / sys_clock_hw_cycles_per_sec * 1000;
+    zjs_pwm_set_period(ch, jerry_get_number_value(args_p[0]));
 
-    return zjs_set_period(obj, period);
+    // update the JS object, in milliseconds
+    zjs_obj_add_number(jerry_get_object_value(this_val),
+                       (double)ch->period / zjs_pwm_cycles_per_ms,
+                       "period");
+    return true;
 }
 
 bool zjs_pwm_pin_set_period(const jerry_object_t *function_obj_p,
@@ -202,44 +664,18 @@ bool zjs_pwm_pin_set_period(const jerry_object_t *function_obj_p,
     //             argument, the period in milliseconds (float)
     //  effects: updates the period of this PWM pin, getting as close as
     //             possible to what is requested given hardware constraints
-    jerry_object_t *obj = jerry_get_object_value(this_val);
-
-    if (args_cnt < 1 || !jerry_value_is_number(args_p[0])) {
+    struct zjs_pwm_channel *ch = zjs_pwm_this_channel(this_val, args_p,
+                                                      args_cnt);
+    if (!ch) {
         PRINT("zjs_pwm_pin_set_period_us: invalid argument\n");
         return false;
     }
 
-    return zjs_set_period(obj, jerry_get_number_value(args_p[0]));
-}
-
-static bool zjs_set_pulse_width(jerry_object_t *obj, double pulseWidth)
-{
-    // requires: obj is a PWM pin object, pulseWidth is in milliseconds
-    //  effects: sets the PWM pin to the given pulse width, records the pulse
-    //             width in the object
-    uint32_t channel;
-    double period;
-    zjs_obj_get_uint32(obj, "channel", &channel);
-    zjs_obj_get_double(obj, "period", &period);
-
-    int newchannel = zjs_pwm_convert_pin(channel);
-
-    const int BUFLEN = 10;
-    char buffer[BUFLEN];
-    const char *polarity = ZJS_POLARITY_NORMAL;
-    if (zjs_obj_get_string(obj, "polarity", buffer, BUFLEN)) {
-        if (!strcmp(buffer, ZJS_POLARITY_REVERSE))
-            polarity = ZJS_POLARITY_REVERSE;
-    }
+    double period = jerry_get_number_value(args_p[0]);
+    zjs_pwm_set_period(ch, period * zjs_pwm_cycles_per_ms);
 
     // update the JS object
-    zjs_obj_add_number(obj, pulseWidth, "pulseWidth");
-
-    // convert to hw cycles
-    uint32_t pulseWidthHW = pulseWidth * sys_clock_hw_cycles_per_sec / 1000;
-    uint32_t periodHW = period * sys_clock_hw_cycles_per_sec / 1000;
-
-    zjs_pwm_set(newchannel, periodHW, pulseWidthHW, polarity);
+    zjs_obj_add_number(jerry_get_object_value(this_val), period, "period");
     return true;
 }
 
@@ -252,19 +688,25 @@ bool zjs_pwm_pin_set_pulse_width_cycles(const jerry_object_t *function_obj_p,
     // requires: this_val is a PWMPin object from zjs_pwm_open, takes one
     //             argument, the pulse width in hardware cycles, dependent on
     //             the underlying hardware (31.25ns each for Arduino 101)
-    //  effects: updates the pulse width of this PWM pin
-    jerry_object_t *obj = jerry_get_object_value(this_val);
-
-    if (args_cnt < 1 || !jerry_value_is_number(args_p[0])) {
+    //  effects: updates the pulse width of this PWM pin, stopping any fade
+    struct zjs_pwm_channel *ch = zjs_pwm_this_channel(this_val, args_p,
+                                                      args_cnt);
+    if (!ch) {
         PRINT("zjs_pwm_pin_set_pulse_width: invalid argument\n");
         return false;
     }
+    if (!zjs_pwm_check_unclaimed(ch, "zjs_pwm_pin_set_pulse_width"))
+        return false;
 
-    // convert to milliseconds
-    double pulseWidthHW = jerry_get_number_value(args_p[0]);
-    double pulseWidth = pulseWidthHW / sys_clock_hw_cycles_per_sec * 1000;
+    zjs_pwm_fade_cancel(ch);
+    ch->pulse = jerry_get_number_value(args_p[0]);
+    zjs_pwm_write(ch);
 
-    return zjs_set_pulse_width(obj, pulseWidth);
+    // update the JS object, in milliseconds
+    zjs_obj_add_number(jerry_get_object_value(this_val),
+                       (double)ch->pulse / zjs_pwm_cycles_per_ms,
+                       "pulseWidth");
+    return true;
 }
 
 bool zjs_pwm_pin_set_pulse_width(const jerry_object_t *function_obj_p,
@@ -275,13 +717,336 @@ bool zjs_pwm_pin_set_pulse_width(const jerry_object_t *function_obj_p,
 {
     // requires: this_val is a PWMPin object from zjs_pwm_open, takes one
     //             argument, the pulse width in milliseconds (float)
-    //  effects: updates the pulse width of this PWM pin
-    jerry_object_t *obj = jerry_get_object_value(this_val);
-
-    if (args_cnt < 1 || !jerry_value_is_number(args_p[0])) {
+    //  effects: updates the pulse width of this PWM pin, stopping any fade
+    struct zjs_pwm_channel *ch = zjs_pwm_this_channel(this_val, args_p,
+                                                      args_cnt);
+    if (!ch) {
         PRINT("zjs_pwm_pin_set_pulse_width_us: invalid argument\n");
         return false;
     }
+    if (!zjs_pwm_check_unclaimed(ch, "zjs_pwm_pin_set_pulse_width_us"))
+        return false;
+
+    zjs_pwm_fade_cancel(ch);
+    double pulseWidth = jerry_get_number_value(args_p[0]);
+    ch->pulse = pulseWidth * zjs_pwm_cycles_per_ms;
+    zjs_pwm_write(ch);
+
+    // update the JS object
+    zjs_obj_add_number(jerry_get_object_value(this_val), pulseWidth,
+                       "pulseWidth");
+    return true;
+}
+
+bool zjs_pwm_pin_set_duty_cycle(const jerry_object_t *function_obj_p,
+                                const jerry_value_t this_val,
+                                const jerry_value_t args_p[],
+                                const jerry_length_t args_cnt,
+                                jerry_value_t *ret_val_p)
+{
+    // requires: this_val is a PWMPin object from zjs_pwm_open, takes one
+    //             argument, the fraction of the period to be on, 0 to 1
+    //  effects: updates the pulse width of this PWM pin, stopping any fade;
+    //             for fast updates, the pulseWidth property isn't kept in
+    //             step; fails while a control loop or pipe drives the pin
+    struct zjs_pwm_channel *ch = zjs_pwm_this_channel(this_val, args_p,
+                                                      args_cnt);
+    double fraction = ch ? jerry_get_number_value(args_p[0]) : -1;
+    if (!(fraction >= 0 && fraction <= 1)) {
+        PRINT("zjs_pwm_pin_set_duty_cycle: invalid argument\n");
+        return false;
+    }
+    if (!zjs_pwm_check_unclaimed(ch, "zjs_pwm_pin_set_duty_cycle"))
+        return false;
+
+    zjs_pwm_fade_cancel(ch);
+    uint32_t duty = fraction * ZJS_PWM_DUTY_MAX + 0.5;
+    ch->pulse = zjs_pwm_duty_to_pulse(ch->period, duty);
+    zjs_pwm_write(ch);
+    return true;
+}
+
+bool zjs_pwm_pin_fade(const jerry_object_t *function_obj_p,
+                      const jerry_value_t this_val,
+                      const jerry_value_t args_p[],
+                      const jerry_length_t args_cnt,
+                      jerry_value_t *ret_val_p)
+{
+    // requires: this_val is a PWMPin object from zjs_pwm_open; arg 0 is
+    //             either a keyframe, an object with to, the duty cycle to
+    //             end at from 0 to 1, durationMs (defaults to 0) and curve,
+    //             'linear' (default) or 'gamma', or else an object with
+    //             keyframes, an array of up to eight of those, and repeat,
+    //             the passes to make through them (defaults to 1, 0 for
+    //             forever)
+    //  effects: fades the pin from its current duty cycle through the
+    //             keyframes in native code, replacing any fade in progress,
+    //             and calls the pin's 'fadeEnd' listener after the last pass;
+    //             the gamma curve makes steps look even to the eye on an
+    //             LED; fails while a control loop or pipe drives the pin
+    struct zjs_pwm_channel *ch = NULL;
+    if (args_cnt >= 1 && jerry_value_is_object(args_p[0]))
+        ch = zjs_pwm_get_channel(jerry_get_object_value(this_val));
+    if (!ch) {
+        PRINT("zjs_pwm_pin_fade: invalid argument\n");
+        return false;
+    }
+    if (!zjs_pwm_check_unclaimed(ch, "zjs_pwm_pin_fade"))
+        return false;
+
+    jerry_object_t *options = jerry_get_object_value(args_p[0]);
+    struct zjs_pwm_keyframe frames[ZJS_PWM_FADE_KEYFRAMES];
+    uint32_t count = 1, repeat = 1;
+    jerry_value_t keyframes =
+        jerry_get_object_field_value(options, (jerry_char_t *)"keyframes");
+    if (jerry_value_is_object(keyframes)) {
+        jerry_object_t *array = jerry_get_object_value(keyframes);
+        count = jerry_is_array(array) ? jerry_get_array_length(array) : 0;
+        bool ok = count > 0 && count <= ZJS_PWM_FADE_KEYFRAMES;
+        for (uint32_t i = 0; ok && i < count; i++) {
+            jerry_value_t entry;
+            ok = jerry_get_array_index_value(array, i, &entry);
+            if (!ok)
+                break;
+            ok = jerry_value_is_object(entry) &&
+                 zjs_pwm_parse_keyframe(jerry_get_object_value(entry),
+                                        &frames[i]);
+            jerry_release_value(entry);
+        }
+        jerry_release_value(keyframes);
+        if (!ok) {
+            PRINT("zjs_pwm_pin_fade: expected 1 to %d valid keyframes\n",
+                  ZJS_PWM_FADE_KEYFRAMES);
+            return false;
+        }
+        zjs_obj_get_uint32(options, "repeat", &repeat);
+    } else {
+        jerry_release_value(keyframes);
+        if (!zjs_pwm_parse_keyframe(options, &frames[0])) {
+            PRINT("zjs_pwm_pin_fade: invalid keyframe\n");
+            return false;
+        }
+    }
+
+    // start from the current output, in the first keyframe's curve
+    uint32_t duty = zjs_pwm_pulse_to_duty(ch);
+
+    struct zjs_pwm_fade *fade = &ch->fade;
+    if (!fade->pin_obj)
+        fade->pin_obj = jerry_acquire_object(jerry_get_object_value(this_val));
+    fade->done_cb.call_function = zjs_pwm_fade_call_done;
+
+    int key = irq_lock();
+    memcpy(fade->frames, frames, count * sizeof(struct zjs_pwm_keyframe));
+    fade->count = count;
+    fade->repeat = repeat;
+    fade->pass = 0;
+    fade->index = 0;
+    fade->from = zjs_pwm_curve_level(frames[0].curve, duty);
+    fade->start = sys_tick_get_32();
+    fade->seq++;
+    fade->active = true;
+    irq_unlock(key);
+
+    if (!zjs_pwm_fade_started) {
+        nano_sem_init(&zjs_pwm_fade_sem);
+        fiber_start(zjs_pwm_fade_stack, ZJS_PWM_FADE_STACK_SIZE,
+                    zjs_pwm_fade_fiber, 0, 0, ZJS_PWM_FADE_PRIORITY, 0);
+        zjs_pwm_fade_started = true;
+    }
+    nano_task_sem_give(&zjs_pwm_fade_sem);
+    return true;
+}
+
+bool zjs_pwm_pin_stop_fade(const jerry_object_t *function_obj_p,
+                           const jerry_value_t this_val,
+                           const jerry_value_t args_p[],
+                           const jerry_length_t args_cnt,
+                           jerry_value_t *ret_val_p)
+{
+    // requires: this_val is a PWMPin object from zjs_pwm_open
+    //  effects: stops the pin's fade, if any, leaving it where it got to;
+    //             the 'fadeEnd' listener isn't called
+    struct zjs_pwm_channel *ch =
+        zjs_pwm_get_channel(jerry_get_object_value(this_val));
+    if (!ch) {
+        PRINT("zjs_pwm_pin_stop_fade: invalid argument\n");
+        return false;
+    }
+
+    zjs_pwm_fade_cancel(ch);
+    return true;
+}
+
+bool zjs_pwm_pin_on(const jerry_object_t *function_obj_p,
+                    const jerry_value_t this_val,
+                    const jerry_value_t args_p[],
+                    const jerry_length_t args_cnt,
+                    jerry_value_t *ret_val_p)
+{
+    // requires: this_val is a PWMPin object from zjs_pwm_open, arg 0 is
+    //             'fadeEnd', arg 1 is a function, or null to remove the
+    //             listener
+    //  effects: calls the function each time a fade on this pin finishes
+    if (args_cnt < 2 || !jerry_value_is_string(args_p[0]) ||
+        !(jerry_value_is_object(args_p[1]) || jerry_value_is_null(args_p[1]))) {
+        PRINT("zjs_pwm_pin_on: invalid arguments\n");
+        return false;
+    }
+
+    if (!zjs_strequal(jerry_get_string_value(args_p[0]), "fadeEnd")) {
+        PRINT("zjs_pwm_pin_on: unsupported event\n");
+        return false;
+    }
+
+    struct zjs_pwm_channel *ch =
+        zjs_pwm_get_channel(jerry_get_object_value(this_val));
+    if (!ch) {
+        PRINT("zjs_pwm_pin_on: invalid argument\n");
+        return false;
+    }
+
+    struct zjs_callback *cb = &ch->fade.done_cb;
+    jerry_object_t *old = cb->js_callback;
+    if (jerry_value_is_object(args_p[1])) {
+        cb->js_callback =
+            jerry_acquire_object(jerry_get_object_value(args_p[1]));
+    } else {
+        cb->js_callback = NULL;
+    }
+    if (old)
+        jerry_release_object(old);
+    return true;
+}
+
+bool zjs_pwm_open_servo(const jerry_object_t *function_obj_p,
+                        const jerry_value_t this_val,
+                        const jerry_value_t args_p[],
+                        const jerry_length_t args_cnt,
+                        jerry_value_t *ret_val_p)
+{
+    // requires: arg 0 is an object with these members: channel (int), minUs
+    //             and maxUs, the pulse widths in microseconds for 0 and 180
+    //             degrees (default 1000 and 2000)
+    //  effects: returns a new Servo object driving the given channel at
+    //             50Hz; no pulses are sent until it is first written
+    if (args_cnt < 1 || !jerry_value_is_object(args_p[0])) {
+        PRINT("zjs_pwm_open_servo: invalid argument\n");
+        return false;
+    }
+
+    jerry_object_t *data = jerry_get_object_value(args_p[0]);
+
+    uint32_t channel;
+    if (!zjs_obj_get_uint32(data, "channel", &channel)) {
+        PRINT("zjs_pwm_open_servo: missing required field\n");
+        return false;
+    }
+
+    int newchannel = zjs_pwm_convert_pin(channel);
+    if (newchannel < 0 || newchannel >= ZJS_PWM_CHANNELS) {
+        PRINT("invalid channel\n");
+        return false;
+    }
+
+    uint32_t minUs = ZJS_PWM_SERVO_MIN_US, maxUs = ZJS_PWM_SERVO_MAX_US;
+    zjs_obj_get_uint32(data, "minUs", &minUs);
+    zjs_obj_get_uint32(data, "maxUs", &maxUs);
+    if (minUs >= maxUs || maxUs >= ZJS_PWM_SERVO_PERIOD_US) {
+        PRINT("zjs_pwm_open_servo: invalid pulse range\n");
+        return false;
+    }
+
+    // work out the conversions once, so writes are an integer multiply and
+    //   an add
+    struct zjs_pwm_channel *ch = &zjs_pwm_channels[newchannel];
+    if (!zjs_pwm_check_unclaimed(ch, "zjs_pwm_open_servo"))
+        return false;
+    zjs_pwm_fade_cancel(ch);
+    ch->opened = true;
+    ch->channel = newchannel;
+    ch->period = ZJS_PWM_SERVO_PERIOD_US * zjs_pwm_cycles_per_us;
+    ch->reverse = false;
+    ch->servo_min = minUs * zjs_pwm_cycles_per_us;
+    ch->servo_max = maxUs * zjs_pwm_cycles_per_us;
+    ch->servo_step = (((uint64_t)(ch->servo_max - ch->servo_min) << 16) +
+                      ZJS_PWM_SERVO_DEGREES / 2) / ZJS_PWM_SERVO_DEGREES;
+    ch->pulse = 0;
+    zjs_pwm_write(ch);
+
+    jerry_object_t *servo_obj = jerry_create_object();
+    zjs_obj_add_function(servo_obj, zjs_pwm_servo_write, "write");
+    zjs_obj_add_function(servo_obj, zjs_pwm_servo_write_us,
+                         "writeMicroseconds");
+    zjs_obj_add_number(servo_obj, channel, "channel");
+    zjs_obj_add_number(servo_obj, minUs, "minUs");
+    zjs_obj_add_number(servo_obj, maxUs, "maxUs");
+    jerry_set_object_native_handle(servo_obj, (uintptr_t)ch, NULL);
+
+    *ret_val_p = jerry_create_object_value(servo_obj);
+    return true;
+}
+
+bool zjs_pwm_servo_write(const jerry_object_t *function_obj_p,
+                         const jerry_value_t this_val,
+                         const jerry_value_t args_p[],
+                         const jerry_length_t args_cnt,
+                         jerry_value_t *ret_val_p)
+{
+    // requires: this_val is a Servo object from zjs_pwm_open_servo, takes
+    //             one argument, the angle in degrees, 0 to 180
+    //  effects: moves the servo to the angle, clamped to its range
+    struct zjs_pwm_channel *ch = zjs_pwm_this_channel(this_val, args_p,
+                                                      args_cnt);
+    double angle = ch ? jerry_get_number_value(args_p[0]) : -1;
+    if (!ch || !ch->servo_max || angle != angle) {
+        PRINT("zjs_pwm_servo_write: invalid argument\n");
+        return false;
+    }
+    if (!zjs_pwm_check_unclaimed(ch, "zjs_pwm_servo_write"))
+        return false;
+
+    if (angle < 0)
+        angle = 0;
+    else if (angle > ZJS_PWM_SERVO_DEGREES)
+        angle = ZJS_PWM_SERVO_DEGREES;
+
+    // both the angle and the slope are 16.16, so the product is 32.32
+    uint64_t fixed = (uint32_t)(angle * 65536);
+    zjs_pwm_fade_cancel(ch);
+    ch->pulse = ch->servo_min +
+                (uint32_t)((fixed * ch->servo_step + (1ULL << 31)) >> 32);
+    zjs_pwm_write(ch);
+    return true;
+}
+
+bool zjs_pwm_servo_write_us(const jerry_object_t *function_obj_p,
+                            const jerry_value_t this_val,
+                            const jerry_value_t args_p[],
+                            const jerry_length_t args_cnt,
+                            jerry_value_t *ret_val_p)
+{
+    // requires: this_val is a Servo object from zjs_pwm_open_servo, takes
+    //             one argument, the pulse width in microseconds
+    //  effects: sets the pulse width, clamped to the servo's minUs to maxUs
+    struct zjs_pwm_channel *ch = zjs_pwm_this_channel(this_val, args_p,
+                                                      args_cnt);
+    double us = ch ? jerry_get_number_value(args_p[0]) : -1;
+    if (!ch || !ch->servo_max || !(us >= 0)) {
+        PRINT("zjs_pwm_servo_write_us: invalid argument\n");
+        return false;
+    }
+    if (!zjs_pwm_check_unclaimed(ch, "zjs_pwm_servo_write_us"))
+        return false;
+
+    uint32_t pulse = us * zjs_pwm_cycles_per_us + 0.5;
+    if (pulse < ch->servo_min)
+        pulse = ch->servo_min;
+    else if (pulse > ch->servo_max)
+        pulse = ch->servo_max;
 
-    return zjs_set_pulse_width(obj, jerry_get_number_value(args_p[0]));
+    zjs_pwm_fade_cancel(ch);
+    ch->pulse = pulse;
+    zjs_pwm_write(ch);
+    return true;
 }
@@ -2,16 +2,49 @@
 
 #include "jerry-api.h"
 
+// hardware PWM channels on the Quark SE
+#define ZJS_PWM_CHANNELS 4
+
+// full scale of a duty cycle passed to zjs_pwm_output_set
+#define ZJS_PWM_DUTY_MAX 0xFFFF
+
+// A PWM channel resolved from a PWMPin object, for native code that drives
+//   the output itself instead of through the object's JS methods; writes
+//   use the pin's period and polarity as they are at the time
+struct zjs_pwm_output {
+    uint32_t channel;   // hardware channel
+};
+
 extern int (*zjs_pwm_convert_pin)(int num);
 
 jerry_object_t *zjs_pwm_init();
 
+bool zjs_pwm_get_output(jerry_object_t *pin_obj, struct zjs_pwm_output *out);
+
+bool zjs_pwm_output_claim(const struct zjs_pwm_output *out);
+
+void zjs_pwm_output_release(const struct zjs_pwm_output *out);
+
+void zjs_pwm_output_set(const struct zjs_pwm_output *out, uint32_t duty);
+
 bool zjs_pwm_open(const jerry_object_t *function_obj_p,
                   const jerry_value_t this_val,
                   const jerry_value_t args_p[],
                   const jerry_length_t args_cnt,
                   jerry_value_t *ret_val_p);
 
+bool zjs_pwm_set_channels(const jerry_object_t *function_obj_p,
+                          const jerry_value_t this_val,
+                          const jerry_value_t args_p[],
+                          const jerry_length_t args_cnt,
+                          jerry_value_t *ret_val_p);
+
+bool zjs_pwm_open_servo(const jerry_object_t *function_obj_p,
+                        const jerry_value_t this_val,
+                        const jerry_value_t args_p[],
+                        const jerry_length_t args_cnt,
+                        jerry_value_t *ret_val_p);
+
 bool zjs_pwm_pin_set_period(const jerry_object_t *function_obj_p,
                             const jerry_value_t this_val,
                             const jerry_value_t args_p[],
@@ -35,3 +68,39 @@ bool zjs_pwm_pin_set_pulse_width_cycles(const jerry_object_t *function_obj_p,
                                         const jerry_value_t args_p[],
                                         const jerry_length_t args_cnt,
                                         jerry_value_t *ret_val_p);
+
+bool zjs_pwm_pin_set_duty_cycle(const jerry_object_t *function_obj_p,
+                                const jerry_value_t this_val,
+                                const jerry_value_t args_p[],
+                                const jerry_length_t args_cnt,
+                                jerry_value_t *ret_val_p);
+
+bool zjs_pwm_pin_fade(const jerry_object_t *function_obj_p,
+                      const jerry_value_t this_val,
+                      const jerry_value_t args_p[],
+                      const jerry_length_t args_cnt,
+                      jerry_value_t *ret_val_p);
+
+bool zjs_pwm_pin_stop_fade(const jerry_object_t *function_obj_p,
+                           const jerry_value_t this_val,
+                           const jerry_value_t args_p[],
+                           const jerry_length_t args_cnt,
+                           jerry_value_t *ret_val_p);
+
+bool zjs_pwm_pin_on(const jerry_object_t *function_obj_p,
+                    const jerry_value_t this_val,
+                    const jerry_value_t args_p[],
+                    const jerry_length_t args_cnt,
+                    jerry_value_t *ret_val_p);
+
+bool zjs_pwm_servo_write(const jerry_object_t *function_obj_p,
+                         const jerry_value_t this_val,
+                         const jerry_value_t args_p[],
+                         const jerry_length_t args_cnt,
+                         jerry_value_t *ret_val_p);
+
+bool zjs_pwm_servo_write_us(const jerry_object_t *function_obj_p,
+                            const jerry_value_t this_val,
+                            const jerry_value_t args_p[],
+                            const jerry_length_t args_cnt,
+                            jerry_value_t *ret_val_p);
@@ -152,11 +152,17 @@ bool zjs_obj_get_double(jerry_object_t *obj, const char *name,
                         double *num)
 {
     // requires: obj is an existing JS object, value name should exist as number
-    //  effects: retrieves field specified by name as a uint32
+    //  effects: retrieves field specified by name as a double; returns false
+    //             and leaves *num alone if it is missing or not a number
     jerry_value_t value = jerry_get_object_field_value(obj, name);
     if (jerry_value_is_error(value))
         return false;
 
+    if (!jerry_value_is_number(value)) {
+        jerry_release_value(value);
+        return false;
+    }
+
     *num = jerry_get_number_value(value);
     jerry_release_value(value);
     return true;
@@ -166,11 +172,17 @@ bool zjs_obj_get_uint32(jerry_object_t *obj, const char *name,
                         uint32_t *num)
 {
     // requires: obj is an existing JS object, value name should exist as number
-    //  effects: retrieves field specified by name as a uint32
+    //  effects: retrieves field specified by name as a uint32; returns false
+    //             and leaves *num alone if it is missing or not a number
     jerry_value_t value = jerry_get_object_field_value(obj, name);
     if (jerry_value_is_error(value))
         return false;
 
+    if (!jerry_value_is_number(value)) {
+        jerry_release_value(value);
+        return false;
+    }
+
     *num = (uint32_t)jerry_get_number_value(value);
     jerry_release_value(value);
     return true;
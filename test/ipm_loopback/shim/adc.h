@@ -0,0 +1,41 @@
+// Copyright (c) 2016, Intel Corporation.
+
+#ifndef __shim_adc_h__
+#define __shim_adc_h__
+
+#include <stdint.h>
+
+#include <device.h>
+
+struct adc_seq_entry {
+    int32_t sampling_delay;
+    uint8_t *buffer;
+    uint32_t buffer_length;
+    uint8_t channel_id;
+};
+
+struct adc_seq_table {
+    struct adc_seq_entry *entries;
+    uint8_t num_entries;
+};
+
+void adc_enable(struct device *dev);
+void adc_disable(struct device *dev);
+
+// fills each entry's buffer with 32-bit samples from the simulated source,
+//   taking as long as the sequencer would
+int adc_read(struct device *dev, struct adc_seq_table *seq_table);
+
+// each conversion of channel returns base + step * n, masked to 12 bits,
+//   where n counts that channel's conversions
+void shim_adc_set(uint8_t channel, uint32_t base, uint32_t step);
+
+// returns n, the count of channel's ramp conversions so far
+uint32_t shim_adc_conversions(uint8_t channel);
+
+// each conversion of channel returns source(channel) instead, or the ramp
+//   again if source is NULL
+typedef uint32_t (*shim_adc_source_t)(uint8_t channel);
+void shim_adc_set_source(uint8_t channel, shim_adc_source_t source);
+
+#endif
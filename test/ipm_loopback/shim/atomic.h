@@ -0,0 +1,30 @@
+// Copyright (c) 2016, Intel Corporation.
+
+#ifndef __shim_atomic_h__
+#define __shim_atomic_h__
+
+typedef int atomic_t;
+typedef int atomic_val_t;
+
+// returns the previous value, like Zephyr's
+static inline atomic_val_t atomic_set(atomic_t *target, atomic_val_t value)
+{
+    return __atomic_exchange_n(target, value, __ATOMIC_SEQ_CST);
+}
+
+static inline atomic_val_t atomic_clear(atomic_t *target)
+{
+    return atomic_set(target, 0);
+}
+
+static inline atomic_val_t atomic_inc(atomic_t *target)
+{
+    return __atomic_fetch_add(target, 1, __ATOMIC_SEQ_CST);
+}
+
+static inline atomic_val_t atomic_get(const atomic_t *target)
+{
+    return __atomic_load_n(target, __ATOMIC_SEQ_CST);
+}
+
+#endif
@@ -0,0 +1,20 @@
+// Copyright (c) 2016, Intel Corporation.
+
+#ifndef __shim_counter_h__
+#define __shim_counter_h__
+
+#include <stdint.h>
+
+#include <device.h>
+
+typedef void (*counter_callback_t)(struct device *dev, void *user_data);
+
+// the x86 always-on periodic timer, "AON_TIMER": it counts at 32768Hz, and
+//   once an alarm is set calls the callback as the x86 ISR every count
+//   ticks, until the alarm is set again or the timer is stopped
+int counter_start(struct device *dev);
+int counter_stop(struct device *dev);
+int counter_set_alarm(struct device *dev, counter_callback_t callback,
+                      uint32_t count, void *user_data);
+
+#endif
@@ -0,0 +1,15 @@
+// Copyright (c) 2016, Intel Corporation.
+
+#ifndef __shim_device_h__
+#define __shim_device_h__
+
+struct device {
+    const char *name;
+    int core;
+    void *driver_data;
+};
+
+// returns the calling core's device of that name
+struct device *device_get_binding(const char *name);
+
+#endif
@@ -0,0 +1,57 @@
+// Copyright (c) 2016, Intel Corporation.
+
+#ifndef __shim_gpio_h__
+#define __shim_gpio_h__
+
+#include <stdint.h>
+
+#include <device.h>
+
+#define GPIO_DIR_IN             (0 << 0)
+#define GPIO_DIR_OUT            (1 << 0)
+#define GPIO_INT                (1 << 1)
+#define GPIO_INT_ACTIVE_LOW     (0 << 2)
+#define GPIO_INT_ACTIVE_HIGH    (1 << 2)
+#define GPIO_INT_EDGE           (1 << 5)
+#define GPIO_INT_DOUBLE_EDGE    (1 << 6)
+#define GPIO_POL_NORMAL         (0 << 7)
+#define GPIO_POL_INV            (1 << 7)
+#define GPIO_PUD_NORMAL         (0 << 8)
+#define GPIO_PUD_PULL_UP        (1 << 8)
+#define GPIO_PUD_PULL_DOWN      (2 << 8)
+
+struct gpio_callback;
+typedef void (*gpio_callback_handler_t)(struct device *port,
+                                        struct gpio_callback *cb,
+                                        uint32_t pins);
+
+struct gpio_callback {
+    struct gpio_callback *next;
+    gpio_callback_handler_t handler;
+    uint32_t pin_mask;
+};
+
+void gpio_init_callback(struct gpio_callback *callback,
+                        gpio_callback_handler_t handler, uint32_t pin_mask);
+int gpio_add_callback(struct device *port, struct gpio_callback *callback);
+int gpio_remove_callback(struct device *port, struct gpio_callback *callback);
+int gpio_pin_enable_callback(struct device *port, uint32_t pin);
+int gpio_pin_disable_callback(struct device *port, uint32_t pin);
+
+// the port is 32 pins; polarity flags are recorded but, like the QMSI
+//   driver's, don't change the values read or written
+int gpio_pin_configure(struct device *port, uint32_t pin, int flags);
+int gpio_pin_read(struct device *port, uint32_t pin, uint32_t *value);
+int gpio_pin_write(struct device *port, uint32_t pin, uint32_t value);
+int gpio_port_read(struct device *port, uint32_t *value);
+int gpio_port_write(struct device *port, uint32_t value);
+
+// drives pin to value from outside, and if that is an edge the pin is
+//   configured to interrupt on, runs the callbacks as the x86 GPIO ISR
+void shim_gpio_set(uint32_t pin, uint32_t value);
+
+// returns the port's current levels, and in writes, if given, how many
+//   times pin has been written
+uint32_t shim_gpio_port(uint32_t pin, uint32_t *writes);
+
+#endif
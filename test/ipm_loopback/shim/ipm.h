@@ -0,0 +1,20 @@
+// Copyright (c) 2016, Intel Corporation.
+
+#ifndef __shim_ipm_h__
+#define __shim_ipm_h__
+
+#include <stdint.h>
+
+#include <device.h>
+
+typedef void (*ipm_callback_t)(void *context, uint32_t id,
+                               volatile void *data);
+
+// delivers the message straight to the other core's callback, as its ISR
+int ipm_send(struct device *ipmdev, int wait, uint32_t id, const void *data,
+             int size);
+void ipm_register_callback(struct device *ipmdev, ipm_callback_t cb,
+                           void *context);
+int ipm_set_enabled(struct device *ipmdev, int enable);
+
+#endif
@@ -0,0 +1,9 @@
+// Copyright (c) 2016, Intel Corporation.
+
+#include <ipm.h>
+
+// the shim creates both cores' mailbox devices itself
+#define QUARK_SE_IPM_OUTBOUND   1
+#define QUARK_SE_IPM_INBOUND    0
+#define QUARK_SE_IPM_DEFINE(name, channel, direction) \
+    extern int shim_ipm_unused_##name
@@ -0,0 +1,90 @@
+// Copyright (c) 2016, Intel Corporation.
+
+// Just enough of the JerryScript API for the x86 AIO code to run on a host
+//   without the engine: objects are property lists, functions are native
+//   handlers, and nothing is ever garbage collected
+
+#ifndef __shim_jerry_api_h__
+#define __shim_jerry_api_h__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef uint8_t jerry_char_t;
+typedef uint32_t jerry_size_t;
+typedef uint16_t jerry_length_t;
+
+typedef struct jerry_object jerry_object_t;
+typedef struct jerry_string jerry_string_t;
+typedef struct jerry_value *jerry_value_t;
+
+typedef bool (*jerry_external_handler_t)(const jerry_object_t *function_obj_p,
+                                         const jerry_value_t this_val,
+                                         const jerry_value_t args_p[],
+                                         const jerry_length_t args_cnt,
+                                         jerry_value_t *ret_val_p);
+
+typedef void (*jerry_object_free_callback_t)(uintptr_t native_p);
+
+jerry_object_t *jerry_create_object(void);
+jerry_object_t *jerry_create_external_function(jerry_external_handler_t h);
+jerry_object_t *jerry_get_global(void);
+
+// arrays are fixed-length objects created with every element undefined
+jerry_object_t *jerry_create_array_object(jerry_size_t size);
+bool jerry_is_array(const jerry_object_t *obj);
+uint32_t jerry_get_array_length(const jerry_object_t *obj);
+bool jerry_get_array_index_value(jerry_object_t *obj, uint32_t index,
+                                 jerry_value_t *value);
+bool jerry_set_array_index_value(jerry_object_t *obj, uint32_t index,
+                                 jerry_value_t value);
+jerry_object_t *jerry_acquire_object(jerry_object_t *obj);
+void jerry_release_object(jerry_object_t *obj);
+
+jerry_string_t *jerry_create_string(const jerry_char_t *str);
+jerry_size_t jerry_get_string_size(const jerry_string_t *str);
+jerry_size_t jerry_string_to_char_buffer(const jerry_string_t *str,
+                                         jerry_char_t *buffer,
+                                         jerry_size_t size);
+
+jerry_value_t jerry_create_boolean_value(bool value);
+jerry_value_t jerry_create_number_value(double value);
+jerry_value_t jerry_create_null_value(void);
+jerry_value_t jerry_create_undefined_value(void);
+jerry_value_t jerry_create_object_value(jerry_object_t *obj);
+jerry_value_t jerry_create_string_value(jerry_string_t *str);
+void jerry_release_value(jerry_value_t value);
+
+bool jerry_value_is_boolean(const jerry_value_t value);
+bool jerry_value_is_number(const jerry_value_t value);
+bool jerry_value_is_null(const jerry_value_t value);
+bool jerry_value_is_undefined(const jerry_value_t value);
+bool jerry_value_is_string(const jerry_value_t value);
+bool jerry_value_is_object(const jerry_value_t value);
+bool jerry_value_is_function(const jerry_value_t value);
+bool jerry_is_function(const jerry_object_t *obj);
+bool jerry_value_is_error(const jerry_value_t value);
+
+bool jerry_get_boolean_value(const jerry_value_t value);
+double jerry_get_number_value(const jerry_value_t value);
+jerry_string_t *jerry_get_string_value(const jerry_value_t value);
+jerry_object_t *jerry_get_object_value(const jerry_value_t value);
+
+jerry_value_t jerry_get_object_field_value(jerry_object_t *obj,
+                                           const jerry_char_t *name);
+bool jerry_set_object_field_value(jerry_object_t *obj,
+                                  const jerry_char_t *name,
+                                  const jerry_value_t value);
+void jerry_set_object_native_handle(jerry_object_t *obj, uintptr_t handle,
+                                    jerry_object_free_callback_t cb);
+bool jerry_get_object_native_handle(jerry_object_t *obj, uintptr_t *handle);
+
+jerry_value_t jerry_call_function(jerry_object_t *func, jerry_object_t *this_p,
+                                  const jerry_value_t args[],
+                                  jerry_length_t args_count);
+
+// runs obj's native free callback the way the GC would when collecting it;
+//   the object itself is left alone, since nothing is freed
+void jerry_fake_collect(jerry_object_t *obj);
+
+#endif
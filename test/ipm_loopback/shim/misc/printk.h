@@ -0,0 +1,5 @@
+// Copyright (c) 2016, Intel Corporation.
+
+#include <stdio.h>
+
+#define printk printf
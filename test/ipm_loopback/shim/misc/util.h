@@ -0,0 +1,13 @@
+// Copyright (c) 2016, Intel Corporation.
+
+#ifndef __shim_util_h__
+#define __shim_util_h__
+
+#include <stddef.h>
+
+#define BIT(n)  (1UL << (n))
+
+#define CONTAINER_OF(ptr, type, field) \
+    ((type *)(((char *)(ptr)) - offsetof(type, field)))
+
+#endif
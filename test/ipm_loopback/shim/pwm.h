@@ -0,0 +1,21 @@
+// Copyright (c) 2016, Intel Corporation.
+
+#ifndef __shim_pwm_h__
+#define __shim_pwm_h__
+
+#include <stdint.h>
+
+#include <device.h>
+
+// records the channel's on and off times for shim_pwm_duty
+int pwm_pin_set_values(struct device *dev, uint32_t pwm, uint32_t on,
+                       uint32_t off);
+
+// returns the fraction of its period the channel was last set on for, and
+//   in writes, if given, how many times it has been set
+double shim_pwm_duty(uint32_t pwm, uint32_t *writes);
+
+// returns the host time in ns the channel was last set
+uint64_t shim_pwm_written_ns(uint32_t pwm);
+
+#endif
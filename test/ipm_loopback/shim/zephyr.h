@@ -0,0 +1,83 @@
+// Copyright (c) 2016, Intel Corporation.
+
+// Host stand-in for the parts of the Zephyr 1.x nanokernel API that the AIO
+//   code on both cores uses, implemented with pthreads in shim.c
+
+#ifndef __shim_zephyr_h__
+#define __shim_zephyr_h__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#define TICKS_NONE          0
+#define TICKS_UNLIMITED     (-1)
+
+#define unlikely(x)         __builtin_expect(!!(x), 0)
+#define __stack             __attribute__((aligned(4)))
+
+// the Quark SE ARC core's clock; x86 uses the same numbers here
+#define sys_clock_ticks_per_sec         100
+#define CONFIG_SYS_CLOCK_TICKS_PER_SEC  sys_clock_ticks_per_sec
+#define sys_clock_hw_cycles_per_sec     32000000
+#define sys_clock_hw_cycles_per_tick \
+    (sys_clock_hw_cycles_per_sec / sys_clock_ticks_per_sec)
+
+uint32_t sys_cycle_get_32(void);
+uint32_t sys_tick_get_32(void);
+
+// irq_lock only holds off the calling core's simulated interrupts
+int irq_lock(void);
+void irq_unlock(int key);
+
+void *task_malloc(uint32_t size);
+void task_free(void *ptr);
+void task_sleep(int32_t ticks);
+void fiber_sleep(int32_t ticks);
+
+// a fiber is a thread running as the core that started it; priority and
+//   options are ignored, and the stack is only for show
+typedef void (*nano_fiber_entry_t)(int arg1, int arg2);
+
+void task_fiber_start(char *stack, unsigned stack_size,
+                      nano_fiber_entry_t entry, int arg1, int arg2,
+                      unsigned priority, unsigned options);
+#define fiber_start task_fiber_start
+
+struct nano_sem {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    int count;
+};
+
+void nano_sem_init(struct nano_sem *sem);
+void nano_isr_sem_give(struct nano_sem *sem);
+void nano_task_sem_give(struct nano_sem *sem);
+void nano_fiber_sem_give(struct nano_sem *sem);
+int nano_task_sem_take(struct nano_sem *sem, int32_t timeout_in_ticks);
+int nano_fiber_sem_take(struct nano_sem *sem, int32_t timeout_in_ticks);
+
+// items must start with a pointer-sized field the fifo can use as a link
+struct nano_fifo {
+    pthread_mutex_t lock;
+    void *head;
+    void *tail;
+};
+
+void nano_fifo_init(struct nano_fifo *fifo);
+void nano_fifo_put(struct nano_fifo *fifo, void *data);
+void *nano_task_fifo_get(struct nano_fifo *fifo, int32_t timeout_in_ticks);
+
+struct nano_timer {
+    uint64_t expiry_ns;
+    void *user_data;
+};
+
+void nano_timer_init(struct nano_timer *timer, void *data);
+void nano_task_timer_start(struct nano_timer *timer, int ticks);
+void *nano_task_timer_test(struct nano_timer *timer, int32_t timeout_in_ticks);
+
+#endif
@@ -0,0 +1,317 @@
+// Copyright (c) 2016, Intel Corporation.
+
+// Host stand-in for the JerryScript engine, see shim/jerry-api.h
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "jerry-api.h"
+
+enum jerry_fake_type {
+    FAKE_UNDEFINED,
+    FAKE_NULL,
+    FAKE_BOOLEAN,
+    FAKE_NUMBER,
+    FAKE_STRING,
+    FAKE_OBJECT,
+};
+
+struct jerry_value {
+    enum jerry_fake_type type;
+    bool boolean;
+    double number;
+    jerry_string_t *string;
+    jerry_object_t *object;
+};
+
+struct jerry_string {
+    char *chars;
+};
+
+struct jerry_property {
+    char *name;
+    jerry_value_t value;
+    struct jerry_property *next;
+};
+
+struct jerry_object {
+    struct jerry_property *properties;
+    jerry_external_handler_t handler;
+    uintptr_t native_handle;
+    jerry_object_free_callback_t free_cb;
+    bool has_native_handle;
+    bool is_array;
+    uint32_t length;
+    jerry_value_t *elements;
+};
+
+static jerry_value_t fake_value(enum jerry_fake_type type)
+{
+    jerry_value_t value = calloc(1, sizeof(struct jerry_value));
+    value->type = type;
+    return value;
+}
+
+jerry_object_t *jerry_create_object(void)
+{
+    return calloc(1, sizeof(struct jerry_object));
+}
+
+jerry_object_t *jerry_create_external_function(jerry_external_handler_t h)
+{
+    jerry_object_t *obj = jerry_create_object();
+    obj->handler = h;
+    return obj;
+}
+
+jerry_object_t *jerry_create_array_object(jerry_size_t size)
+{
+    jerry_object_t *obj = jerry_create_object();
+    obj->is_array = true;
+    obj->length = size;
+    obj->elements = calloc(size ? size : 1, sizeof(jerry_value_t));
+    for (uint32_t i = 0; i < size; i++)
+        obj->elements[i] = jerry_create_undefined_value();
+    return obj;
+}
+
+bool jerry_is_array(const jerry_object_t *obj)
+{
+    return obj->is_array;
+}
+
+uint32_t jerry_get_array_length(const jerry_object_t *obj)
+{
+    return obj->length;
+}
+
+bool jerry_get_array_index_value(jerry_object_t *obj, uint32_t index,
+                                 jerry_value_t *value)
+{
+    if (!obj->is_array || index >= obj->length)
+        return false;
+    *value = obj->elements[index];
+    return true;
+}
+
+bool jerry_set_array_index_value(jerry_object_t *obj, uint32_t index,
+                                 jerry_value_t value)
+{
+    if (!obj->is_array || index >= obj->length)
+        return false;
+    obj->elements[index] = value;
+    return true;
+}
+
+jerry_object_t *jerry_get_global(void)
+{
+    static jerry_object_t *global = NULL;
+    if (!global)
+        global = jerry_create_object();
+    return global;
+}
+
+jerry_object_t *jerry_acquire_object(jerry_object_t *obj)
+{
+    return obj;
+}
+
+void jerry_release_object(jerry_object_t *obj)
+{
+}
+
+jerry_string_t *jerry_create_string(const jerry_char_t *str)
+{
+    jerry_string_t *jstr = malloc(sizeof(struct jerry_string));
+    jstr->chars = strdup((const char *)str);
+    return jstr;
+}
+
+jerry_size_t jerry_get_string_size(const jerry_string_t *str)
+{
+    return strlen(str->chars);
+}
+
+jerry_size_t jerry_string_to_char_buffer(const jerry_string_t *str,
+                                         jerry_char_t *buffer,
+                                         jerry_size_t size)
+{
+    jerry_size_t len = strlen(str->chars);
+    if (len > size)
+        return 0;
+    memcpy(buffer, str->chars, len);
+    return len;
+}
+
+jerry_value_t jerry_create_boolean_value(bool boolean)
+{
+    jerry_value_t value = fake_value(FAKE_BOOLEAN);
+    value->boolean = boolean;
+    return value;
+}
+
+jerry_value_t jerry_create_number_value(double number)
+{
+    jerry_value_t value = fake_value(FAKE_NUMBER);
+    value->number = number;
+    return value;
+}
+
+jerry_value_t jerry_create_null_value(void)
+{
+    return fake_value(FAKE_NULL);
+}
+
+jerry_value_t jerry_create_undefined_value(void)
+{
+    return fake_value(FAKE_UNDEFINED);
+}
+
+jerry_value_t jerry_create_object_value(jerry_object_t *obj)
+{
+    jerry_value_t value = fake_value(FAKE_OBJECT);
+    value->object = obj;
+    return value;
+}
+
+jerry_value_t jerry_create_string_value(jerry_string_t *str)
+{
+    jerry_value_t value = fake_value(FAKE_STRING);
+    value->string = str;
+    return value;
+}
+
+void jerry_release_value(jerry_value_t value)
+{
+    // values may still be referenced from properties, so they're kept
+}
+
+bool jerry_value_is_boolean(const jerry_value_t value)
+{
+    return value->type == FAKE_BOOLEAN;
+}
+
+bool jerry_value_is_number(const jerry_value_t value)
+{
+    return value->type == FAKE_NUMBER;
+}
+
+bool jerry_value_is_null(const jerry_value_t value)
+{
+    return value->type == FAKE_NULL;
+}
+
+bool jerry_value_is_undefined(const jerry_value_t value)
+{
+    return value->type == FAKE_UNDEFINED;
+}
+
+bool jerry_value_is_string(const jerry_value_t value)
+{
+    return value->type == FAKE_STRING;
+}
+
+bool jerry_value_is_object(const jerry_value_t value)
+{
+    return value->type == FAKE_OBJECT;
+}
+
+bool jerry_value_is_function(const jerry_value_t value)
+{
+    return value->type == FAKE_OBJECT && value->object->handler;
+}
+
+bool jerry_is_function(const jerry_object_t *obj)
+{
+    return obj->handler;
+}
+
+bool jerry_value_is_error(const jerry_value_t value)
+{
+    // handlers that fail return false rather than an error value
+    return false;
+}
+
+bool jerry_get_boolean_value(const jerry_value_t value)
+{
+    return value->boolean;
+}
+
+double jerry_get_number_value(const jerry_value_t value)
+{
+    return value->number;
+}
+
+jerry_string_t *jerry_get_string_value(const jerry_value_t value)
+{
+    return value->string;
+}
+
+jerry_object_t *jerry_get_object_value(const jerry_value_t value)
+{
+    return value->type == FAKE_OBJECT ? value->object : NULL;
+}
+
+jerry_value_t jerry_get_object_field_value(jerry_object_t *obj,
+                                           const jerry_char_t *name)
+{
+    for (struct jerry_property *p = obj->properties; p; p = p->next) {
+        if (!strcmp(p->name, (const char *)name))
+            return p->value;
+    }
+    return jerry_create_undefined_value();
+}
+
+bool jerry_set_object_field_value(jerry_object_t *obj,
+                                  const jerry_char_t *name,
+                                  const jerry_value_t value)
+{
+    for (struct jerry_property *p = obj->properties; p; p = p->next) {
+        if (!strcmp(p->name, (const char *)name)) {
+            p->value = value;
+            return true;
+        }
+    }
+
+    struct jerry_property *p = malloc(sizeof(struct jerry_property));
+    p->name = strdup((const char *)name);
+    p->value = value;
+    p->next = obj->properties;
+    obj->properties = p;
+    return true;
+}
+
+void jerry_set_object_native_handle(jerry_object_t *obj, uintptr_t handle,
+                                    jerry_object_free_callback_t cb)
+{
+    obj->native_handle = handle;
+    obj->free_cb = cb;
+    obj->has_native_handle = true;
+}
+
+bool jerry_get_object_native_handle(jerry_object_t *obj, uintptr_t *handle)
+{
+    if (!obj->has_native_handle)
+        return false;
+    *handle = obj->native_handle;
+    return true;
+}
+
+void jerry_fake_collect(jerry_object_t *obj)
+{
+    if (obj->has_native_handle && obj->free_cb)
+        obj->free_cb(obj->native_handle);
+    obj->has_native_handle = false;
+}
+
+jerry_value_t jerry_call_function(jerry_object_t *func, jerry_object_t *this_p,
+                                  const jerry_value_t args[],
+                                  jerry_length_t args_count)
+{
+    jerry_value_t ret = jerry_create_undefined_value();
+    jerry_value_t this_val = this_p ? jerry_create_object_value(this_p) :
+                                      jerry_create_undefined_value();
+    if (func && func->handler)
+        func->handler(func, this_val, args, args_count, &ret);
+    return ret;
+}
@@ -0,0 +1,1759 @@
+// Copyright (c) 2016, Intel Corporation.
+
+// Runs the ARC AIO service from arc/src/main.c and the x86 AIO module from
+//   src/zjs_aio.c together on a Linux host, linked by the shim mailbox, and
+//   checks and times the protocol between them
+
+#include <errno.h>
+#include <math.h>
+#include <stdio.h>
+#include <time.h>
+
+#include <zephyr.h>
+#include <adc.h>
+#include <gpio.h>
+#include <pwm.h>
+
+#include "jerry-api.h"
+#include "zjs_aio.h"
+#include "zjs_buffer.h"
+#include "zjs_gpio.h"
+#include "zjs_ipm.h"
+#include "zjs_pipe.h"
+#include "zjs_pwm.h"
+#include "zjs_util.h"
+
+#include "shim.h"
+
+// the ARC image's entry point, renamed by the Makefile
+void arc_main(void);
+
+// from the ARC image's zjs_ipm.c, whose header only declares it for ARC
+uint32_t zjs_ipm_credits();
+
+static int failures = 0;
+
+#define CHECK(cond, ...) \
+    do { \
+        if (!(cond)) { \
+            printf("FAIL: " __VA_ARGS__); \
+            printf("\n"); \
+            failures++; \
+        } \
+    } while (0)
+
+static uint64_t now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static void *arc_thread(void *arg)
+{
+    shim_core = SHIM_CORE_ARC;
+    arc_main();
+    return NULL;
+}
+
+static jerry_object_t *get_object(jerry_object_t *obj, const char *name)
+{
+    return jerry_get_object_value(
+        jerry_get_object_field_value(obj, (const jerry_char_t *)name));
+}
+
+static double get_number(jerry_object_t *obj, const char *name)
+{
+    return jerry_get_number_value(
+        jerry_get_object_field_value(obj, (const jerry_char_t *)name));
+}
+
+static jerry_value_t call(jerry_object_t *obj, const char *method, int argc,
+                          jerry_value_t *argv)
+{
+    // calls obj.method(argv...) the way a script would
+    return jerry_call_function(get_object(obj, method), obj, argv, argc);
+}
+
+static jerry_object_t *open_pin(jerry_object_t *aio, int pin,
+                                uint32_t oversample)
+{
+    jerry_object_t *options = jerry_create_object();
+    zjs_obj_add_number(options, 0, "device");
+    zjs_obj_add_number(options, pin, "pin");
+    if (oversample)
+        zjs_obj_add_number(options, oversample, "oversample");
+    jerry_value_t arg = jerry_create_object_value(options);
+    return jerry_get_object_value(call(aio, "open", 1, &arg));
+}
+
+static void run_callbacks_for(uint32_t ms)
+{
+    // runs the x86 main loop's callback step until ms have passed
+    uint64_t end = now_us() + ms * 1000;
+    while (now_us() < end) {
+        zjs_run_pending_callbacks();
+        task_sleep(0);
+        struct timespec ts = { 0, 200000 };
+        nanosleep(&ts, NULL);
+    }
+    zjs_run_pending_callbacks();
+}
+
+// values passed to the async read callbacks, by pin - 10
+static double async_values[6];
+static int async_count = 0;
+
+#define ASYNC_HANDLER(n) \
+    static bool async_read_##n(const jerry_object_t *function_obj_p, \
+                               const jerry_value_t this_val, \
+                               const jerry_value_t args_p[], \
+                               const jerry_length_t args_cnt, \
+                               jerry_value_t *ret_val_p) \
+    { \
+        async_values[n] = jerry_get_number_value(args_p[0]); \
+        async_count++; \
+        return true; \
+    }
+
+ASYNC_HANDLER(0)
+ASYNC_HANDLER(1)
+ASYNC_HANDLER(2)
+ASYNC_HANDLER(3)
+ASYNC_HANDLER(4)
+ASYNC_HANDLER(5)
+
+static jerry_external_handler_t async_handlers[6] = {
+    async_read_0, async_read_1, async_read_2,
+    async_read_3, async_read_4, async_read_5,
+};
+
+static int change_count = 0;
+static double change_last = -1;
+static int change_decreases = 0;
+
+static bool on_change(const jerry_object_t *function_obj_p,
+                      const jerry_value_t this_val,
+                      const jerry_value_t args_p[],
+                      const jerry_length_t args_cnt,
+                      jerry_value_t *ret_val_p)
+{
+    double value = jerry_get_number_value(args_p[0]);
+    if (value < change_last)
+        change_decreases++;
+    change_last = value;
+    change_count++;
+    return true;
+}
+
+static int stats_events = 0;
+static int stats_bad = 0;
+
+static bool on_stats(const jerry_object_t *function_obj_p,
+                     const jerry_value_t this_val,
+                     const jerry_value_t args_p[],
+                     const jerry_length_t args_cnt,
+                     jerry_value_t *ret_val_p)
+{
+    // a boxcar no longer than the decimation window averages samples from
+    //   that window only, so its output and RMS lie within the window's range
+    jerry_object_t *stats = jerry_get_object_value(args_p[0]);
+    double value = get_number(stats, "value");
+    double min = get_number(stats, "min");
+    double max = get_number(stats, "max");
+    double rms = get_number(stats, "rms");
+    if (value < min || value > max || rms < min || rms > max ||
+        get_number(stats, "count") < 1)
+        stats_bad++;
+    stats_events++;
+    return true;
+}
+
+static int stream_blocks = 0;
+static int stream_bad_samples = 0;
+static int stream_bad_sequence = 0;
+static uint32_t stream_samples = 0;
+static double stream_last_sequence = -1;
+static double stream_overruns = 0;
+static double stream_dropped = 0;
+// ARC hw cycle counts the first and latest blocks started at, and the
+//   samples taken between them; blocks are all one size
+static uint32_t stream_first_start = 0;
+static uint32_t stream_last_start = 0;
+static uint32_t stream_timed_samples = 0;
+
+static bool on_block(const jerry_object_t *function_obj_p,
+                     const jerry_value_t this_val,
+                     const jerry_value_t args_p[],
+                     const jerry_length_t args_cnt,
+                     jerry_value_t *ret_val_p)
+{
+    struct zjs_buffer_t *buf;
+    buf = zjs_buffer_find(jerry_get_object_value(args_p[0]));
+    jerry_object_t *info = jerry_get_object_value(args_p[1]);
+
+    // the simulated source ramps by one per conversion
+    for (int i = 1; buf && i < buf->bufsize / 2; i++) {
+        uint16_t prev = buf->buffer[2*i-2] | buf->buffer[2*i-1] << 8;
+        uint16_t cur = buf->buffer[2*i] | buf->buffer[2*i+1] << 8;
+        if (cur != ((prev + 1) & 0xfff))
+            stream_bad_samples++;
+    }
+
+    double sequence = get_number(info, "sequence");
+    if (sequence <= stream_last_sequence)
+        stream_bad_sequence++;
+    stream_last_sequence = sequence;
+    stream_overruns = get_number(info, "overruns");
+    stream_dropped = get_number(info, "dropped");
+    uint32_t start = get_number(info, "timestamp");
+    if (!stream_blocks) {
+        stream_first_start = start;
+    } else {
+        stream_timed_samples += buf ? buf->bufsize / 2 : 0;
+    }
+    stream_last_start = start;
+    stream_samples += buf ? buf->bufsize / 2 : 0;
+    stream_blocks++;
+    return true;
+}
+
+static void test_read(jerry_object_t *pin)
+{
+    shim_adc_set(10, 1234, 0);
+    run_callbacks_for(250);
+
+    jerry_value_t value = call(pin, "read", 0, NULL);
+    CHECK(jerry_value_is_number(value), "read() returned no value");
+    CHECK(jerry_get_number_value(value) == 1234,
+          "read() returned %g, expected 1234", jerry_get_number_value(value));
+
+    value = call(pin, "readCached", 0, NULL);
+    CHECK(jerry_value_is_number(value) &&
+          jerry_get_number_value(value) == 1234,
+          "readCached() didn't return the last read");
+
+    // read() takes a new reading rather than the last scan's
+    shim_adc_set(10, 2222, 0);
+    value = call(pin, "read", 0, NULL);
+    CHECK(jerry_get_number_value(value) == 2222,
+          "read() returned %g, not 2222, straight after it changed",
+          jerry_get_number_value(value));
+}
+
+static void test_async_reads(jerry_object_t *pins[6])
+{
+    // one read in flight on every channel at once
+    for (int i = 0; i < 6; i++) {
+        shim_adc_set(10 + i, 100 * (i + 1), 0);
+    }
+    run_callbacks_for(250);
+
+    for (int i = 0; i < 6; i++) {
+        jerry_value_t cb = jerry_create_object_value(
+            jerry_create_external_function(async_handlers[i]));
+        call(pins[i], "read_async", 1, &cb);
+    }
+    run_callbacks_for(100);
+
+    CHECK(async_count == 6, "%d of 6 async reads completed", async_count);
+    for (int i = 0; i < 6; i++) {
+        CHECK(async_values[i] == 100 * (i + 1),
+              "async read of pin %d returned %g", 10 + i, async_values[i]);
+    }
+
+    // and each takes a new reading, rather than the last scan's
+    async_count = 0;
+    for (int i = 0; i < 6; i++) {
+        shim_adc_set(10 + i, 50 * (i + 1), 0);
+        jerry_value_t cb = jerry_create_object_value(
+            jerry_create_external_function(async_handlers[i]));
+        call(pins[i], "read_async", 1, &cb);
+    }
+    run_callbacks_for(100);
+
+    CHECK(async_count == 6, "%d of 6 fresh async reads completed",
+          async_count);
+    for (int i = 0; i < 6; i++) {
+        CHECK(async_values[i] == 50 * (i + 1),
+              "async read of pin %d returned %g, not %d, straight after it "
+              "changed", 10 + i, async_values[i], 50 * (i + 1));
+    }
+}
+
+static void test_async_timeout(jerry_object_t *pin)
+{
+    // async reads whose requests never reach ARC give up after the sync
+    //   path's 500 ticks and free their slots for new reads
+    async_count = 0;
+    shim_ipm_lose(SHIM_CORE_ARC, 4);
+    for (int i = 0; i < 4; i++) {
+        jerry_value_t cb = jerry_create_object_value(
+            jerry_create_external_function(async_handlers[0]));
+        call(pin, "read_async", 1, &cb);
+    }
+    run_callbacks_for(5200);
+    CHECK(async_count == 0, "%d lost async reads called back", async_count);
+
+    shim_adc_set(10, 3210, 0);
+    run_callbacks_for(250);
+    jerry_value_t cb = jerry_create_object_value(
+        jerry_create_external_function(async_handlers[0]));
+    call(pin, "read_async", 1, &cb);
+    run_callbacks_for(100);
+    CHECK(async_count == 1 && async_values[0] == 3210,
+          "no async read after 4 timed out (%d, %g)", async_count,
+          async_values[0]);
+}
+
+static void test_change_events(jerry_object_t *pin)
+{
+    shim_adc_set(11, 0, 1);
+
+    jerry_value_t rate = jerry_create_number_value(50);
+    call(pin, "setSampleRate", 1, &rate);
+
+    jerry_value_t args[2];
+    args[0] = jerry_create_string_value(
+        jerry_create_string((const jerry_char_t *)"change"));
+    args[1] = jerry_create_object_value(
+        jerry_create_external_function(on_change));
+    call(pin, "on", 2, args);
+
+    run_callbacks_for(1000);
+
+    args[1] = jerry_create_null_value();
+    call(pin, "on", 2, args);
+
+    // 50 scans a second; allow for the scheduler's tick granularity
+    CHECK(change_count >= 25, "only %d change events in 1s at 50Hz",
+          change_count);
+    CHECK(!change_decreases, "%d change events went backwards on a ramp",
+          change_decreases);
+
+    jerry_object_t *jitter = jerry_get_object_value(
+        call(pin, "getJitter", 0, NULL));
+    CHECK(jitter, "getJitter() failed");
+    if (jitter) {
+        printf("scan jitter at 50Hz: max %gus, mean %gus\n",
+               get_number(jitter, "max"), get_number(jitter, "mean"));
+    }
+
+    rate = jerry_create_number_value(0);
+    call(pin, "setSampleRate", 1, &rate);
+}
+
+static void test_filter_changes(jerry_object_t *pin)
+{
+    // the filter chain should pick up new settings between samples, however
+    //   often they change while the pin is scanned
+    shim_adc_set(13, 0, 1);
+
+    jerry_value_t rate = jerry_create_number_value(100);
+    call(pin, "setSampleRate", 1, &rate);
+
+    jerry_value_t args[2];
+    args[0] = jerry_create_string_value(
+        jerry_create_string((const jerry_char_t *)"stats"));
+    args[1] = jerry_create_object_value(
+        jerry_create_external_function(on_stats));
+    call(pin, "on", 2, args);
+
+    for (int i = 0; i < 40; i++) {
+        jerry_object_t *options = jerry_create_object();
+        zjs_obj_add_string(options, "boxcar", "average");
+        zjs_obj_add_number(options, i % 2 ? 1 : 2, "window");
+        zjs_obj_add_number(options, i % 2 ? 1 : 2, "decimate");
+        zjs_obj_add_boolean(options, true, "stats");
+        jerry_value_t arg = jerry_create_object_value(options);
+        call(pin, "setFilter", 1, &arg);
+        run_callbacks_for(25);
+    }
+
+    jerry_object_t *options = jerry_create_object();
+    jerry_value_t arg = jerry_create_object_value(options);
+    call(pin, "setFilter", 1, &arg);
+    args[1] = jerry_create_null_value();
+    call(pin, "on", 2, args);
+    rate = jerry_create_number_value(0);
+    call(pin, "setSampleRate", 1, &rate);
+
+    CHECK(stats_events >= 20, "only %d stats events in 40 filter changes",
+          stats_events);
+    CHECK(!stats_bad, "%d of %d stats events outside their window's range",
+          stats_bad, stats_events);
+}
+
+static void test_stream(jerry_object_t *pin)
+{
+    shim_adc_set(12, 0, 1);
+
+    jerry_object_t *options = jerry_create_object();
+    zjs_obj_add_number(options, 1000, "rateHz");
+    zjs_obj_add_number(options, 64, "blockSize");
+
+    uint32_t sent_before = shim_ipm_messages[SHIM_CORE_ARC];
+    uint64_t start = now_us();
+
+    jerry_value_t args[2];
+    args[0] = jerry_create_object_value(options);
+    args[1] = jerry_create_object_value(
+        jerry_create_external_function(on_block));
+    call(pin, "stream", 2, args);
+    run_callbacks_for(1000);
+    call(pin, "stopStream", 0, NULL);
+
+    uint64_t elapsed = now_us() - start;
+    uint32_t doorbells = shim_ipm_messages[SHIM_CORE_ARC] - sent_before;
+
+    // blocks should follow one another with no gap however long each takes
+    //   to reach JS; the scans of the five other open pins still take about
+    //   4% of the ADC's time at its 31.25kHz clock
+    double rate = stream_timed_samples * (double)sys_clock_hw_cycles_per_sec /
+                  (uint32_t)(stream_last_start - stream_first_start);
+
+    CHECK(stream_blocks >= 10, "only %d stream blocks in 1s", stream_blocks);
+    CHECK(!stream_bad_samples, "%d stream samples out of order",
+          stream_bad_samples);
+    CHECK(!stream_bad_sequence, "%d stream blocks out of sequence",
+          stream_bad_sequence);
+    CHECK(rate > 930, "stream sampled at %.0f/s for 1kHz", rate);
+
+    printf("stream at 1kHz: %u samples in %llums, sampled at %.0f/s, "
+           "%d blocks, %g overruns, %g dropped, %u ARC mailbox interrupts\n",
+           stream_samples, (unsigned long long)elapsed / 1000, rate,
+           stream_blocks, stream_overruns, stream_dropped, doorbells);
+}
+
+static void test_stream_scans(jerry_object_t *stream_pin,
+                              jerry_object_t *pin)
+{
+    // a slow stream keeps the ADC busy for a long time per block, which
+    //   shouldn't hold up another pin's scans and change events
+    shim_adc_set(11, 0, 1);
+    shim_adc_set(12, 0, 1);
+    change_count = 0;
+    change_last = -1;
+    change_decreases = 0;
+    stream_blocks = 0;
+    stream_bad_samples = 0;
+    stream_last_sequence = -1;
+
+    jerry_value_t rate = jerry_create_number_value(50);
+    call(pin, "setSampleRate", 1, &rate);
+
+    jerry_value_t args[2];
+    args[0] = jerry_create_string_value(
+        jerry_create_string((const jerry_char_t *)"change"));
+    args[1] = jerry_create_object_value(
+        jerry_create_external_function(on_change));
+    call(pin, "on", 2, args);
+
+    jerry_object_t *options = jerry_create_object();
+    zjs_obj_add_number(options, 100, "rateHz");
+    zjs_obj_add_number(options, 64, "blockSize");
+    jerry_value_t stream_args[2];
+    stream_args[0] = jerry_create_object_value(options);
+    stream_args[1] = jerry_create_object_value(
+        jerry_create_external_function(on_block));
+    call(stream_pin, "stream", 2, stream_args);
+
+    run_callbacks_for(1000);
+
+    call(stream_pin, "stopStream", 0, NULL);
+    args[1] = jerry_create_null_value();
+    call(pin, "on", 2, args);
+
+    jerry_object_t *jitter = jerry_get_object_value(
+        call(pin, "getJitter", 0, NULL));
+    double max_late = jitter ? get_number(jitter, "max") : 0;
+
+    rate = jerry_create_number_value(0);
+    call(pin, "setSampleRate", 1, &rate);
+
+    // a scan waits at most for the stream's current run of one sample, on
+    //   top of the scheduler's tick granularity
+    CHECK(change_count >= 25, "only %d change events in 1s at 50Hz while "
+          "streaming", change_count);
+    CHECK(max_late < 25000, "scans up to %gus late while streaming",
+          max_late);
+    CHECK(stream_blocks >= 1 && !stream_bad_samples,
+          "%d blocks, %d samples out of order at 100Hz", stream_blocks,
+          stream_bad_samples);
+
+    printf("scans at 50Hz beside a 100Hz stream: %d change events in 1s, "
+           "max %gus late\n", change_count, max_late);
+}
+
+static void test_backpressure(jerry_object_t *pin)
+{
+    // a JS engine too busy to run callbacks should make ARC wait, and lose
+    //   samples there as overruns, rather than have x86 drop blocks
+    shim_adc_set(13, 0, 1);
+    stream_blocks = 0;
+    stream_bad_samples = 0;
+    stream_bad_sequence = 0;
+    stream_last_sequence = -1;
+    stream_dropped = 0;
+    stream_overruns = 0;
+
+    jerry_object_t *options = jerry_create_object();
+    zjs_obj_add_number(options, 2000, "rateHz");
+    zjs_obj_add_number(options, 16, "blockSize");
+
+    jerry_value_t args[2];
+    args[0] = jerry_create_object_value(options);
+    args[1] = jerry_create_object_value(
+        jerry_create_external_function(on_block));
+    call(pin, "stream", 2, args);
+
+    // stall, then catch up
+    struct timespec ts = { 0, 300000000 };
+    nanosleep(&ts, NULL);
+    run_callbacks_for(300);
+    call(pin, "stopStream", 0, NULL);
+    run_callbacks_for(100);
+
+    CHECK(stream_blocks >= 2, "only %d blocks with a stalled JS engine",
+          stream_blocks);
+    CHECK(!stream_dropped, "x86 dropped %g blocks instead of throttling ARC",
+          stream_dropped);
+    CHECK(stream_overruns > 0, "ARC didn't wait while JS was stalled");
+    CHECK(!stream_bad_samples, "%d stream samples out of order",
+          stream_bad_samples);
+    CHECK(!stream_bad_sequence, "%d stream blocks out of sequence",
+          stream_bad_sequence);
+    CHECK(zjs_ipm_credits() == ZJS_IPM_EVENT_CREDITS,
+          "%u of %d IPM credits back after the stream stopped",
+          zjs_ipm_credits(), ZJS_IPM_EVENT_CREDITS);
+
+    printf("stream stalled for 300ms: %d blocks, %g samples lost on ARC\n",
+           stream_blocks, stream_overruns);
+}
+
+static void test_close(jerry_object_t *pin)
+{
+    // closing a pin should stop ARC scanning it and sending its change
+    //   events and stream blocks
+    shim_adc_set(11, 0, 1);
+    change_count = 0;
+    stream_blocks = 0;
+    stream_last_sequence = -1;
+
+    jerry_value_t args[2];
+    args[0] = jerry_create_string_value(
+        jerry_create_string((const jerry_char_t *)"change"));
+    args[1] = jerry_create_object_value(
+        jerry_create_external_function(on_change));
+    call(pin, "on", 2, args);
+
+    jerry_object_t *options = jerry_create_object();
+    zjs_obj_add_number(options, 1000, "rateHz");
+    zjs_obj_add_number(options, 16, "blockSize");
+    args[0] = jerry_create_object_value(options);
+    args[1] = jerry_create_object_value(
+        jerry_create_external_function(on_block));
+    call(pin, "stream", 2, args);
+    run_callbacks_for(200);
+
+    CHECK(change_count && stream_blocks,
+          "%d change events and %d blocks before closing", change_count,
+          stream_blocks);
+
+    call(pin, "close", 0, NULL);
+    run_callbacks_for(50);
+    int changes = change_count;
+    int blocks = stream_blocks;
+    uint32_t conversions = shim_adc_conversions(11);
+    run_callbacks_for(300);
+
+    CHECK(change_count == changes, "%d change events after closing",
+          change_count - changes);
+    CHECK(stream_blocks == blocks, "%d stream blocks after closing",
+          stream_blocks - blocks);
+    CHECK(shim_adc_conversions(11) == conversions,
+          "ARC converted pin 11 %u times after closing",
+          shim_adc_conversions(11) - conversions);
+}
+
+// a first-order plant: the reading on its channel settles toward PWM 0's
+//   duty cycle times full scale with a 50ms time constant
+static double plant_value = 0;
+static uint64_t plant_time = 0;
+
+static uint32_t plant_source(uint8_t channel)
+{
+    uint64_t now = now_us();
+    if (plant_time) {
+        double target = shim_pwm_duty(0, NULL) * 4095;
+        plant_value += (target - plant_value) *
+                       (1 - exp(-(double)(now - plant_time) / 50000));
+    }
+    plant_time = now;
+    return plant_value + 0.5;
+}
+
+static int telemetry_count = 0;
+static int telemetry_bad_sequence = 0;
+static double telemetry_last_sequence = -1;
+static double telemetry_error = 0;
+static double telemetry_applied = 0;
+
+static bool on_telemetry(const jerry_object_t *function_obj_p,
+                         const jerry_value_t this_val,
+                         const jerry_value_t args_p[],
+                         const jerry_length_t args_cnt,
+                         jerry_value_t *ret_val_p)
+{
+    jerry_object_t *t = jerry_get_object_value(args_p[0]);
+    double sequence = get_number(t, "sequence");
+    if (sequence <= telemetry_last_sequence)
+        telemetry_bad_sequence++;
+    telemetry_last_sequence = sequence;
+    telemetry_error = get_number(t, "error");
+    telemetry_applied = get_number(t, "applied");
+    telemetry_count++;
+    return true;
+}
+
+static void test_pid(jerry_object_t *pin)
+{
+    // a loop from this pin to PWM 0 should hold the plant at its setpoint
+    //   and follow a setpoint change, with only telemetry reaching JS
+    shim_adc_set_source(14, plant_source);
+
+    jerry_object_t *pwm = zjs_pwm_init();
+    jerry_object_t *options = jerry_create_object();
+    zjs_obj_add_number(options, 0, "channel");
+    zjs_obj_add_number(options, 1, "period");
+    jerry_value_t arg = jerry_create_object_value(options);
+    jerry_value_t pwm_pin = call(pwm, "open", 1, &arg);
+
+    options = jerry_create_object();
+    zjs_obj_add_number(options, 2000, "setpoint");
+    zjs_obj_add_number(options, 0.0002, "kp");
+    zjs_obj_add_number(options, 0.01, "ki");
+    zjs_obj_add_number(options, 100, "rateHz");
+    zjs_obj_add_number(options, 10, "telemetryEvery");
+
+    jerry_value_t args[2];
+    args[0] = pwm_pin;
+    args[1] = jerry_create_object_value(options);
+    jerry_object_t *loop = jerry_get_object_value(call(pin, "pid", 2, args));
+    CHECK(loop, "couldn't start a control loop");
+    if (!loop)
+        return;
+
+    args[0] = jerry_create_string_value(
+        jerry_create_string((const jerry_char_t *)"telemetry"));
+    args[1] = jerry_create_object_value(
+        jerry_create_external_function(on_telemetry));
+    call(loop, "on", 2, args);
+
+    uint32_t start_writes;
+    shim_pwm_duty(0, &start_writes);
+    uint64_t start = now_us();
+    run_callbacks_for(1000);
+    double settled = telemetry_error;
+
+    arg = jerry_create_number_value(1000);
+    call(loop, "setSetpoint", 1, &arg);
+    run_callbacks_for(1000);
+    double followed = telemetry_error;
+
+    uint32_t writes;
+    shim_pwm_duty(0, &writes);
+    double elapsed = (now_us() - start) / 1000000.0;
+    call(loop, "stop", 0, NULL);
+    run_callbacks_for(100);
+
+    CHECK(telemetry_count >= 10, "only %d telemetry events in 2s",
+          telemetry_count);
+    CHECK(!telemetry_bad_sequence, "%d telemetry events out of sequence",
+          telemetry_bad_sequence);
+    CHECK(fabs(settled) < 40, "error of %g 1s after starting", settled);
+    CHECK(fabs(followed) < 40, "error of %g 1s after a setpoint change",
+          followed);
+    CHECK(fabs(plant_value - 1000) < 40, "plant at %g, not driven to 1000",
+          plant_value);
+    CHECK(zjs_ipm_credits() == ZJS_IPM_EVENT_CREDITS,
+          "%u of %d IPM credits back after the loop stopped",
+          zjs_ipm_credits(), ZJS_IPM_EVENT_CREDITS);
+
+    printf("PID at 100Hz: %.0f PWM writes/s, %d telemetry events, "
+           "error %g then %g\n", (writes - start_writes) / elapsed,
+           telemetry_count, settled, followed);
+}
+
+static jerry_value_t open_pwm(jerry_object_t *pwm, int channel)
+{
+    jerry_object_t *options = jerry_create_object();
+    zjs_obj_add_number(options, channel, "channel");
+    zjs_obj_add_number(options, 1, "period");
+    jerry_value_t arg = jerry_create_object_value(options);
+    return call(pwm, "open", 1, &arg);
+}
+
+static jerry_object_t *create_pipe(jerry_object_t *pipes,
+                                   jerry_object_t *source,
+                                   jerry_object_t *stages[], int count,
+                                   jerry_object_t *sink)
+{
+    jerry_object_t *transforms = jerry_create_array_object(count);
+    for (int i = 0; i < count; i++) {
+        jerry_set_array_index_value(transforms, i,
+                                    jerry_create_object_value(stages[i]));
+    }
+
+    jerry_object_t *spec = jerry_create_object();
+    zjs_obj_add_object(spec, source, "source");
+    zjs_obj_add_object(spec, transforms, "transforms");
+    zjs_obj_add_object(spec, sink, "sink");
+    jerry_value_t arg = jerry_create_object_value(spec);
+    return jerry_get_object_value(call(pipes, "create", 1, &arg));
+}
+
+static jerry_object_t *create_stage(const char *type)
+{
+    jerry_object_t *stage = jerry_create_object();
+    zjs_obj_add_string(stage, type, "type");
+    return stage;
+}
+
+static void test_pipes(jerry_object_t *pin)
+{
+    // an AIO pin scaled and clamped into a PWM duty cycle, and a timer
+    //   stepping a PWM pin through a table, should both run with no JS
+    shim_adc_set(15, 1200, 0);
+    jerry_object_t *pwm = zjs_pwm_init();
+    jerry_object_t *pipes = zjs_pipe_init();
+
+    jerry_object_t *source = jerry_create_object();
+    zjs_obj_add_object(source, pin, "aio");
+    jerry_object_t *stages[2];
+    stages[0] = create_stage("scale");
+    zjs_obj_add_number(stages[0], 0.5, "factor");
+    stages[1] = create_stage("clamp");
+    zjs_obj_add_number(stages[1], 500, "max");
+    jerry_object_t *sink = jerry_create_object();
+    zjs_obj_add_object(sink, jerry_get_object_value(open_pwm(pwm, 1)), "pwm");
+    zjs_obj_add_number(sink, 1000, "max");
+    jerry_object_t *aio_pipe = create_pipe(pipes, source, stages, 2, sink);
+    CHECK(aio_pipe, "couldn't create a pipe from an AIO pin");
+
+    source = jerry_create_object();
+    zjs_obj_add_number(source, 20, "timer");
+    stages[0] = create_stage("map");
+    jerry_object_t *table = jerry_create_array_object(2);
+    jerry_set_array_index_value(table, 0, jerry_create_number_value(0));
+    jerry_set_array_index_value(table, 1, jerry_create_number_value(4095));
+    zjs_obj_add_object(stages[0], table, "table");
+    zjs_obj_add_boolean(stages[0], true, "wrap");
+    sink = jerry_create_object();
+    zjs_obj_add_object(sink, jerry_get_object_value(open_pwm(pwm, 2)), "pwm");
+    uint32_t start_writes;
+    shim_pwm_duty(2, &start_writes);
+    jerry_object_t *timer_pipe = create_pipe(pipes, source, stages, 1, sink);
+    CHECK(timer_pipe, "couldn't create a pipe from a timer");
+    if (!aio_pipe || !timer_pipe)
+        return;
+
+    run_callbacks_for(500);
+    uint32_t writes;
+    shim_pwm_duty(2, &writes);
+    writes -= start_writes;
+    double duty = shim_pwm_duty(1, NULL);
+    jerry_object_t *stats = jerry_get_object_value(
+        call(aio_pipe, "getStats", 0, NULL));
+    double inputs = get_number(stats, "inputs");
+    double outputs = get_number(stats, "outputs");
+    call(aio_pipe, "stop", 0, NULL);
+    call(timer_pipe, "stop", 0, NULL);
+
+    CHECK(inputs >= 1 && outputs == 1,
+          "AIO pipe saw %g inputs and made %g writes, not 1 for a steady pin",
+          inputs, outputs);
+    CHECK(fabs(duty - 0.5) < 0.001, "AIO pipe set duty %g, not 0.5", duty);
+    CHECK(writes >= 20 && writes <= 27,
+          "timer pipe wrote %u times in 500ms at 50Hz", writes);
+    CHECK(zjs_ipm_credits() == ZJS_IPM_EVENT_CREDITS,
+          "%u of %d IPM credits back after the pipes stopped",
+          zjs_ipm_credits(), ZJS_IPM_EVENT_CREDITS);
+
+    printf("pipes: AIO to PWM %g inputs, %g writes; timer to PWM %u writes "
+           "in 500ms\n", inputs, outputs, writes);
+}
+
+static void test_pwm_duty(void)
+{
+    // setDutyCycle should land on the right on time for either polarity,
+    //   from the channel's cached period
+    jerry_object_t *pwm = zjs_pwm_init();
+    jerry_object_t *options = jerry_create_object();
+    zjs_obj_add_number(options, 3, "channel");
+    zjs_obj_add_number(options, 2, "period");
+    jerry_value_t arg = jerry_create_object_value(options);
+    jerry_object_t *pin = jerry_get_object_value(call(pwm, "open", 1, &arg));
+
+    arg = jerry_create_number_value(0.25);
+    call(pin, "setDutyCycle", 1, &arg);
+    double normal = shim_pwm_duty(3, NULL);
+
+    zjs_obj_add_string(options, "reverse", "polarity");
+    arg = jerry_create_object_value(options);
+    pin = jerry_get_object_value(call(pwm, "open", 1, &arg));
+    arg = jerry_create_number_value(0.25);
+    call(pin, "setDutyCycle", 1, &arg);
+    double reverse = shim_pwm_duty(3, NULL);
+
+    CHECK(fabs(normal - 0.25) < 0.0001, "duty 0.25 gave %g", normal);
+    CHECK(fabs(reverse - 0.75) < 0.0001, "reversed duty 0.25 gave %g",
+          reverse);
+
+    const int updates = 100000;
+    uint64_t start = now_us();
+    for (int i = 0; i < updates; i++) {
+        arg = jerry_create_number_value((double)(i & 255) / 255);
+        call(pin, "setDutyCycle", 1, &arg);
+    }
+    uint64_t elapsed = now_us() - start;
+    printf("setDutyCycle: %.3fus mean over %d updates\n",
+           (double)elapsed / updates, updates);
+}
+
+static int fade_ends = 0;
+
+static bool on_fade_end(const jerry_object_t *function_obj_p,
+                        const jerry_value_t this_val,
+                        const jerry_value_t args_p[],
+                        const jerry_length_t args_cnt,
+                        jerry_value_t *ret_val_p)
+{
+    fade_ends++;
+    return true;
+}
+
+static jerry_value_t fade_options(double to, double ms, const char *curve)
+{
+    jerry_object_t *options = jerry_create_object();
+    zjs_obj_add_number(options, to, "to");
+    zjs_obj_add_number(options, ms, "durationMs");
+    if (curve)
+        zjs_obj_add_string(options, curve, "curve");
+    return jerry_create_object_value(options);
+}
+
+static void test_pwm_fades(void)
+{
+    // fades should follow their curve in time, finish exactly on target and
+    //   say so once, and stop where they are when asked
+    jerry_object_t *pwm = zjs_pwm_init();
+    jerry_object_t *options = jerry_create_object();
+    zjs_obj_add_number(options, 2, "channel");
+    zjs_obj_add_number(options, 2, "period");
+    jerry_value_t arg = jerry_create_object_value(options);
+    jerry_object_t *pin = jerry_get_object_value(call(pwm, "open", 1, &arg));
+
+    jerry_value_t args[2] = {
+        jerry_create_string_value(jerry_create_string(
+            (const jerry_char_t *)"fadeEnd")),
+        jerry_create_object_value(jerry_create_external_function(on_fade_end))
+    };
+    call(pin, "on", 2, args);
+
+    uint32_t start_writes, writes;
+    shim_pwm_duty(2, &start_writes);
+    arg = fade_options(1, 400, NULL);
+    call(pin, "fade", 1, &arg);
+    run_callbacks_for(200);
+    double linear_mid = shim_pwm_duty(2, NULL);
+    run_callbacks_for(300);
+    double linear_end = shim_pwm_duty(2, &writes);
+    int linear_ends = fade_ends;
+
+    arg = fade_options(0, 400, "gamma");
+    call(pin, "fade", 1, &arg);
+    run_callbacks_for(200);
+    double gamma_mid = shim_pwm_duty(2, NULL);
+    run_callbacks_for(300);
+    double gamma_end = shim_pwm_duty(2, NULL);
+
+    CHECK(fabs(linear_mid - 0.5) < 0.1, "linear fade halfway at %g",
+          linear_mid);
+    CHECK(fabs(linear_end - 1) < 0.0001, "linear fade ended at %g",
+          linear_end);
+    CHECK(linear_ends == 1, "%d fadeEnd events for one fade", linear_ends);
+    CHECK(gamma_mid > 0.1 && gamma_mid < 0.35, "gamma fade halfway at %g",
+          gamma_mid);
+    CHECK(gamma_end == 0, "gamma fade ended at %g", gamma_end);
+    CHECK(fade_ends == 2, "%d fadeEnd events for two fades", fade_ends);
+
+    // three passes of up and down, then an endless one that gets stopped
+    jerry_object_t *frames = jerry_create_array_object(2);
+    jerry_set_array_index_value(frames, 0, fade_options(1, 50, NULL));
+    jerry_set_array_index_value(frames, 1, fade_options(0, 50, "gamma"));
+    options = jerry_create_object();
+    zjs_obj_add_object(options, frames, "keyframes");
+    zjs_obj_add_number(options, 3, "repeat");
+    arg = jerry_create_object_value(options);
+    call(pin, "fade", 1, &arg);
+    run_callbacks_for(200);
+    int sequence_early = fade_ends;
+    run_callbacks_for(200);
+    int sequence_ends = fade_ends;
+
+    zjs_obj_add_number(options, 0, "repeat");
+    arg = jerry_create_object_value(options);
+    call(pin, "fade", 1, &arg);
+    run_callbacks_for(420);
+    call(pin, "stopFade", 0, NULL);
+    double stopped = shim_pwm_duty(2, NULL);
+    run_callbacks_for(100);
+    double later = shim_pwm_duty(2, NULL);
+
+    CHECK(sequence_early == 2 && sequence_ends == 3,
+          "fadeEnd count %d then %d for a 300ms sequence", sequence_early,
+          sequence_ends);
+    CHECK(fade_ends == 3, "endless fade ended %d times", fade_ends - 3);
+    CHECK(stopped == later, "stopped fade moved from %g to %g", stopped,
+          later);
+
+    printf("PWM fade: %u writes for a 400ms linear fade, halfway at %.2f "
+           "linear and %.2f gamma\n", writes - start_writes,
+           linear_mid, gamma_mid);
+}
+
+static jerry_value_t channel_entry(int channel, const char *name,
+                                   double value)
+{
+    jerry_object_t *entry = jerry_create_object();
+    zjs_obj_add_number(entry, channel, "channel");
+    zjs_obj_add_number(entry, value, name);
+    return jerry_create_object_value(entry);
+}
+
+static void test_pwm_claims(void)
+{
+    // a pipe should keep its PWM pin to itself, hold its duty across a
+    //   period change, and give the pin back when it stops
+    jerry_object_t *pwm = zjs_pwm_init();
+    jerry_object_t *pipes = zjs_pipe_init();
+    jerry_value_t pwm_pin = open_pwm(pwm, 3);
+    jerry_object_t *pin = jerry_get_object_value(pwm_pin);
+
+    jerry_object_t *source = jerry_create_object();
+    zjs_obj_add_number(source, 20, "timer");
+    jerry_object_t *stages[1];
+    stages[0] = create_stage("map");
+    jerry_object_t *table = jerry_create_array_object(1);
+    jerry_set_array_index_value(table, 0, jerry_create_number_value(1000));
+    zjs_obj_add_object(stages[0], table, "table");
+    jerry_object_t *sink = jerry_create_object();
+    zjs_obj_add_object(sink, pin, "pwm");
+    zjs_obj_add_number(sink, 4000, "max");
+    jerry_object_t *pipe = create_pipe(pipes, source, stages, 1, sink);
+    CHECK(pipe, "couldn't create a pipe to PWM 3");
+    if (!pipe)
+        return;
+    run_callbacks_for(100);
+    double piped = shim_pwm_duty(3, NULL);
+
+    jerry_object_t *second = create_pipe(pipes, source, stages, 1, sink);
+    jerry_value_t arg = jerry_create_number_value(0.75);
+    call(pin, "setDutyCycle", 1, &arg);
+    arg = fade_options(1, 0, NULL);
+    call(pin, "fade", 1, &arg);
+    run_callbacks_for(50);
+    double refused = shim_pwm_duty(3, NULL);
+
+    arg = jerry_create_number_value(2);
+    call(pin, "setPeriod", 1, &arg);
+    run_callbacks_for(100);
+    double repiped = shim_pwm_duty(3, NULL);
+
+    call(pipe, "stop", 0, NULL);
+    arg = jerry_create_number_value(0.75);
+    call(pin, "setDutyCycle", 1, &arg);
+    double released = shim_pwm_duty(3, NULL);
+
+    CHECK(fabs(piped - 0.25) < 0.001, "pipe set duty %g, not 0.25", piped);
+    CHECK(!second, "a second pipe claimed PWM 3");
+    CHECK(fabs(refused - 0.25) < 0.001,
+          "setDutyCycle and fade moved a piped pin to duty %g", refused);
+    CHECK(fabs(repiped - 0.25) < 0.001,
+          "piped pin at duty %g, not 0.25, after its period doubled",
+          repiped);
+    CHECK(fabs(released - 0.75) < 0.001,
+          "setDutyCycle set duty %g, not 0.75, once the pipe stopped",
+          released);
+}
+
+static void test_pwm_set_channels(void)
+{
+    // setChannels should update every listed channel, or none of them if
+    //   any entry is bad; then compare it with one call per channel
+    jerry_object_t *pwm = zjs_pwm_init();
+    jerry_object_t *pins[3];
+    for (int i = 0; i < 3; i++) {
+        jerry_object_t *options = jerry_create_object();
+        zjs_obj_add_number(options, i + 1, "channel");
+        zjs_obj_add_number(options, 2, "period");
+        jerry_value_t arg = jerry_create_object_value(options);
+        pins[i] = jerry_get_object_value(call(pwm, "open", 1, &arg));
+    }
+
+    jerry_object_t *entries = jerry_create_array_object(3);
+    jerry_set_array_index_value(entries, 0, channel_entry(1, "dutyCycle",
+                                                          0.2));
+    jerry_set_array_index_value(entries, 1, channel_entry(2, "pulseWidth",
+                                                          1));
+    jerry_set_array_index_value(entries, 2, channel_entry(3, "dutyCycle",
+                                                          0.8));
+    jerry_value_t arg = jerry_create_object_value(entries);
+    call(pwm, "setChannels", 1, &arg);
+    double duty[3];
+    uint32_t writes[3];
+    for (int i = 0; i < 3; i++)
+        duty[i] = shim_pwm_duty(i + 1, &writes[i]);
+
+    // a bad last entry should leave the first two alone
+    jerry_object_t *bad = jerry_create_array_object(3);
+    jerry_set_array_index_value(bad, 0, channel_entry(1, "dutyCycle", 0.5));
+    jerry_set_array_index_value(bad, 1, channel_entry(2, "dutyCycle", 0.5));
+    jerry_set_array_index_value(bad, 2, channel_entry(3, "dutyCycle", 2));
+    jerry_value_t bad_arg = jerry_create_object_value(bad);
+    call(pwm, "setChannels", 1, &bad_arg);
+    uint32_t after[3];
+    for (int i = 0; i < 3; i++)
+        shim_pwm_duty(i + 1, &after[i]);
+
+    CHECK(fabs(duty[0] - 0.2) < 0.0001 && fabs(duty[1] - 0.5) < 0.0001 &&
+          fabs(duty[2] - 0.8) < 0.0001,
+          "setChannels gave duty %g, %g, %g", duty[0], duty[1], duty[2]);
+    CHECK(after[0] == writes[0] && after[1] == writes[1] &&
+          after[2] == writes[2], "setChannels wrote despite a bad entry");
+
+    const int updates = 100000;
+    uint64_t start = now_us();
+    for (int i = 0; i < updates; i++)
+        call(pwm, "setChannels", 1, &arg);
+    uint64_t together = now_us() - start;
+
+    jerry_value_t fractions[3] = {
+        jerry_create_number_value(0.2),
+        jerry_create_number_value(0.5),
+        jerry_create_number_value(0.8)
+    };
+    start = now_us();
+    for (int i = 0; i < updates; i++) {
+        for (int j = 0; j < 3; j++)
+            call(pins[j], "setDutyCycle", 1, &fractions[j]);
+    }
+    uint64_t separate = now_us() - start;
+
+    // how long the first and last channel disagree, on average
+    const int samples = 1000;
+    uint64_t spread_together = 0, spread_separate = 0;
+    for (int i = 0; i < samples; i++) {
+        call(pwm, "setChannels", 1, &arg);
+        spread_together += shim_pwm_written_ns(3) - shim_pwm_written_ns(1);
+
+        for (int j = 0; j < 3; j++)
+            call(pins[j], "setDutyCycle", 1, &fractions[j]);
+        spread_separate += shim_pwm_written_ns(3) - shim_pwm_written_ns(1);
+    }
+
+    printf("setChannels: %.3fus for three channels, %.3fus for three "
+           "setDutyCycle calls; channels apart %.0fns and %.0fns on "
+           "average\n", (double)together / updates,
+           (double)separate / updates, (double)spread_together / samples,
+           (double)spread_separate / samples);
+}
+
+static void test_servo(void)
+{
+    // a servo should run at 50Hz with its pulse spread over 0 to 180
+    //   degrees, clamped at both ends
+    jerry_object_t *pwm = zjs_pwm_init();
+    jerry_object_t *options = jerry_create_object();
+    zjs_obj_add_number(options, 0, "channel");
+    zjs_obj_add_number(options, 500, "minUs");
+    zjs_obj_add_number(options, 2500, "maxUs");
+    jerry_value_t arg = jerry_create_object_value(options);
+    jerry_object_t *servo = jerry_get_object_value(call(pwm, "openServo", 1,
+                                                        &arg));
+
+    double angles[4] = { 0, 90, 180, 270 };
+    double expected[4] = { 0.025, 0.075, 0.125, 0.125 };
+    for (int i = 0; i < 4; i++) {
+        arg = jerry_create_number_value(angles[i]);
+        call(servo, "write", 1, &arg);
+        double duty = shim_pwm_duty(0, NULL);
+        CHECK(fabs(duty - expected[i]) < 0.00001,
+              "servo at %g degrees gave duty %g, not %g", angles[i], duty,
+              expected[i]);
+    }
+
+    arg = jerry_create_number_value(1250);
+    call(servo, "writeMicroseconds", 1, &arg);
+    double duty = shim_pwm_duty(0, NULL);
+    CHECK(fabs(duty - 0.0625) < 0.00001, "servo at 1250us gave duty %g",
+          duty);
+
+    const int updates = 100000;
+    uint64_t start = now_us();
+    for (int i = 0; i < updates; i++) {
+        arg = jerry_create_number_value(i % 181);
+        call(servo, "write", 1, &arg);
+    }
+    uint64_t elapsed = now_us() - start;
+    printf("servo write: %.3fus mean over %d updates\n",
+           (double)elapsed / updates, updates);
+}
+
+static jerry_object_t *open_gpio(jerry_object_t *gpio, int pin,
+                                  const char *direction, const char *edge)
+{
+    jerry_object_t *options = jerry_create_object();
+    zjs_obj_add_number(options, pin, "pin");
+    zjs_obj_add_string(options, direction, "direction");
+    if (edge)
+        zjs_obj_add_string(options, edge, "edge");
+    jerry_value_t arg = jerry_create_object_value(options);
+    return jerry_get_object_value(call(gpio, "open", 1, &arg));
+}
+
+static void gpio_pulse(uint32_t pin, uint32_t us)
+{
+    // drives a high pulse of about us microseconds on pin
+    shim_gpio_set(pin, 1);
+    struct timespec ts = { 0, us * 1000 };
+    nanosleep(&ts, NULL);
+    shim_gpio_set(pin, 0);
+}
+
+static int gpio_events = 0;
+static int gpio_event_calls = 0;
+static int gpio_bad_values = 0;
+static bool gpio_expected = true;
+
+static bool on_gpio_change(const jerry_object_t *function_obj_p,
+                           const jerry_value_t this_val,
+                           const jerry_value_t args_p[],
+                           const jerry_length_t args_cnt,
+                           jerry_value_t *ret_val_p)
+{
+    jerry_object_t *events = jerry_get_object_value(args_p[0]);
+    jerry_value_t ev;
+    for (uint32_t i = 0; jerry_get_array_index_value(events, i, &ev); i++) {
+        jerry_value_t value = jerry_get_object_field_value(
+            jerry_get_object_value(ev), (const jerry_char_t *)"value");
+        if (jerry_get_boolean_value(value) != gpio_expected)
+            gpio_bad_values++;
+        gpio_expected = !gpio_expected;
+        gpio_events++;
+    }
+    gpio_event_calls++;
+    return true;
+}
+
+static int pulse_results = 0;
+static double pulse_width = 0;
+static bool pulse_null = false;
+
+static bool on_pulse(const jerry_object_t *function_obj_p,
+                     const jerry_value_t this_val,
+                     const jerry_value_t args_p[],
+                     const jerry_length_t args_cnt,
+                     jerry_value_t *ret_val_p)
+{
+    pulse_null = jerry_value_is_null(args_p[0]);
+    pulse_width = pulse_null ? 0 : jerry_get_number_value(args_p[0]);
+    pulse_results++;
+    return true;
+}
+
+static int count_windows = 0;
+static double count_edges = 0;
+
+static bool on_count(const jerry_object_t *function_obj_p,
+                     const jerry_value_t this_val,
+                     const jerry_value_t args_p[],
+                     const jerry_length_t args_cnt,
+                     jerry_value_t *ret_val_p)
+{
+    if (!count_windows)
+        count_edges = jerry_get_number_value(args_p[1]);
+    count_windows++;
+    return true;
+}
+
+static void test_gpio_events(jerry_object_t *gpio)
+{
+    // every edge on an input should reach JS, in order, even when several
+    //   arrive before the callback runs
+    jerry_object_t *pin = open_gpio(gpio, 4, "in", "any");
+    CHECK(pin, "couldn't open GPIO 4");
+    if (!pin)
+        return;
+
+    jerry_value_t args[2];
+    args[0] = jerry_create_string_value(
+        jerry_create_string((const jerry_char_t *)"change"));
+    args[1] = jerry_create_object_value(
+        jerry_create_external_function(on_gpio_change));
+    call(pin, "on", 2, args);
+
+    for (int i = 0; i < 5; i++) {
+        gpio_pulse(4, 100);
+    }
+    run_callbacks_for(50);
+
+    CHECK(gpio_events == 10, "%d of 10 GPIO edges reported", gpio_events);
+    CHECK(!gpio_bad_values, "%d GPIO events had the wrong value",
+          gpio_bad_values);
+    CHECK(gpio_event_calls >= 1 && gpio_event_calls <= gpio_events,
+          "%d change callbacks for %d GPIO edges", gpio_event_calls,
+          gpio_events);
+
+    // edges past the ring's 16 while JS is busy are dropped and counted,
+    //   and the pin carries on reporting afterwards
+    for (int i = 0; i < 12; i++) {
+        gpio_pulse(4, 10);
+    }
+    run_callbacks_for(50);
+    CHECK(gpio_events == 26, "%d of 16 GPIO edges reported after an "
+          "overflow", gpio_events - 10);
+    gpio_pulse(4, 100);
+    run_callbacks_for(50);
+    CHECK(gpio_events == 28 && !gpio_bad_values,
+          "GPIO events wrong after an overflow");
+
+    args[1] = jerry_create_null_value();
+    call(pin, "on", 2, args);
+    gpio_pulse(4, 100);
+    run_callbacks_for(50);
+    CHECK(gpio_events == 28, "GPIO edges reported after on(null)");
+}
+
+static void test_gpio_pulse(jerry_object_t *gpio)
+{
+    // a pulse is timed in the edge ISR; with no pulse the callback gets null
+    //   once the timeout passes
+    jerry_object_t *pin = open_gpio(gpio, 5, "in", "any");
+    jerry_object_t *options = jerry_create_object();
+    zjs_obj_add_number(options, 100, "timeoutMs");
+    jerry_value_t args[2];
+    args[0] = jerry_create_object_value(options);
+    args[1] = jerry_create_object_value(
+        jerry_create_external_function(on_pulse));
+
+    call(pin, "measurePulse", 2, args);
+    gpio_pulse(5, 2000);
+    run_callbacks_for(50);
+    CHECK(pulse_results == 1 && !pulse_null, "measurePulse didn't report a "
+          "width");
+    CHECK(pulse_width >= 2000 && pulse_width < 3000,
+          "measurePulse timed a 2ms pulse as %gus", pulse_width);
+    double width = pulse_width;
+
+    uint64_t start = now_us();
+    call(pin, "measurePulse", 2, args);
+    while (pulse_results < 2 && now_us() - start < 2000000) {
+        run_callbacks_for(1);
+    }
+    double elapsed = (now_us() - start) / 1000.0;
+    CHECK(pulse_results == 2 && pulse_null, "measurePulse didn't time out");
+    printf("measurePulse: 2ms pulse timed as %.0fus; 100ms timeout reported "
+           "after %.1fms\n", width, elapsed);
+}
+
+static void test_gpio_counting(jerry_object_t *gpio)
+{
+    // edges are counted in the ISR and reported once per window
+    jerry_object_t *pin = open_gpio(gpio, 6, "in", "any");
+    jerry_object_t *options = jerry_create_object();
+    zjs_obj_add_number(options, 200, "windowMs");
+    jerry_value_t args[2];
+    args[0] = jerry_create_object_value(options);
+    args[1] = jerry_create_object_value(
+        jerry_create_external_function(on_count));
+
+    call(pin, "startCounting", 2, args);
+    for (int i = 0; i < 10; i++) {
+        gpio_pulse(6, 100);
+    }
+    run_callbacks_for(300);
+    call(pin, "stopCounting", 0, NULL);
+
+    CHECK(count_windows == 1, "%d counting windows closed in 300ms, not 1",
+          count_windows);
+    CHECK(count_edges == 20, "counted %g of 20 edges", count_edges);
+
+    int windows = count_windows;
+    run_callbacks_for(300);
+    CHECK(count_windows == windows, "counting went on after stopCounting");
+}
+
+static void test_gpio_debounce(jerry_object_t *gpio)
+{
+    // a debounced pin reports a level only once it has held for the quiet
+    //   time, and never reports a glitch that undoes itself
+    jerry_object_t *options = jerry_create_object();
+    zjs_obj_add_number(options, 7, "pin");
+    zjs_obj_add_string(options, "in", "direction");
+    zjs_obj_add_string(options, "any", "edge");
+    zjs_obj_add_number(options, 20, "debounce");
+    jerry_value_t arg = jerry_create_object_value(options);
+    jerry_object_t *pin = jerry_get_object_value(call(gpio, "open", 1, &arg));
+
+    jerry_value_t args[2];
+    args[0] = jerry_create_string_value(
+        jerry_create_string((const jerry_char_t *)"change"));
+    args[1] = jerry_create_object_value(
+        jerry_create_external_function(on_gpio_change));
+    gpio_events = 0;
+    gpio_expected = true;
+    call(pin, "on", 2, args);
+
+    gpio_pulse(7, 1000);
+    run_callbacks_for(60);
+    CHECK(gpio_events == 0, "a 1ms glitch on a 20ms debounced pin was "
+          "reported");
+
+    // a bouncy press ending high, held, then a clean release
+    uint64_t start = now_us();
+    for (int i = 0; i < 3; i++) {
+        gpio_pulse(7, 500);
+    }
+    shim_gpio_set(7, 1);
+    while (!gpio_events && now_us() - start < 1000000) {
+        run_callbacks_for(1);
+    }
+    double settled = (now_us() - start) / 1000.0;
+    shim_gpio_set(7, 0);
+    run_callbacks_for(60);
+
+    CHECK(gpio_events == 2 && !gpio_bad_values,
+          "%d debounced events for a bouncy press and release, not 2",
+          gpio_events);
+    CHECK(settled >= 20, "debounced press reported after %.1fms, before "
+          "the 20ms quiet time", settled);
+    double bounces = jerry_get_number_value(call(pin, "getBounceCount", 0,
+                                                 NULL));
+    CHECK(bounces == 8, "counted %g of 8 bounces", bounces);
+    printf("debounce: press reported %.1fms after its first edge with "
+           "20ms quiet time\n", settled);
+}
+
+static void test_gpio_lifetime(jerry_object_t *gpio)
+{
+    // a pin's native state outlives turning its callbacks off, and when the
+    //   pin object is collected its callbacks already queued don't run
+    jerry_object_t *pin = open_gpio(gpio, 9, "in", "any");
+    jerry_value_t args[2];
+    args[0] = jerry_create_string_value(
+        jerry_create_string((const jerry_char_t *)"change"));
+    args[1] = jerry_create_null_value();
+    jerry_value_t on = jerry_create_object_value(
+        jerry_create_external_function(on_gpio_change));
+
+    gpio_events = 0;
+    gpio_expected = true;
+    args[1] = on;
+    call(pin, "on", 2, args);
+    args[1] = jerry_create_null_value();
+    call(pin, "on", 2, args);
+    args[1] = on;
+    call(pin, "on", 2, args);
+    gpio_pulse(9, 100);
+    run_callbacks_for(20);
+    CHECK(gpio_events == 2, "%d of 2 GPIO edges reported after turning "
+          "change events off and on", gpio_events);
+
+    jerry_object_t *options = jerry_create_object();
+    zjs_obj_add_number(options, 1000, "timeoutMs");
+    jerry_value_t pulse_args[2];
+    pulse_args[0] = jerry_create_object_value(options);
+    pulse_args[1] = jerry_create_object_value(
+        jerry_create_external_function(on_pulse));
+    int results = pulse_results;
+    call(pin, "measurePulse", 2, pulse_args);
+
+    // queue both the change and pulse callbacks, then collect the pin
+    gpio_pulse(9, 100);
+    jerry_fake_collect(pin);
+    gpio_pulse(9, 100);
+    run_callbacks_for(20);
+    CHECK(gpio_events == 2, "change events reported for a collected pin");
+    CHECK(pulse_results == results, "measurePulse reported for a collected "
+          "pin");
+}
+
+static void test_gpio_outputs(jerry_object_t *gpio)
+{
+    // pin writes honour activeLow, and a group updates its pins together
+    jerry_object_t *options = jerry_create_object();
+    zjs_obj_add_number(options, 8, "pin");
+    zjs_obj_add_boolean(options, true, "activeLow");
+    jerry_value_t arg = jerry_create_object_value(options);
+    jerry_object_t *pin = jerry_get_object_value(call(gpio, "open", 1, &arg));
+
+    arg = jerry_create_boolean_value(true);
+    call(pin, "write", 1, &arg);
+    CHECK(!(shim_gpio_port(8, NULL) & (1UL << 8)),
+          "active low pin driven high when written true");
+    arg = jerry_create_boolean_value(false);
+    call(pin, "write", 1, &arg);
+    CHECK(shim_gpio_port(8, NULL) & (1UL << 8),
+          "active low pin driven low when written false");
+
+    jerry_object_t *pins = jerry_create_array_object(3);
+    for (int i = 0; i < 3; i++) {
+        jerry_value_t v = jerry_create_number_value(20 + i);
+        jerry_set_array_index_value(pins, i, v);
+    }
+    options = jerry_create_object();
+    zjs_obj_add_object(options, pins, "pins");
+    arg = jerry_create_object_value(options);
+    jerry_object_t *group = jerry_get_object_value(call(gpio, "openGroup", 1,
+                                                        &arg));
+    CHECK(group, "couldn't open a GPIO group");
+    if (!group)
+        return;
+
+    uint32_t before[3];
+    for (int i = 0; i < 3; i++) {
+        shim_gpio_port(20 + i, &before[i]);
+    }
+    arg = jerry_create_number_value(5);
+    call(group, "write", 1, &arg);
+    uint32_t port = shim_gpio_port(20, NULL);
+    CHECK((port & (7 << 20)) == (5 << 20), "group write of 5 set port bits "
+          "%lx", (unsigned long)(port >> 20) & 7);
+
+    jerry_value_t value = call(group, "read", 0, NULL);
+    CHECK(jerry_get_number_value(value) == 5, "group read returned %g",
+          jerry_get_number_value(value));
+
+    // pins whose level didn't change shouldn't be rewritten
+    uint32_t writes;
+    shim_gpio_port(21, &writes);
+    CHECK(writes == before[1], "group write touched a pin left low");
+}
+
+static void test_pipe_taps(jerry_object_t *aio_pin, jerry_object_t *gpio)
+{
+    // a source pin feeds one pipe, and a second pipe on it is refused
+    //   without stopping the first; a GPIO sink has to be an output GPIOPin
+    shim_adc_set(15, 1000, 0);
+    jerry_object_t *pwm = zjs_pwm_init();
+    jerry_object_t *pipes = zjs_pipe_init();
+
+    jerry_object_t *source = jerry_create_object();
+    zjs_obj_add_object(source, aio_pin, "aio");
+    jerry_object_t *sink = jerry_create_object();
+    zjs_obj_add_object(sink, jerry_get_object_value(open_pwm(pwm, 1)), "pwm");
+    jerry_object_t *first = create_pipe(pipes, source, NULL, 0, sink);
+    sink = jerry_create_object();
+    zjs_obj_add_object(sink, jerry_get_object_value(open_pwm(pwm, 2)), "pwm");
+    jerry_object_t *second = create_pipe(pipes, source, NULL, 0, sink);
+    shim_adc_set(15, 3000, 0);
+    run_callbacks_for(200);
+    double duty = shim_pwm_duty(1, NULL);
+    if (first)
+        call(first, "stop", 0, NULL);
+    jerry_object_t *third = create_pipe(pipes, source, NULL, 0, sink);
+    if (third)
+        call(third, "stop", 0, NULL);
+
+    CHECK(first, "couldn't create a pipe from A5");
+    CHECK(!second, "a second pipe tapped A5");
+    CHECK(fabs(duty - 3000.0 / 4095) < 0.001,
+          "first A5 pipe set duty %g after a second was refused", duty);
+    CHECK(third, "A5 still tapped once its pipe stopped");
+
+    jerry_object_t *in = open_gpio(gpio, 11, "in", "any");
+    jerry_object_t *out = open_gpio(gpio, 12, "out", NULL);
+    source = jerry_create_object();
+    zjs_obj_add_object(source, in, "gpio");
+    sink = jerry_create_object();
+    zjs_obj_add_object(sink, out, "gpio");
+    first = create_pipe(pipes, source, NULL, 0, sink);
+    sink = jerry_create_object();
+    zjs_obj_add_object(sink, open_gpio(gpio, 13, "out", NULL), "gpio");
+    second = create_pipe(pipes, source, NULL, 0, sink);
+    shim_gpio_set(11, 1);
+    run_callbacks_for(20);
+    uint32_t port = shim_gpio_port(12, NULL);
+    shim_gpio_set(11, 0);
+    if (first)
+        call(first, "stop", 0, NULL);
+
+    CHECK(first, "couldn't create a pipe from GPIO 11");
+    CHECK(!second, "a second pipe tapped GPIO 11");
+    CHECK(port & (1UL << 12),
+          "first GPIO 11 pipe didn't follow its pin after a second was "
+          "refused");
+
+    // neither an input nor another module's pin may be a GPIO sink
+    source = jerry_create_object();
+    zjs_obj_add_number(source, 20, "timer");
+    sink = jerry_create_object();
+    zjs_obj_add_object(sink, in, "gpio");
+    jerry_object_t *to_input = create_pipe(pipes, source, NULL, 0, sink);
+    sink = jerry_create_object();
+    zjs_obj_add_object(sink, aio_pin, "gpio");
+    jerry_object_t *to_aio = create_pipe(pipes, source, NULL, 0, sink);
+    CHECK(!to_input, "a pipe wrote to input GPIO 11");
+    CHECK(!to_aio, "a pipe took an AIO pin as a GPIO sink");
+}
+
+static int wave_completes = 0;
+static double wave_underruns = 0;
+
+static bool on_wave_complete(const jerry_object_t *function_obj_p,
+                             const jerry_value_t this_val,
+                             const jerry_value_t args_p[],
+                             const jerry_length_t args_cnt,
+                             jerry_value_t *ret_val_p)
+{
+    wave_underruns = jerry_get_number_value(args_p[0]);
+    wave_completes++;
+    return true;
+}
+
+static jerry_object_t *create_wave(jerry_object_t *gpio, uint32_t pin,
+                                   uint32_t us)
+{
+    // a square wave on pin, us high then us low
+    jerry_object_t *buf_obj = zjs_buffer_create(16);
+    struct zjs_buffer_t *buf = zjs_buffer_find(buf_obj);
+    for (int i = 0; i < 2; i++) {
+        uint8_t *step = buf->buffer + i * 8;
+        uint32_t mask = 1UL << pin;
+        for (int j = 0; j < 4; j++)
+            step[j] = mask >> (j * 8);
+        step[4] = !i;
+        for (int j = 0; j < 3; j++)
+            step[5 + j] = us >> (j * 8);
+    }
+
+    jerry_value_t arg = jerry_create_object_value(buf_obj);
+    jerry_object_t *wave = jerry_get_object_value(call(gpio, "createWaveform",
+                                                       1, &arg));
+    jerry_value_t args[2];
+    args[0] = jerry_create_string_value(
+        jerry_create_string((const jerry_char_t *)"complete"));
+    args[1] = jerry_create_object_value(
+        jerry_create_external_function(on_wave_complete));
+    call(wave, "on", 2, args);
+    return wave;
+}
+
+static void test_gpio_waveform(jerry_object_t *gpio)
+{
+    // a waveform is played from the timer interrupt: a finite one plays
+    //   every step once per pass, and one played until stopped keeps time
+    //   and stops at once when told
+    open_gpio(gpio, 12, "out", NULL);
+    jerry_object_t *wave = create_wave(gpio, 12, 1000);
+    uint32_t before, writes;
+    shim_gpio_port(12, &before);
+
+    jerry_value_t arg = jerry_create_number_value(3);
+    uint64_t start = now_us();
+    call(wave, "play", 1, &arg);
+    while (!wave_completes && now_us() - start < 1000000) {
+        run_callbacks_for(1);
+    }
+    double elapsed = (now_us() - start) / 1000.0;
+    shim_gpio_port(12, &writes);
+    CHECK(wave_completes == 1, "a 3 pass waveform didn't complete");
+    CHECK(writes - before == 6, "a 3 pass waveform wrote its pin %u times, "
+          "not 6", writes - before);
+    CHECK(elapsed >= 6, "a 3 pass waveform of 6ms completed in %.1fms",
+          elapsed);
+
+    arg = jerry_create_number_value(0);
+    shim_gpio_port(12, &before);
+    call(wave, "play", 1, &arg);
+    run_callbacks_for(500);
+    call(wave, "stop", 0, NULL);
+    uint32_t played;
+    shim_gpio_port(12, &played);
+    run_callbacks_for(50);
+    shim_gpio_port(12, &writes);
+    CHECK(wave_completes == 2, "a stopped waveform didn't complete");
+    CHECK(writes == played, "a stopped waveform went on playing");
+
+    // one step a millisecond; allow for the host timer's wakeup latency
+    double rate = (played - before) / 0.5;
+    CHECK(rate > 900 && rate <= 1010, "a 1ms step waveform played %.0f "
+          "steps/s", rate);
+    printf("waveform: 3 passes of 6ms in %.1fms; %.0f steps/s at 1ms a "
+           "step, %g underruns\n", elapsed, rate, wave_underruns);
+}
+
+static void stray_handler(void *context, uint32_t id, volatile void *data)
+{
+}
+
+static void test_ipm_handlers(jerry_object_t *pin)
+{
+    // a second handler for a message id should be refused, leaving the
+    //   first one getting its messages
+    shim_adc_set(10, 3456, 0);
+    run_callbacks_for(200);
+
+    int rval = zjs_ipm_register_callback(MSG_ID_AIO, stray_handler);
+    double value = jerry_get_number_value(call(pin, "read", 0, NULL));
+
+    CHECK(rval == -EBUSY, "a second AIO handler registered, returning %d",
+          rval);
+    CHECK(value == 3456, "read %g, not 3456, after a second AIO handler",
+          value);
+}
+
+static void test_doorbell(jerry_object_t *aio, jerry_object_t *pin)
+{
+    // a doorbell ARC can't ring because x86's mailbox is busy should be rung
+    //   again from ARC's main loop, not retried in its IPM ISR or lost
+    shim_adc_set(10, 2345, 0);
+    run_callbacks_for(200);
+
+    jerry_object_t *counters = get_object(
+        jerry_get_object_value(call(aio, "getIpmStats", 0, NULL)), "arc");
+    double retried = get_number(counters, "retried");
+
+    shim_ipm_busy(SHIM_CORE_X86, 5);
+    uint64_t start = now_us();
+    double value = jerry_get_number_value(call(pin, "read", 0, NULL));
+    uint64_t elapsed = now_us() - start;
+
+    counters = get_object(
+        jerry_get_object_value(call(aio, "getIpmStats", 0, NULL)), "arc");
+    retried = get_number(counters, "retried") - retried;
+
+    CHECK(value == 2345, "read %g, not 2345, with x86's mailbox busy", value);
+    CHECK(elapsed < 30000, "read took %lluus with x86's mailbox busy for 5ms",
+          (unsigned long long)elapsed);
+    CHECK(retried < 10, "ARC retried a busy mailbox %g times", retried);
+
+    printf("read with x86's mailbox busy for 5ms: %lluus, %g ARC retries\n",
+           (unsigned long long)elapsed, retried);
+}
+
+static void test_idle(jerry_object_t *aio, jerry_object_t *pins[6])
+{
+    // with every pin closed, ARC has nothing to schedule and should sleep
+    //   until x86 asks for something, not wake on every tick
+    for (int i = 0; i < 6; i++) {
+        call(pins[i], "close", 0, NULL);
+    }
+    run_callbacks_for(100);
+
+    uint32_t before = shim_sem_timeouts[SHIM_CORE_ARC];
+    run_callbacks_for(500);
+    uint32_t wakeups = shim_sem_timeouts[SHIM_CORE_ARC] - before;
+
+    CHECK(wakeups <= 1, "idle ARC woke %u times in 500ms", wakeups);
+
+    // and a pin opened again is scanned at once
+    shim_adc_set(10, 1234, 0);
+    jerry_object_t *pin = open_pin(aio, 10, 0);
+    CHECK(pin, "couldn't open pin 10 again");
+    if (!pin)
+        return;
+    run_callbacks_for(20);
+    double value = jerry_get_number_value(call(pin, "read", 0, NULL));
+    CHECK(value == 1234, "pin 10 read %g, not 1234, 20ms after opening it",
+          value);
+    call(pin, "close", 0, NULL);
+
+    printf("idle ARC: %u timed wakeups in 500ms\n", wakeups);
+}
+
+static void bench_reads(jerry_object_t *pin)
+{
+    const int reads = 1000;
+    uint64_t start = now_us();
+    for (int i = 0; i < reads; i++) {
+        call(pin, "read", 0, NULL);
+    }
+    uint64_t elapsed = now_us() - start;
+    printf("sync read round trip: %.1fus mean over %d reads\n",
+           (double)elapsed / reads, reads);
+}
+
+static void print_ipm_stats(jerry_object_t *aio)
+{
+    jerry_object_t *stats = jerry_get_object_value(
+        call(aio, "getIpmStats", 0, NULL));
+    const char *cores[] = { "x86", "arc" };
+    for (int i = 0; i < 2; i++) {
+        jerry_object_t *c = get_object(stats, cores[i]);
+        printf("%s IPM: %g sent, %g dropped, %g retried, high water %g\n",
+               cores[i], get_number(c, "sent"), get_number(c, "dropped"),
+               get_number(c, "retried"), get_number(c, "highWater"));
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    shim_init();
+    zjs_queue_init();
+
+    pthread_t arc;
+    pthread_create(&arc, NULL, arc_thread, NULL);
+
+    jerry_object_t *aio = zjs_aio_init();
+
+    jerry_object_t *pins[6];
+    for (int i = 0; i < 6; i++) {
+        pins[i] = open_pin(aio, 10 + i, 0);
+        CHECK(pins[i], "couldn't open pin %d", 10 + i);
+        if (!pins[i])
+            return 1;
+    }
+
+    test_read(pins[0]);
+    test_async_reads(pins);
+    test_async_timeout(pins[0]);
+    test_change_events(pins[1]);
+    test_filter_changes(pins[3]);
+    test_stream(pins[2]);
+    test_stream_scans(pins[2], pins[1]);
+    test_backpressure(pins[3]);
+    test_pid(pins[4]);
+    test_pipes(pins[5]);
+    test_pwm_duty();
+    test_pwm_fades();
+    test_pwm_claims();
+    test_pwm_set_channels();
+    test_servo();
+    test_close(pins[1]);
+
+    jerry_object_t *gpio = zjs_gpio_init();
+    test_gpio_events(gpio);
+    test_gpio_pulse(gpio);
+    test_gpio_counting(gpio);
+    test_gpio_debounce(gpio);
+    test_gpio_lifetime(gpio);
+    test_gpio_waveform(gpio);
+    test_gpio_outputs(gpio);
+    test_pipe_taps(pins[5], gpio);
+
+    bench_reads(pins[0]);
+    print_ipm_stats(aio);
+    test_ipm_handlers(pins[0]);
+    test_doorbell(aio, pins[0]);
+    test_idle(aio, pins);
+
+    if (failures) {
+        printf("%d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("all checks passed\n");
+    return 0;
+}
@@ -0,0 +1,722 @@
+// Copyright (c) 2016, Intel Corporation.
+
+// Host stand-ins for the Zephyr kernel, mailbox and ADC, see shim/*.h
+//
+// Each core is a thread. A message sent over the mailbox runs the receiving
+//   core's callback right away on the sender's thread, as that core's ISR:
+//   it holds the receiver's interrupt lock and looks like the receiver to
+//   device_get_binding and irq_lock.
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <zephyr.h>
+#include <adc.h>
+#include <counter.h>
+#include <gpio.h>
+#include <ipm.h>
+#include <pwm.h>
+
+#include "shim.h"
+
+__thread int shim_core = SHIM_CORE_X86;
+
+struct shim_core_state {
+    pthread_mutex_t irq;
+    pthread_mutex_t mailbox;    // held while a message to this core is unread
+    struct device send;
+    struct device receive;
+    ipm_callback_t callback;
+    void *context;
+    volatile int enabled;
+};
+
+static struct shim_core_state cores[SHIM_CORES];
+static struct device adc_device = { "ADC_0", SHIM_CORE_ARC, NULL };
+static struct device pwm_device = { "PWM_0", SHIM_CORE_X86, NULL };
+static struct device gpio_device = { "GPIO_0", SHIM_CORE_X86, NULL };
+static struct device aon_timer_device = { "AON_TIMER", SHIM_CORE_X86, NULL };
+
+uint32_t shim_ipm_messages[SHIM_CORES];
+uint32_t shim_sem_timeouts[SHIM_CORES];
+
+static uint64_t shim_now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void shim_sleep_ns(uint64_t ns)
+{
+    struct timespec ts = { ns / 1000000000ULL, ns % 1000000000ULL };
+    while (nanosleep(&ts, &ts) && errno == EINTR);
+}
+
+static void shim_deadline(struct timespec *ts, int32_t ticks)
+{
+    uint64_t ns;
+    clock_gettime(CLOCK_REALTIME, ts);
+    ns = (uint64_t)ts->tv_nsec +
+         (uint64_t)ticks * (1000000000ULL / sys_clock_ticks_per_sec);
+    ts->tv_sec += ns / 1000000000ULL;
+    ts->tv_nsec = ns % 1000000000ULL;
+}
+
+void shim_init(void)
+{
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+
+    for (int i = 0; i < SHIM_CORES; i++) {
+        pthread_mutex_init(&cores[i].irq, &attr);
+        pthread_mutex_init(&cores[i].mailbox, NULL);
+        cores[i].send.name = "ipm_msg_send";
+        cores[i].send.core = i;
+        cores[i].receive.name = "ipm_msg_receive";
+        cores[i].receive.core = i;
+    }
+}
+
+uint32_t sys_cycle_get_32(void)
+{
+    return shim_now_ns() * (sys_clock_hw_cycles_per_sec / 1000000) / 1000;
+}
+
+uint32_t sys_tick_get_32(void)
+{
+    return shim_now_ns() / (1000000000ULL / sys_clock_ticks_per_sec);
+}
+
+int irq_lock(void)
+{
+    pthread_mutex_lock(&cores[shim_core].irq);
+    return 0;
+}
+
+void irq_unlock(int key)
+{
+    pthread_mutex_unlock(&cores[shim_core].irq);
+}
+
+void *task_malloc(uint32_t size)
+{
+    return malloc(size);
+}
+
+void task_free(void *ptr)
+{
+    free(ptr);
+}
+
+void task_sleep(int32_t ticks)
+{
+    shim_sleep_ns((uint64_t)ticks * (1000000000ULL / sys_clock_ticks_per_sec));
+}
+
+void fiber_sleep(int32_t ticks)
+{
+    task_sleep(ticks);
+}
+
+struct shim_fiber {
+    nano_fiber_entry_t entry;
+    int arg1;
+    int arg2;
+    int core;
+};
+
+static void *shim_fiber_main(void *arg)
+{
+    struct shim_fiber fiber = *(struct shim_fiber *)arg;
+    free(arg);
+    shim_core = fiber.core;
+    fiber.entry(fiber.arg1, fiber.arg2);
+    return NULL;
+}
+
+void task_fiber_start(char *stack, unsigned stack_size,
+                      nano_fiber_entry_t entry, int arg1, int arg2,
+                      unsigned priority, unsigned options)
+{
+    struct shim_fiber *fiber = malloc(sizeof(struct shim_fiber));
+    fiber->entry = entry;
+    fiber->arg1 = arg1;
+    fiber->arg2 = arg2;
+    fiber->core = shim_core;
+
+    pthread_t thread;
+    pthread_create(&thread, NULL, shim_fiber_main, fiber);
+    pthread_detach(thread);
+}
+
+void nano_sem_init(struct nano_sem *sem)
+{
+    pthread_mutex_init(&sem->lock, NULL);
+    pthread_cond_init(&sem->cond, NULL);
+    sem->count = 0;
+}
+
+void nano_isr_sem_give(struct nano_sem *sem)
+{
+    pthread_mutex_lock(&sem->lock);
+    sem->count++;
+    pthread_cond_signal(&sem->cond);
+    pthread_mutex_unlock(&sem->lock);
+}
+
+void nano_task_sem_give(struct nano_sem *sem)
+{
+    nano_isr_sem_give(sem);
+}
+
+void nano_fiber_sem_give(struct nano_sem *sem)
+{
+    nano_isr_sem_give(sem);
+}
+
+int nano_task_sem_take(struct nano_sem *sem, int32_t timeout_in_ticks)
+{
+    struct timespec deadline;
+    shim_deadline(&deadline, timeout_in_ticks);
+
+    pthread_mutex_lock(&sem->lock);
+    while (!sem->count && timeout_in_ticks != TICKS_NONE) {
+        int rc = timeout_in_ticks == TICKS_UNLIMITED ?
+                 pthread_cond_wait(&sem->cond, &sem->lock) :
+                 pthread_cond_timedwait(&sem->cond, &sem->lock, &deadline);
+        if (rc == ETIMEDOUT) {
+            __sync_fetch_and_add(&shim_sem_timeouts[shim_core], 1);
+            break;
+        }
+    }
+
+    int taken = 0;
+    if (sem->count) {
+        sem->count--;
+        taken = 1;
+    }
+    pthread_mutex_unlock(&sem->lock);
+    return taken;
+}
+
+int nano_fiber_sem_take(struct nano_sem *sem, int32_t timeout_in_ticks)
+{
+    return nano_task_sem_take(sem, timeout_in_ticks);
+}
+
+void nano_fifo_init(struct nano_fifo *fifo)
+{
+    pthread_mutex_init(&fifo->lock, NULL);
+    fifo->head = NULL;
+    fifo->tail = NULL;
+}
+
+void nano_fifo_put(struct nano_fifo *fifo, void *data)
+{
+    pthread_mutex_lock(&fifo->lock);
+    *(void **)data = NULL;
+    if (fifo->tail)
+        *(void **)fifo->tail = data;
+    else
+        fifo->head = data;
+    fifo->tail = data;
+    pthread_mutex_unlock(&fifo->lock);
+}
+
+void *nano_task_fifo_get(struct nano_fifo *fifo, int32_t timeout_in_ticks)
+{
+    // only TICKS_NONE is used by the code under test
+    pthread_mutex_lock(&fifo->lock);
+    void *data = fifo->head;
+    if (data) {
+        fifo->head = *(void **)data;
+        if (!fifo->head)
+            fifo->tail = NULL;
+    }
+    pthread_mutex_unlock(&fifo->lock);
+    return data;
+}
+
+void nano_timer_init(struct nano_timer *timer, void *data)
+{
+    timer->expiry_ns = 0;
+    timer->user_data = data;
+}
+
+void nano_task_timer_start(struct nano_timer *timer, int ticks)
+{
+    timer->expiry_ns = shim_now_ns() +
+        (uint64_t)ticks * (1000000000ULL / sys_clock_ticks_per_sec);
+}
+
+void *nano_task_timer_test(struct nano_timer *timer, int32_t timeout_in_ticks)
+{
+    // only TICKS_UNLIMITED is used by the code under test
+    uint64_t now = shim_now_ns();
+    if (timer->expiry_ns > now)
+        shim_sleep_ns(timer->expiry_ns - now);
+    return timer->user_data;
+}
+
+struct device *device_get_binding(const char *name)
+{
+    if (!strcmp(name, "ipm_msg_send"))
+        return &cores[shim_core].send;
+    if (!strcmp(name, "ipm_msg_receive"))
+        return &cores[shim_core].receive;
+    if (!strcmp(name, adc_device.name) && shim_core == SHIM_CORE_ARC)
+        return &adc_device;
+    if (!strcmp(name, pwm_device.name) && shim_core == SHIM_CORE_X86)
+        return &pwm_device;
+    if (!strcmp(name, gpio_device.name) && shim_core == SHIM_CORE_X86)
+        return &gpio_device;
+    if (!strcmp(name, aon_timer_device.name) && shim_core == SHIM_CORE_X86)
+        return &aon_timer_device;
+    return NULL;
+}
+
+// messages still to lose on their way to each core
+static uint32_t ipm_lost[SHIM_CORES];
+
+void shim_ipm_lose(int core, uint32_t count)
+{
+    __atomic_store_n(&ipm_lost[core], count, __ATOMIC_SEQ_CST);
+}
+
+static uint64_t ipm_busy_until[SHIM_CORES];
+
+void shim_ipm_busy(int core, uint32_t ms)
+{
+    __atomic_store_n(&ipm_busy_until[core], shim_now_ns() + ms * 1000000ULL,
+                     __ATOMIC_SEQ_CST);
+}
+
+int ipm_send(struct device *ipmdev, int wait, uint32_t id, const void *data,
+             int size)
+{
+    int target = !ipmdev->core;
+    struct shim_core_state *core = &cores[target];
+
+    // like the mailbox, hold the message until the other core listens
+    while (!core->enabled) {
+        if (!wait)
+            return -EBUSY;
+        shim_sleep_ns(100000);
+    }
+
+    uint8_t buffer[16] = {};
+    if (size > sizeof(buffer))
+        return -EMSGSIZE;
+    memcpy(buffer, data, size);
+
+    // like the driver, refuse a message while the last one is unread, even
+    //   with wait set
+    if (shim_now_ns() < __atomic_load_n(&ipm_busy_until[target],
+                                        __ATOMIC_SEQ_CST))
+        return -EBUSY;
+    if (pthread_mutex_trylock(&core->mailbox))
+        return -EBUSY;
+
+    if (__atomic_load_n(&ipm_lost[target], __ATOMIC_SEQ_CST)) {
+        __atomic_fetch_sub(&ipm_lost[target], 1, __ATOMIC_SEQ_CST);
+        shim_ipm_messages[shim_core]++;
+        pthread_mutex_unlock(&core->mailbox);
+        return 0;
+    }
+
+    pthread_mutex_lock(&core->irq);
+    int sender = shim_core;
+    shim_core = target;
+    shim_ipm_messages[sender]++;
+    core->callback(core->context, id, buffer);
+    shim_core = sender;
+    pthread_mutex_unlock(&core->irq);
+    pthread_mutex_unlock(&core->mailbox);
+    return 0;
+}
+
+void ipm_register_callback(struct device *ipmdev, ipm_callback_t cb,
+                           void *context)
+{
+    cores[ipmdev->core].callback = cb;
+    cores[ipmdev->core].context = context;
+}
+
+int ipm_set_enabled(struct device *ipmdev, int enable)
+{
+    cores[ipmdev->core].enabled = enable;
+    return 0;
+}
+
+struct shim_adc_channel {
+    uint32_t base;
+    uint32_t step;
+    uint32_t conversions;
+    shim_adc_source_t source;
+};
+
+static struct shim_adc_channel adc_channels[32];
+static pthread_mutex_t adc_lock = PTHREAD_MUTEX_INITIALIZER;
+
+void shim_adc_set(uint8_t channel, uint32_t base, uint32_t step)
+{
+    pthread_mutex_lock(&adc_lock);
+    adc_channels[channel].base = base;
+    adc_channels[channel].step = step;
+    adc_channels[channel].conversions = 0;
+    pthread_mutex_unlock(&adc_lock);
+}
+
+void shim_adc_set_source(uint8_t channel, shim_adc_source_t source)
+{
+    pthread_mutex_lock(&adc_lock);
+    adc_channels[channel].source = source;
+    pthread_mutex_unlock(&adc_lock);
+}
+
+uint32_t shim_adc_conversions(uint8_t channel)
+{
+    pthread_mutex_lock(&adc_lock);
+    uint32_t conversions = adc_channels[channel].conversions;
+    pthread_mutex_unlock(&adc_lock);
+    return conversions;
+}
+
+void adc_enable(struct device *dev)
+{
+}
+
+void adc_disable(struct device *dev)
+{
+}
+
+int adc_read(struct device *dev, struct adc_seq_table *seq_table)
+{
+    uint64_t adc_cycles = 0;
+
+    pthread_mutex_lock(&adc_lock);
+    for (int i = 0; i < seq_table->num_entries; i++) {
+        struct adc_seq_entry *entry = &seq_table->entries[i];
+        struct shim_adc_channel *ch = &adc_channels[entry->channel_id];
+        uint32_t *samples = (uint32_t *)entry->buffer;
+        for (int j = 0; j < entry->buffer_length / sizeof(uint32_t); j++) {
+            if (ch->source)
+                samples[j] = ch->source(entry->channel_id) & 0xfff;
+            else
+                samples[j] = (ch->base + ch->step * ch->conversions++) & 0xfff;
+            adc_cycles += entry->sampling_delay + 14;
+        }
+    }
+    pthread_mutex_unlock(&adc_lock);
+
+    // take as long as the sequencer would on its divided clock
+    shim_sleep_ns(adc_cycles * CONFIG_ADC_DW_CLOCK_RATIO * 1000000000ULL /
+                  sys_clock_hw_cycles_per_sec);
+    return 0;
+}
+
+struct shim_pwm_channel {
+    uint32_t on;
+    uint32_t off;
+    uint32_t writes;
+    uint64_t written_ns;
+};
+
+static struct shim_pwm_channel pwm_channels[4];
+static pthread_mutex_t pwm_lock = PTHREAD_MUTEX_INITIALIZER;
+
+int pwm_pin_set_values(struct device *dev, uint32_t pwm, uint32_t on,
+                       uint32_t off)
+{
+    if (pwm >= sizeof(pwm_channels) / sizeof(pwm_channels[0]))
+        return -EINVAL;
+
+    pthread_mutex_lock(&pwm_lock);
+    pwm_channels[pwm].on = on;
+    pwm_channels[pwm].off = off;
+    pwm_channels[pwm].writes++;
+    pwm_channels[pwm].written_ns = shim_now_ns();
+    pthread_mutex_unlock(&pwm_lock);
+    return 0;
+}
+
+uint64_t shim_pwm_written_ns(uint32_t pwm)
+{
+    pthread_mutex_lock(&pwm_lock);
+    uint64_t ns = pwm_channels[pwm].written_ns;
+    pthread_mutex_unlock(&pwm_lock);
+    return ns;
+}
+
+double shim_pwm_duty(uint32_t pwm, uint32_t *writes)
+{
+    pthread_mutex_lock(&pwm_lock);
+    struct shim_pwm_channel ch = pwm_channels[pwm];
+    pthread_mutex_unlock(&pwm_lock);
+
+    if (writes)
+        *writes = ch.writes;
+    if (!ch.on && !ch.off)
+        return 0;
+    return (double)ch.on / (ch.on + ch.off);
+}
+
+// the GPIO port's state only changes with the x86 interrupt lock held, so
+//   the edge ISR below sees it the way the driver's would
+static uint32_t gpio_levels;
+static uint32_t gpio_enabled;
+static int gpio_flags[32];
+static uint32_t gpio_writes[32];
+static struct gpio_callback *gpio_callbacks;
+
+void gpio_init_callback(struct gpio_callback *callback,
+                        gpio_callback_handler_t handler, uint32_t pin_mask)
+{
+    callback->next = NULL;
+    callback->handler = handler;
+    callback->pin_mask = pin_mask;
+}
+
+int gpio_add_callback(struct device *port, struct gpio_callback *callback)
+{
+    pthread_mutex_lock(&cores[SHIM_CORE_X86].irq);
+    callback->next = gpio_callbacks;
+    gpio_callbacks = callback;
+    pthread_mutex_unlock(&cores[SHIM_CORE_X86].irq);
+    return 0;
+}
+
+int gpio_remove_callback(struct device *port, struct gpio_callback *callback)
+{
+    pthread_mutex_lock(&cores[SHIM_CORE_X86].irq);
+    struct gpio_callback **cb = &gpio_callbacks;
+    while (*cb && *cb != callback)
+        cb = &(*cb)->next;
+    if (*cb)
+        *cb = callback->next;
+    pthread_mutex_unlock(&cores[SHIM_CORE_X86].irq);
+    return 0;
+}
+
+static int gpio_set_enabled(uint32_t pin, bool enable)
+{
+    if (pin >= 32)
+        return -EINVAL;
+
+    pthread_mutex_lock(&cores[SHIM_CORE_X86].irq);
+    if (enable)
+        gpio_enabled |= 1UL << pin;
+    else
+        gpio_enabled &= ~(1UL << pin);
+    pthread_mutex_unlock(&cores[SHIM_CORE_X86].irq);
+    return 0;
+}
+
+int gpio_pin_enable_callback(struct device *port, uint32_t pin)
+{
+    return gpio_set_enabled(pin, true);
+}
+
+int gpio_pin_disable_callback(struct device *port, uint32_t pin)
+{
+    return gpio_set_enabled(pin, false);
+}
+
+int gpio_pin_configure(struct device *port, uint32_t pin, int flags)
+{
+    if (pin >= 32)
+        return -EINVAL;
+    gpio_flags[pin] = flags;
+    return 0;
+}
+
+int gpio_pin_read(struct device *port, uint32_t pin, uint32_t *value)
+{
+    if (pin >= 32)
+        return -EINVAL;
+    *value = (gpio_levels >> pin) & 1;
+    return 0;
+}
+
+int gpio_pin_write(struct device *port, uint32_t pin, uint32_t value)
+{
+    if (pin >= 32)
+        return -EINVAL;
+
+    pthread_mutex_lock(&cores[SHIM_CORE_X86].irq);
+    if (value)
+        gpio_levels |= 1UL << pin;
+    else
+        gpio_levels &= ~(1UL << pin);
+    gpio_writes[pin]++;
+    pthread_mutex_unlock(&cores[SHIM_CORE_X86].irq);
+    return 0;
+}
+
+int gpio_port_read(struct device *port, uint32_t *value)
+{
+    *value = gpio_levels;
+    return 0;
+}
+
+int gpio_port_write(struct device *port, uint32_t value)
+{
+    pthread_mutex_lock(&cores[SHIM_CORE_X86].irq);
+    for (int pin = 0; pin < 32; pin++) {
+        if ((gpio_flags[pin] & GPIO_DIR_OUT) &&
+            ((gpio_levels ^ value) & (1UL << pin)))
+            gpio_writes[pin]++;
+    }
+    gpio_levels = value;
+    pthread_mutex_unlock(&cores[SHIM_CORE_X86].irq);
+    return 0;
+}
+
+void shim_gpio_set(uint32_t pin, uint32_t value)
+{
+    int core = shim_core;
+    shim_core = SHIM_CORE_X86;
+    pthread_mutex_lock(&cores[SHIM_CORE_X86].irq);
+
+    uint32_t old = (gpio_levels >> pin) & 1;
+    value = !!value;
+    if (value)
+        gpio_levels |= 1UL << pin;
+    else
+        gpio_levels &= ~(1UL << pin);
+
+    int flags = gpio_flags[pin];
+    bool edge = old != value && (flags & GPIO_INT) &&
+                (gpio_enabled & (1UL << pin)) &&
+                ((flags & GPIO_INT_DOUBLE_EDGE) ||
+                 (value == !!(flags & GPIO_INT_ACTIVE_HIGH)));
+    if (edge) {
+        struct gpio_callback *cb = gpio_callbacks;
+        while (cb) {
+            struct gpio_callback *next = cb->next;
+            if (cb->pin_mask & (1UL << pin))
+                cb->handler(&gpio_device, cb, 1UL << pin);
+            cb = next;
+        }
+    }
+
+    pthread_mutex_unlock(&cores[SHIM_CORE_X86].irq);
+    shim_core = core;
+}
+
+uint32_t shim_gpio_port(uint32_t pin, uint32_t *writes)
+{
+    pthread_mutex_lock(&cores[SHIM_CORE_X86].irq);
+    uint32_t levels = gpio_levels;
+    if (writes)
+        *writes = gpio_writes[pin];
+    pthread_mutex_unlock(&cores[SHIM_CORE_X86].irq);
+    return levels;
+}
+
+// the timer's alarm is kept by a thread of its own, which runs the callback
+//   as the x86 ISR; seq changes whenever the alarm is set or stopped, so an
+//   expiry that raced with that is dropped, as the hardware would
+#define AON_TIMER_HZ 32768
+
+static pthread_mutex_t aon_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t aon_cond = PTHREAD_COND_INITIALIZER;
+static bool aon_started;
+static bool aon_thread_started;
+static counter_callback_t aon_callback;
+static void *aon_user_data;
+static uint64_t aon_period_ns;
+static uint64_t aon_due_ns;
+static uint32_t aon_seq;
+
+static void *aon_timer_main(void *arg)
+{
+    pthread_mutex_lock(&aon_lock);
+    while (1) {
+        if (!aon_started || !aon_callback) {
+            pthread_cond_wait(&aon_cond, &aon_lock);
+            continue;
+        }
+
+        uint64_t now = shim_now_ns();
+        if (now < aon_due_ns) {
+            struct timespec ts;
+            clock_gettime(CLOCK_REALTIME, &ts);
+            uint64_t ns = ts.tv_nsec + (aon_due_ns - now);
+            ts.tv_sec += ns / 1000000000ULL;
+            ts.tv_nsec = ns % 1000000000ULL;
+            pthread_cond_timedwait(&aon_cond, &aon_lock, &ts);
+            continue;
+        }
+
+        counter_callback_t callback = aon_callback;
+        void *user_data = aon_user_data;
+        uint32_t seq = aon_seq;
+        aon_due_ns += aon_period_ns;
+        pthread_mutex_unlock(&aon_lock);
+
+        pthread_mutex_lock(&cores[SHIM_CORE_X86].irq);
+        shim_core = SHIM_CORE_X86;
+        pthread_mutex_lock(&aon_lock);
+        bool current = seq == aon_seq;
+        pthread_mutex_unlock(&aon_lock);
+        if (current)
+            callback(&aon_timer_device, user_data);
+        pthread_mutex_unlock(&cores[SHIM_CORE_X86].irq);
+
+        pthread_mutex_lock(&aon_lock);
+    }
+    return NULL;
+}
+
+int counter_start(struct device *dev)
+{
+    pthread_mutex_lock(&aon_lock);
+    if (!aon_thread_started) {
+        pthread_t thread;
+        pthread_create(&thread, NULL, aon_timer_main, NULL);
+        pthread_detach(thread);
+        aon_thread_started = true;
+    }
+    aon_started = true;
+    aon_callback = NULL;
+    aon_seq++;
+    pthread_mutex_unlock(&aon_lock);
+    return 0;
+}
+
+int counter_stop(struct device *dev)
+{
+    pthread_mutex_lock(&aon_lock);
+    aon_started = false;
+    aon_seq++;
+    pthread_cond_signal(&aon_cond);
+    pthread_mutex_unlock(&aon_lock);
+    return 0;
+}
+
+int counter_set_alarm(struct device *dev, counter_callback_t callback,
+                      uint32_t count, void *user_data)
+{
+    if (!count)
+        return -EINVAL;
+
+    pthread_mutex_lock(&aon_lock);
+    if (!aon_started) {
+        pthread_mutex_unlock(&aon_lock);
+        return -ENOTSUP;
+    }
+    aon_callback = callback;
+    aon_user_data = user_data;
+    aon_period_ns = (uint64_t)count * 1000000000ULL / AON_TIMER_HZ;
+    aon_due_ns = shim_now_ns() + aon_period_ns;
+    aon_seq++;
+    pthread_cond_signal(&aon_cond);
+    pthread_mutex_unlock(&aon_lock);
+    return 0;
+}
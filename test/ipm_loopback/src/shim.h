@@ -0,0 +1,29 @@
+// Copyright (c) 2016, Intel Corporation.
+
+// Controls for the host stand-ins that the loopback test uses directly
+
+#include <stdint.h>
+
+#define SHIM_CORE_X86   0
+#define SHIM_CORE_ARC   1
+#define SHIM_CORES      2
+
+// which core the calling thread is running as
+extern __thread int shim_core;
+
+// mailbox messages each core has sent, ring doorbells included
+extern uint32_t shim_ipm_messages[SHIM_CORES];
+
+// semaphore takes on each core that gave up on a timeout, that is, how
+//   often its tasks and fibers woke up with nothing to do
+extern uint32_t shim_sem_timeouts[SHIM_CORES];
+
+// loses the next count mailbox messages sent to core, as if they never
+//   arrived; the sender sees them go
+void shim_ipm_lose(int core, uint32_t count);
+
+// makes the mailbox to core refuse messages as busy for the next ms, as if
+//   core were slow to take the last one
+void shim_ipm_busy(int core, uint32_t ms);
+
+void shim_init(void);